@@ -1,25 +1,142 @@
+// Protocol versions and frame layout are documented in src/SerialLineSensor/LineSensorProtocol.h
+const uint8_t protocolAscii = 0;
+const uint8_t protocolBinary = 1;
+const uint8_t channelCount = 3;
+const size_t frameSize = 6 + 2 * channelCount + 2;
+
+const unsigned long baudRate = 500000;
+const uint32_t samplePeriodMicros = 1000;  // 1kHz
+const uint8_t oversampling = 2;            // ADC conversions averaged per channel per sample
+const uint8_t asciiDecimation = 20;        // ASCII output stays at 50Hz for older hosts
+const int sensorPins[channelCount] = {A0, A1, A2};
+
+uint8_t protocol = protocolAscii;
+uint8_t sequence = 0;
+uint8_t asciiCountdown = 0;
+uint32_t nextSampleTime = 0;
+char command[16];
+size_t commandLength = 0;
+
+uint16_t crc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Encodes length bytes from input into output (at least length + 1 bytes).  Returns encoded length without delimiter
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output) {
+  size_t codeIndex = 0;
+  size_t writeIndex = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; ++i) {
+    if (input[i] == 0) {
+      output[codeIndex] = code;
+      codeIndex = writeIndex++;
+      code = 1;
+    } else {
+      output[writeIndex++] = input[i];
+      if (++code == 0xFF) {
+        output[codeIndex] = code;
+        codeIndex = writeIndex++;
+        code = 1;
+      }
+    }
+  }
+  output[codeIndex] = code;
+  return writeIndex;
+}
+
+// Host sends "protocol <version>\n" to switch output format
+void handleCommands() {
+  while (Serial.available() > 0) {
+    char received = Serial.read();
+    if (received == '\n') {
+      command[commandLength] = '\0';
+      if (strncmp(command, "protocol ", 9) == 0) {
+        int requested = atoi(command + 9);
+        if (requested == protocolAscii || requested == protocolBinary) {
+          protocol = requested;
+          sequence = 0;
+          Serial.print("\r\nprotocol ");
+          Serial.println(requested);
+        }
+      }
+      commandLength = 0;
+    } else if (commandLength < sizeof(command) - 1) {
+      command[commandLength++] = received;
+    }
+  }
+}
+
+void sendBinary(uint32_t timestamp, const int* values) {
+  uint8_t frame[frameSize];
+  uint8_t encoded[frameSize + 1];
+  frame[0] = sequence++;
+  frame[1] = channelCount;
+  frame[2] = (uint8_t)((timestamp >> 0) & 0xff);
+  frame[3] = (uint8_t)((timestamp >> 8) & 0xff);
+  frame[4] = (uint8_t)((timestamp >> 16) & 0xff);
+  frame[5] = (uint8_t)((timestamp >> 24) & 0xff);
+  for (uint8_t channel = 0; channel < channelCount; ++channel) {
+    frame[6 + 2 * channel] = (uint8_t)((values[channel] >> 0) & 0xff);
+    frame[7 + 2 * channel] = (uint8_t)((values[channel] >> 8) & 0xff);
+  }
+  uint16_t crc = crc16(frame, frameSize - 2);
+  frame[frameSize - 2] = (uint8_t)((crc >> 0) & 0xff);
+  frame[frameSize - 1] = (uint8_t)((crc >> 8) & 0xff);
+
+  size_t encodedLength = cobsEncode(frame, frameSize, encoded);
+  Serial.write(encoded, encodedLength);
+  Serial.write((uint8_t)0);
+}
+
 void setup() {
-  Serial.begin(115200);
+#if defined(ADCSRA)
+  // ADC clock prescaler 128 (125kHz at 16MHz), inside the 50-200kHz the datasheet requires for full 10-bit
+  // accuracy.  A conversion takes 13 ADC clocks (104us), so channelCount * oversampling = 6 conversions (~0.65ms)
+  // fit in one sample period with time left for serial output
+  ADCSRA = (ADCSRA & ~0x07) | 0x07;
+#endif
+  Serial.begin(baudRate);
+  nextSampleTime = micros();
 }
 
 void loop() {
-  unsigned char humanReadable[128];
-  unsigned char buffer[8];
-  int leftSensorValue = analogRead(A0);
-  int centerSensorValue = analogRead(A1);
-  int rightSensorValue = analogRead(A2);
-  buffer[0] = (unsigned char)((leftSensorValue >> 0) & 0xff);
-  buffer[1] = (unsigned char)((leftSensorValue >> 8) & 0xff);
-  buffer[2] = (unsigned char)((centerSensorValue >> 0) & 0xff);
-  buffer[3] = (unsigned char)((centerSensorValue >> 8) & 0xff);
-  buffer[4] = (unsigned char)((rightSensorValue >> 0) & 0xff);
-  buffer[5] = (unsigned char)((rightSensorValue >> 8) & 0xff);
-  buffer[6] = '\r';
-  buffer[7] = '\n';
-
-  snprintf(humanReadable, 128, "l: %04d, c: %04d, r: %04d", leftSensorValue, centerSensorValue, rightSensorValue);
-  //  Serial.write(buffer, 8);
-  Serial.write(humanReadable, strlen(humanReadable));
-  Serial.println();
-  delay(20);
+  handleCommands();
+
+  uint32_t now = micros();
+  if ((int32_t)(now - nextSampleTime) < 0) {
+    return;
+  }
+  nextSampleTime += samplePeriodMicros;
+  if ((int32_t)(now - nextSampleTime) >= 0) {
+    // Fell more than a period behind (e.g. blocked on serial), resynchronize instead of bursting
+    nextSampleTime = now + samplePeriodMicros;
+  }
+
+  int values[channelCount];
+  for (uint8_t channel = 0; channel < channelCount; ++channel) {
+    unsigned int sum = 0;
+    for (uint8_t i = 0; i < oversampling; ++i) {
+      sum += analogRead(sensorPins[channel]);
+    }
+    values[channel] = (sum + oversampling / 2) / oversampling;
+  }
+
+  if (protocol == protocolBinary) {
+    sendBinary(now, values);
+  } else if (asciiCountdown == 0) {
+    char humanReadable[128];
+    snprintf(humanReadable, 128, "l: %04d, c: %04d, r: %04d", values[0], values[1], values[2]);
+    Serial.write(humanReadable, strlen(humanReadable));
+    Serial.println();
+    asciiCountdown = asciiDecimation - 1;
+  } else {
+    --asciiCountdown;
+  }
 }
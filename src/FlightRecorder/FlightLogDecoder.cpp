@@ -0,0 +1,430 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @file Decodes FlightRecorder segments to CSV on stdout, one row per record and one column per field element
+///       (array elements are named field[i]).  Only segment headers are trusted; the layout comes from the CBOR
+///       metadata in each segment, so recordings from older builds decode too.
+///
+///       Usage: FlightLogDecoder <directory> [--list | --run <runId>]
+///
+///       With no option the most recent run is decoded.  --list prints each run in the directory.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <wpi/json.h>
+
+#include "FlightRecorder.h"
+#include "FlightRecorderFormat.h"
+
+namespace {
+  using namespace flightRecorderFormat;
+
+  constexpr auto usage = "Usage: FlightLogDecoder <directory> [--list | --run <runId>]\n";
+
+  struct Segment {
+    std::filesystem::path path;
+    SegmentHeader header;
+  };
+
+  struct Column {
+    std::string name;
+    FlightRecorder::FieldType type;
+    std::size_t offset;
+  };
+
+  /**
+   * @brief Reads the CBOR that wpi::json::to_cbor() writes: definite length items, no tags or half precision.  The
+   *        vendored wpiutil leaves out the stream support wpi::json::from_cbor() needs
+   */
+  class CborReader {
+   public:
+    explicit CborReader(const std::span<const uint8_t> data) : m_data{data}, m_position{0} {}
+
+    /// @return std::nullopt if the data is malformed or uses unsupported features
+    std::optional<wpi::json> Read(const int depth = 0) {
+      if (depth > maxDepth || m_position >= m_data.size()) {
+        return std::nullopt;
+      }
+      const uint8_t initial = m_data[m_position++];
+      const uint8_t majorType = initial >> 5;
+      const uint8_t info = initial & 0x1F;
+      if (majorType == 7) {
+        return ReadSimple(info);
+      }
+      const auto argument = ReadArgument(info);
+      if (!argument) {
+        return std::nullopt;
+      }
+      switch (majorType) {
+        case 0:
+          return wpi::json(argument.value());
+        case 1:
+          return wpi::json(-1 - static_cast<int64_t>(argument.value()));
+        case 3:
+          if (argument.value() > m_data.size() - m_position) {
+            return std::nullopt;
+          } else {
+            std::string text(reinterpret_cast<const char*>(m_data.data() + m_position), argument.value());
+            m_position += argument.value();
+            return wpi::json(text);
+          }
+        case 4: {
+          auto array = wpi::json::array();
+          for (uint64_t i = 0; i < argument.value(); ++i) {
+            auto element = Read(depth + 1);
+            if (!element) {
+              return std::nullopt;
+            }
+            array.push_back(std::move(element.value()));
+          }
+          return array;
+        }
+        case 5: {
+          auto object = wpi::json::object();
+          for (uint64_t i = 0; i < argument.value(); ++i) {
+            const auto key = Read(depth + 1);
+            auto value = Read(depth + 1);
+            if (!key || !key.value().is_string() || !value) {
+              return std::nullopt;
+            }
+            object[key.value().get<std::string>()] = std::move(value.value());
+          }
+          return object;
+        }
+        default:
+          return std::nullopt;
+      }
+    }
+
+   private:
+    constexpr static int maxDepth = 32;
+
+    std::optional<uint64_t> ReadBigEndian(const std::size_t bytes) {
+      if (bytes > m_data.size() - m_position) {
+        return std::nullopt;
+      }
+      uint64_t value = 0;
+      for (std::size_t i = 0; i < bytes; ++i) {
+        value = (value << 8) | m_data[m_position++];
+      }
+      return value;
+    }
+
+    std::optional<uint64_t> ReadArgument(const uint8_t info) {
+      if (info < 24) {
+        return info;
+      }
+      if (info > 27) {
+        return std::nullopt;
+      }
+      return ReadBigEndian(std::size_t{1} << (info - 24));
+    }
+
+    std::optional<wpi::json> ReadSimple(const uint8_t info) {
+      switch (info) {
+        case 20:
+          return wpi::json(false);
+        case 21:
+          return wpi::json(true);
+        case 22:
+          return wpi::json(nullptr);
+        case 26:
+          if (const auto bits = ReadBigEndian(4); bits) {
+            float value;
+            const auto bits32 = static_cast<uint32_t>(bits.value());
+            std::memcpy(&value, &bits32, sizeof(value));
+            return wpi::json(value);
+          }
+          return std::nullopt;
+        case 27:
+          if (const auto bits = ReadBigEndian(8); bits) {
+            double value;
+            std::memcpy(&value, &bits.value(), sizeof(value));
+            return wpi::json(value);
+          }
+          return std::nullopt;
+        default:
+          return std::nullopt;
+      }
+    }
+
+    const std::span<const uint8_t> m_data;
+    std::size_t m_position;
+  };
+
+  /// @brief Headers of every written segment in directory, oldest first
+  std::vector<Segment> ReadSegments(const std::filesystem::path& directory) {
+    std::vector<Segment> segments;
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+      if (file.path().filename().string().rfind(segmentPrefix, 0) != 0) {
+        continue;
+      }
+      std::ifstream stream(file.path(), std::ios::binary);
+      Segment segment{.path = file.path(), .header{}};
+      if (stream.read(reinterpret_cast<char*>(&segment.header), sizeof(segment.header)) &&
+          segment.header.magic == segmentMagic && segment.header.version == version && segment.header.sequence != 0) {
+        segments.push_back(segment);
+      }
+    }
+    std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+      return lhs.header.sequence < rhs.header.sequence;
+    });
+    return segments;
+  }
+
+  /// @brief Index entries by sequence number.  Empty if there is no usable index
+  std::map<uint64_t, IndexEntry> ReadIndex(const std::filesystem::path& directory) {
+    std::map<uint64_t, IndexEntry> entries;
+    std::ifstream stream(directory / indexName, std::ios::binary);
+    IndexHeader header{};
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != indexMagic ||
+        header.version != version) {
+      return entries;
+    }
+    for (uint32_t slot = 0; slot < header.segmentCount; ++slot) {
+      IndexEntry entry{};
+      if (!stream.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+        break;
+      }
+      if (entry.sequence != 0) {
+        entries[entry.sequence] = entry;
+      }
+    }
+    return entries;
+  }
+
+  std::string FormatRunId(const int64_t runId) {
+    const std::time_t seconds = runId / 1'000'000'000;
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    return text;
+  }
+
+  void ListRuns(const std::vector<Segment>& segments, const std::map<uint64_t, IndexEntry>& index) {
+    struct Run {
+      std::size_t segments{0};
+      uint64_t records{0};
+      std::optional<int64_t> firstTime;
+      std::optional<int64_t> lastTime;
+    };
+    std::map<int64_t, Run> runs;
+    for (const auto& segment : segments) {
+      auto& run = runs[segment.header.runId];
+      ++run.segments;
+      run.records += segment.header.recordCount;
+      if (const auto entry = index.find(segment.header.sequence);
+          entry != index.end() && entry->second.recordCount > 0) {
+        run.firstTime = std::min(run.firstTime.value_or(entry->second.firstTime), entry->second.firstTime);
+        run.lastTime = std::max(run.lastTime.value_or(entry->second.lastTime), entry->second.lastTime);
+      }
+    }
+    for (const auto& [runId, run] : runs) {
+      std::cout << runId << "  started " << FormatRunId(runId) << "  " << run.segments << " segments, " << run.records
+                << " records";
+      if (run.firstTime && run.lastTime) {
+        std::cout << ", " << static_cast<double>(run.lastTime.value() - run.firstTime.value()) * 1e-9 << "s";
+      }
+      std::cout << '\n';
+    }
+  }
+
+  std::optional<FlightRecorder::FieldType> ParseType(const std::string& name) {
+    for (auto type = static_cast<int>(FlightRecorder::FieldType::kBool);
+         type <= static_cast<int>(FlightRecorder::FieldType::kF64);
+         ++type) {
+      if (name == FlightRecorder::TypeName(static_cast<FlightRecorder::FieldType>(type))) {
+        return static_cast<FlightRecorder::FieldType>(type);
+      }
+    }
+    return std::nullopt;
+  }
+
+  /// @brief Columns described by a segment's metadata, or std::nullopt if it cannot be parsed
+  std::optional<std::vector<Column>> ReadColumns(std::ifstream& stream, const SegmentHeader& header) {
+    std::vector<uint8_t> cbor(header.metadataSize);
+    if (!stream.seekg(sizeof(SegmentHeader)) || !stream.read(reinterpret_cast<char*>(cbor.data()), cbor.size())) {
+      return std::nullopt;
+    }
+    const auto metadata = CborReader{cbor}.Read();
+    if (!metadata) {
+      return std::nullopt;
+    }
+    std::vector<Column> columns;
+    try {
+      for (const auto& field : metadata.value().at("fields")) {
+        const auto type = ParseType(field.at("type").get<std::string>());
+        const auto name = field.at("name").get<std::string>();
+        const auto offset = field.at("offset").get<std::size_t>();
+        const auto count = field.at("count").get<std::size_t>();
+        if (!type || offset + count * FlightRecorder::TypeSize(type.value()) > header.recordSize) {
+          return std::nullopt;
+        }
+        for (std::size_t element = 0; element < count; ++element) {
+          columns.push_back(
+              Column{.name = count == 1 ? name : name + '[' + std::to_string(element) + ']',
+                     .type = type.value(),
+                     .offset = offset + element * FlightRecorder::TypeSize(type.value())});
+        }
+      }
+    } catch (const wpi::json::exception&) {
+      return std::nullopt;
+    }
+    return columns;
+  }
+
+  template <class T>
+  void AppendNumber(std::string& row, const uint8_t* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    char text[32];
+    // Shortest text that reads back as the same value
+    const auto end = std::to_chars(text, text + sizeof(text), value).ptr;
+    row.append(text, end);
+  }
+
+  void AppendValue(std::string& row, const FlightRecorder::FieldType type, const uint8_t* data) {
+    using FieldType = FlightRecorder::FieldType;
+    switch (type) {
+      case FieldType::kBool:
+        row += *data != 0 ? '1' : '0';
+        break;
+      case FieldType::kU8:
+        AppendNumber<uint8_t>(row, data);
+        break;
+      case FieldType::kU16:
+        AppendNumber<uint16_t>(row, data);
+        break;
+      case FieldType::kU32:
+        AppendNumber<uint32_t>(row, data);
+        break;
+      case FieldType::kU64:
+        AppendNumber<uint64_t>(row, data);
+        break;
+      case FieldType::kI8:
+        AppendNumber<int8_t>(row, data);
+        break;
+      case FieldType::kI16:
+        AppendNumber<int16_t>(row, data);
+        break;
+      case FieldType::kI32:
+        AppendNumber<int32_t>(row, data);
+        break;
+      case FieldType::kI64:
+        AppendNumber<int64_t>(row, data);
+        break;
+      case FieldType::kF32:
+        AppendNumber<float>(row, data);
+        break;
+      case FieldType::kF64:
+        AppendNumber<double>(row, data);
+        break;
+    }
+  }
+
+  /// @return false if a segment of the run could not be decoded
+  bool DecodeRun(const std::vector<Segment>& segments, const int64_t runId) {
+    bool intact = true;
+    std::optional<std::vector<Column>> columns;
+    std::optional<uint64_t> previousSequence;
+    for (const auto& segment : segments) {
+      if (segment.header.runId != runId) {
+        continue;
+      }
+      if (previousSequence && segment.header.sequence != previousSequence.value() + 1) {
+        std::cerr << "[WARNING] Segments " << previousSequence.value() + 1 << " to " << segment.header.sequence - 1
+                  << " of this run have been overwritten\n";
+      }
+      previousSequence = segment.header.sequence;
+
+      std::ifstream stream(segment.path, std::ios::binary);
+      const auto segmentColumns = ReadColumns(stream, segment.header);
+      if (!segmentColumns) {
+        std::cerr << "[ERROR] Could not read the layout of " << segment.path << '\n';
+        intact = false;
+        continue;
+      }
+      if (!columns) {
+        columns = segmentColumns;
+        std::string header;
+        for (const auto& column : columns.value()) {
+          header += (header.empty() ? "" : ",") + column.name;
+        }
+        std::cout << header << '\n';
+      }
+
+      const auto recordCount = std::min(segment.header.recordCount, segment.header.capacity);
+      std::vector<uint8_t> record(segment.header.recordSize);
+      std::string row;
+      stream.seekg(segment.header.headerSize);
+      for (uint64_t i = 0; i < recordCount; ++i) {
+        if (!stream.read(reinterpret_cast<char*>(record.data()), record.size())) {
+          std::cerr << "[ERROR] " << segment.path << " is truncated\n";
+          intact = false;
+          break;
+        }
+        row.clear();
+        for (const auto& column : columns.value()) {
+          if (!row.empty()) {
+            row += ',';
+          }
+          AppendValue(row, column.type, record.data() + column.offset);
+        }
+        std::cout << row << '\n';
+      }
+    }
+    return intact;
+  }
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << usage;
+    return 2;
+  }
+  const std::filesystem::path directory{argv[1]};
+  const std::string_view option = argc > 2 ? argv[2] : "";
+
+  const auto segments = ReadSegments(directory);
+  if (segments.empty()) {
+    std::cerr << "No flight recorder segments in " << directory << '\n';
+    return 1;
+  }
+
+  if (option == "--list") {
+    ListRuns(segments, ReadIndex(directory));
+    return 0;
+  }
+
+  // Latest run by default
+  int64_t runId = segments.back().header.runId;
+  if (option == "--run" && argc > 3) {
+    runId = std::strtoll(argv[3], nullptr, 10);
+  } else if (!option.empty()) {
+    std::cerr << usage;
+    return 2;
+  }
+  if (std::none_of(segments.begin(), segments.end(), [runId](const Segment& segment) {
+        return segment.header.runId == runId;
+      })) {
+    std::cerr << "No run " << runId << " in " << directory << '\n';
+    return 1;
+  }
+  return DecodeRun(segments, runId) ? 0 : 1;
+}
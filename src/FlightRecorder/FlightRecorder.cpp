@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FlightRecorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+  using namespace flightRecorderFormat;
+
+  constexpr std::size_t RoundUpToPage(const std::size_t size) {
+    return (size + pageSize - 1) / pageSize * pageSize;
+  }
+
+  /**
+   * @brief Open or create path with size bytes allocated on disk and map it shared.  Pages are faulted in and, where
+   *        permitted, locked so writing a record never waits for the disk
+   *
+   * @param created Set when the file was created or was the wrong size.  Its contents are then zero
+   * @return nullptr on failure
+   */
+  std::byte* MapFile(const std::filesystem::path& path, const std::size_t size, bool& created) {
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+      close(fd);
+      return nullptr;
+    }
+    created = static_cast<std::size_t>(status.st_size) != size;
+    if (created && ftruncate(fd, 0) != 0) {
+      close(fd);
+      return nullptr;
+    }
+    // Reserve the blocks now rather than when the kernel first writes a page back.  Some filesystems cannot
+    if (const int error = posix_fallocate(fd, 0, static_cast<off_t>(size));
+        error != 0 && (error != EOPNOTSUPP || ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+      close(fd);
+      return nullptr;
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+      return nullptr;
+    }
+    // Without CAP_IPC_LOCK this fails beyond RLIMIT_MEMLOCK; MAP_POPULATE still covers the usual case
+    mlock(address, size);
+    return static_cast<std::byte*>(address);
+  }
+
+  template <class T>
+  std::atomic_ref<T> Atomic(T& value) {
+    return std::atomic_ref<T>{value};
+  }
+}  // namespace
+
+std::unique_ptr<FlightRecorder> FlightRecorder::Create(const std::filesystem::path& directory,
+                                                       const std::size_t recordSize,
+                                                       const std::span<const Field> fields,
+                                                       const wpi::json& runMetadata,
+                                                       const Settings& settings) {
+  if (recordSize == 0 || settings.segmentCount == 0 || settings.recordsPerSegment == 0) {
+    return nullptr;
+  }
+
+  const int64_t runId =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  wpi::json layout = wpi::json::array();
+  for (const auto& field : fields) {
+    if (field.offset + TypeSize(field.type) * field.count > recordSize) {
+      return nullptr;
+    }
+    layout.push_back(wpi::json{{"name", field.name},
+                               {"type", TypeName(field.type)},
+                               {"offset", field.offset},
+                               {"count", field.count}});
+  }
+  const wpi::json metadata{{"recordSize", recordSize}, {"runId", runId}, {"fields", layout}, {"run", runMetadata}};
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    return nullptr;
+  }
+
+  std::unique_ptr<FlightRecorder> recorder{
+      new FlightRecorder(directory, recordSize, settings.recordsPerSegment, wpi::json::to_cbor(metadata), runId)};
+
+  const std::size_t indexSize = sizeof(IndexHeader) + settings.segmentCount * sizeof(flightRecorderFormat::IndexEntry);
+  bool indexCreated = false;
+  recorder->m_index.address = MapFile(directory / indexName, indexSize, indexCreated);
+  if (!recorder->m_index.address) {
+    return nullptr;
+  }
+  recorder->m_index.size = indexSize;
+  auto& indexHeader = *reinterpret_cast<IndexHeader*>(recorder->m_index.address);
+  if (indexCreated || indexHeader.magic != indexMagic || indexHeader.version != version) {
+    std::memset(recorder->m_index.address, 0, indexSize);
+    indexHeader.magic = indexMagic;
+    indexHeader.version = version;
+    indexHeader.segmentCount = static_cast<uint32_t>(settings.segmentCount);
+  }
+
+  const std::size_t segmentSize = recorder->m_headerSize + settings.recordsPerSegment * recordSize;
+  std::size_t newestSlot = settings.segmentCount - 1;
+  recorder->m_segments.reserve(settings.segmentCount);
+  for (std::size_t slot = 0; slot < settings.segmentCount; ++slot) {
+    bool segmentCreated = false;
+    auto* address = MapFile(directory / SegmentName(slot), segmentSize, segmentCreated);
+    if (!address) {
+      return nullptr;
+    }
+    recorder->m_segments.push_back(Mapping{.address = address, .size = segmentSize});
+
+    // Segments from earlier runs are kept, and the index rebuilt from their headers if it was lost
+    const auto& header = recorder->Header(slot);
+    auto& entry = recorder->IndexEntry(slot);
+    if (segmentCreated || header.magic != segmentMagic || header.version != version || header.sequence == 0) {
+      entry = flightRecorderFormat::IndexEntry{};
+      continue;
+    }
+    if (entry.sequence != header.sequence) {
+      entry = flightRecorderFormat::IndexEntry{.sequence = header.sequence,
+                                               .runId = header.runId,
+                                               .firstTime = 0,
+                                               .lastTime = 0,
+                                               .recordCount = header.recordCount};
+    }
+    if (header.sequence > recorder->m_sequence) {
+      recorder->m_sequence = header.sequence;
+      newestSlot = slot;
+    }
+  }
+
+  recorder->BeginSegment((newestSlot + 1) % settings.segmentCount);
+  return recorder;
+}
+
+FlightRecorder::FlightRecorder(std::filesystem::path directory,
+                               const std::size_t recordSize,
+                               const std::size_t capacity,
+                               std::vector<uint8_t> metadata,
+                               const int64_t runId)
+    : m_directory{std::move(directory)}
+    , m_recordSize{recordSize}
+    , m_capacity{capacity}
+    , m_metadata{std::move(metadata)}
+    , m_headerSize{RoundUpToPage(sizeof(SegmentHeader) + m_metadata.size())}
+    , m_runId{runId}
+    , m_segments{}
+    , m_index{.address = nullptr, .size = 0}
+    , m_slot{0}
+    , m_sequence{0}
+    , m_recordCount{0} {}
+
+FlightRecorder::~FlightRecorder() {
+  if (m_sequence != 0 && m_slot < m_segments.size()) {
+    msync(m_segments[m_slot].address, m_headerSize + m_recordCount * m_recordSize, MS_SYNC);
+  }
+  if (m_index.address) {
+    msync(m_index.address, m_index.size, MS_SYNC);
+    munmap(m_index.address, m_index.size);
+  }
+  for (const auto& segment : m_segments) {
+    munmap(segment.address, segment.size);
+  }
+}
+
+bool FlightRecorder::Append(const std::byte* record, const std::size_t size, const std::chrono::nanoseconds timestamp) {
+  if (size != m_recordSize) {
+    return false;
+  }
+  if (m_recordCount == m_capacity) {
+    BeginSegment((m_slot + 1) % m_segments.size());
+  }
+  std::memcpy(m_segments[m_slot].address + m_headerSize + m_recordCount * m_recordSize, record, size);
+  ++m_recordCount;
+  // Count only complete records, so a crash part way through a copy loses just that record
+  Atomic(Header(m_slot).recordCount).store(m_recordCount, std::memory_order_release);
+
+  auto& entry = IndexEntry(m_slot);
+  if (m_recordCount == 1) {
+    entry.firstTime = timestamp.count();
+  }
+  entry.lastTime = timestamp.count();
+  Atomic(entry.recordCount).store(m_recordCount, std::memory_order_release);
+  return true;
+}
+
+void FlightRecorder::BeginSegment(const std::size_t slot) {
+  m_slot = slot;
+  ++m_sequence;
+  m_recordCount = 0;
+
+  // Mark the slot empty until its header is complete
+  auto& header = Header(slot);
+  auto& entry = IndexEntry(slot);
+  Atomic(entry.sequence).store(0, std::memory_order_release);
+  Atomic(header.sequence).store(0, std::memory_order_release);
+  header.magic = segmentMagic;
+  header.version = version;
+  header.headerSize = static_cast<uint32_t>(m_headerSize);
+  header.recordSize = static_cast<uint32_t>(m_recordSize);
+  header.capacity = m_capacity;
+  header.runId = m_runId;
+  header.recordCount = 0;
+  header.metadataSize = static_cast<uint32_t>(m_metadata.size());
+  std::memcpy(m_segments[slot].address + sizeof(SegmentHeader), m_metadata.data(), m_metadata.size());
+  Atomic(header.sequence).store(m_sequence, std::memory_order_release);
+
+  entry.runId = m_runId;
+  entry.firstTime = 0;
+  entry.lastTime = 0;
+  entry.recordCount = 0;
+  Atomic(entry.sequence).store(m_sequence, std::memory_order_release);
+}
+
+flightRecorderFormat::SegmentHeader& FlightRecorder::Header(const std::size_t slot) const {
+  return *reinterpret_cast<SegmentHeader*>(m_segments[slot].address);
+}
+
+flightRecorderFormat::IndexEntry& FlightRecorder::IndexEntry(const std::size_t slot) const {
+  return reinterpret_cast<flightRecorderFormat::IndexEntry*>(m_index.address + sizeof(IndexHeader))[slot];
+}
+
+const char* FlightRecorder::TypeName(const FieldType type) {
+  switch (type) {
+    case FieldType::kBool:
+      return "bool";
+    case FieldType::kU8:
+      return "u8";
+    case FieldType::kU16:
+      return "u16";
+    case FieldType::kU32:
+      return "u32";
+    case FieldType::kU64:
+      return "u64";
+    case FieldType::kI8:
+      return "i8";
+    case FieldType::kI16:
+      return "i16";
+    case FieldType::kI32:
+      return "i32";
+    case FieldType::kI64:
+      return "i64";
+    case FieldType::kF32:
+      return "f32";
+    case FieldType::kF64:
+      return "f64";
+  }
+  return "";
+}
+
+std::size_t FlightRecorder::TypeSize(const FieldType type) {
+  switch (type) {
+    case FieldType::kBool:
+    case FieldType::kU8:
+    case FieldType::kI8:
+      return 1;
+    case FieldType::kU16:
+    case FieldType::kI16:
+      return 2;
+    case FieldType::kU32:
+    case FieldType::kI32:
+    case FieldType::kF32:
+      return 4;
+    case FieldType::kU64:
+    case FieldType::kI64:
+    case FieldType::kF64:
+      return 8;
+  }
+  return 0;
+}
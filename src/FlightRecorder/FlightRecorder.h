@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <wpi/json.h>
+
+#include "FlightRecorderFormat.h"
+
+/**
+ * @brief Fixed-layout binary records, typically one per control loop tick, kept in a ring of memory-mapped segment
+ *        files.
+ *
+ * Every segment is created at full size and mapped when the recorder is created, so Append() is a copy into mapped
+ * memory: it never allocates, locks or makes a system call, and the kernel writes pages back in the background.  A
+ * full segment is followed by the next slot in the ring, overwriting the oldest.  Each segment header carries a CBOR
+ * description of the record layout, so segments decode without the program that wrote them, and an index file lists
+ * the segment in each slot with its time span.  Records survive the process crashing; after a power loss the last
+ * few seconds (the kernel's write-back delay) may be missing.
+ */
+class FlightRecorder {
+ public:
+  enum class FieldType : uint8_t { kBool, kU8, kU16, kU32, kU64, kI8, kI16, kI32, kI64, kF32, kF64 };
+
+  /// @brief One record member.  Build with FLIGHT_RECORDER_FIELD()
+  struct Field {
+    const char* name;
+    FieldType type;
+    uint32_t offset;  ///< Bytes from the start of the record
+    uint32_t count;   ///< Elements, more than 1 for std::array members
+  };
+
+  struct Settings {
+    std::size_t segmentCount{16};
+    std::size_t recordsPerSegment{3000};
+  };
+
+  /**
+   * @brief Map the segment ring in directory, creating files as needed, and start a new run in the slot after the
+   *        newest segment.  Segments left by earlier runs are kept until the ring comes round to them, unless they
+   *        are a different size (a changed record layout or settings), in which case they are replaced at once
+   *
+   * @tparam Record Trivially copyable, standard layout record type
+   * @param fields Members of Record to describe in segment headers
+   * @param runMetadata Stored with the layout in every segment of this run, e.g. loop period and configuration
+   * @return nullptr if the directory or files cannot be created or mapped
+   */
+  template <class Record>
+  [[nodiscard]] static std::unique_ptr<FlightRecorder> Create(const std::filesystem::path& directory,
+                                                              std::span<const Field> fields,
+                                                              const wpi::json& runMetadata,
+                                                              const Settings& settings) {
+    static_assert(std::is_trivially_copyable_v<Record> && std::is_standard_layout_v<Record>,
+                  "Flight records are copied as bytes");
+    return Create(directory, sizeof(Record), fields, runMetadata, settings);
+  }
+  [[nodiscard]] static std::unique_ptr<FlightRecorder> Create(const std::filesystem::path& directory,
+                                                              std::size_t recordSize,
+                                                              std::span<const Field> fields,
+                                                              const wpi::json& runMetadata,
+                                                              const Settings& settings);
+
+  /// @brief Syncs the current segment and index to disk
+  ~FlightRecorder();
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  /**
+   * @brief Copy a record into the current segment, moving to the next segment when it is full
+   *
+   * @param timestamp Time of the record, kept in the index
+   * @return false if record is not the size the recorder was created with
+   */
+  template <class Record>
+  bool Append(const Record& record, const std::chrono::nanoseconds timestamp) {
+    static_assert(std::is_trivially_copyable_v<Record>, "Flight records are copied as bytes");
+    return Append(reinterpret_cast<const std::byte*>(&record), sizeof(Record), timestamp);
+  }
+
+  [[nodiscard]] const std::filesystem::path& Directory() const { return m_directory; }
+
+  /// @brief Describe a record member of arithmetic, enum or std::array type
+  template <class Member>
+  [[nodiscard]] constexpr static Field MakeField(const char* name, const std::size_t offset) {
+    if constexpr (IsArray<Member>::value) {
+      return Field{.name = name,
+                   .type = TypeOf<typename Member::value_type>(),
+                   .offset = static_cast<uint32_t>(offset),
+                   .count = static_cast<uint32_t>(std::tuple_size_v<Member>)};
+    } else {
+      return Field{.name = name, .type = TypeOf<Member>(), .offset = static_cast<uint32_t>(offset), .count = 1};
+    }
+  }
+
+  /// @brief Name of a type as written in segment metadata
+  [[nodiscard]] static const char* TypeName(FieldType type);
+  /// @brief Bytes per element
+  [[nodiscard]] static std::size_t TypeSize(FieldType type);
+
+ private:
+  /// @brief One mapped file
+  struct Mapping {
+    std::byte* address;
+    std::size_t size;
+  };
+
+  FlightRecorder(std::filesystem::path directory,
+                 std::size_t recordSize,
+                 std::size_t capacity,
+                 std::vector<uint8_t> metadata,
+                 int64_t runId);
+
+  bool Append(const std::byte* record, std::size_t size, std::chrono::nanoseconds timestamp);
+  /// @brief Reset the segment in slot for the next sequence number
+  void BeginSegment(std::size_t slot);
+
+  [[nodiscard]] flightRecorderFormat::SegmentHeader& Header(std::size_t slot) const;
+  [[nodiscard]] flightRecorderFormat::IndexEntry& IndexEntry(std::size_t slot) const;
+
+  template <class T>
+  struct IsArray : std::false_type {};
+  template <class T, std::size_t N>
+  struct IsArray<std::array<T, N>> : std::true_type {};
+
+  template <class T>
+  [[nodiscard]] constexpr static FieldType TypeOf() {
+    if constexpr (std::is_enum_v<T>) {
+      return TypeOf<std::underlying_type_t<T>>();
+    } else if constexpr (std::is_same_v<T, bool>) {
+      return FieldType::kBool;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Unsupported floating point type");
+      return sizeof(T) == 4 ? FieldType::kF32 : FieldType::kF64;
+    } else {
+      static_assert(std::is_integral_v<T>, "Flight record fields must be numbers, bools, enums or std::arrays of them");
+      constexpr std::array unsignedTypes{FieldType::kU8, FieldType::kU16, FieldType::kU32, FieldType::kU64};
+      constexpr std::array signedTypes{FieldType::kI8, FieldType::kI16, FieldType::kI32, FieldType::kI64};
+      constexpr std::size_t log2Size = sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3;
+      return std::is_signed_v<T> ? signedTypes[log2Size] : unsignedTypes[log2Size];
+    }
+  }
+
+  const std::filesystem::path m_directory;
+  const std::size_t m_recordSize;
+  const std::size_t m_capacity;           ///< Records per segment
+  const std::vector<uint8_t> m_metadata;  ///< CBOR written to each segment header
+  const std::size_t m_headerSize;         ///< Page aligned offset of the first record
+  const int64_t m_runId;
+  std::vector<Mapping> m_segments;  ///< Indexed by slot
+  Mapping m_index;
+  std::size_t m_slot;      ///< Slot being written
+  uint64_t m_sequence;     ///< Sequence number of the segment being written.  0 before the first
+  uint64_t m_recordCount;  ///< Records in the segment being written
+};
+
+/// @brief FlightRecorder::Field for Record::member
+#define FLIGHT_RECORDER_FIELD(Record, member) \
+  ::FlightRecorder::MakeField<decltype(Record::member)>(#member, offsetof(Record, member))
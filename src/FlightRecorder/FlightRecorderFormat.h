@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// @brief On-disk layout shared by FlightRecorder and the decoder.  Host byte order throughout
+namespace flightRecorderFormat {
+  constexpr uint16_t version = 1;
+
+  /// Segments are named <segmentPrefix><slot>, the index <indexName>
+  constexpr auto segmentPrefix = "segment.";
+  constexpr auto indexName = "index";
+
+  /// Header sizes are rounded up to this so records start on a page boundary
+  constexpr std::size_t pageSize = 4096;
+
+  /**
+   * @brief Start of every segment file.  Followed by metadataSize bytes of CBOR describing the record layout, then
+   *        records from offset headerSize
+   */
+  struct SegmentHeader {
+    std::array<char, 4> magic;  ///< segmentMagic
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t headerSize;    ///< Offset of the first record
+    uint32_t recordSize;    ///< Bytes per record
+    uint64_t capacity;      ///< Records the segment holds
+    uint64_t sequence;      ///< Position in the recording, counting across runs.  0 for a segment never written
+    int64_t runId;          ///< Wall clock time (ns since the epoch) the recording run started
+    uint64_t recordCount;   ///< Complete records.  Updated after each record is copied in
+    uint32_t metadataSize;  ///< CBOR bytes following this header
+    uint32_t reserved2;
+    uint64_t reserved3;
+  };
+  static_assert(sizeof(SegmentHeader) == 64, "Segment header layout is fixed");
+  constexpr std::array<char, 4> segmentMagic{'S', 'W', 'F', 'R'};
+
+  /// @brief Start of the index file.  Followed by one IndexEntry per slot
+  struct IndexHeader {
+    std::array<char, 4> magic;  ///< indexMagic
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t segmentCount;
+    uint32_t reserved2;
+  };
+  static_assert(sizeof(IndexHeader) == 16, "Index header layout is fixed");
+  constexpr std::array<char, 4> indexMagic{'S', 'W', 'F', 'I'};
+
+  /// @brief Summary of the segment in one slot, so runs can be listed without reading every segment
+  struct IndexEntry {
+    uint64_t sequence;     ///< As in SegmentHeader.  0 for an empty slot
+    int64_t runId;         ///< As in SegmentHeader
+    int64_t firstTime;     ///< Timestamp (ns) passed with the first record
+    int64_t lastTime;      ///< Timestamp (ns) passed with the latest record
+    uint64_t recordCount;  ///< As in SegmentHeader
+  };
+  static_assert(sizeof(IndexEntry) == 40, "Index entry layout is fixed");
+
+  [[nodiscard]] inline std::string SegmentName(const std::size_t slot) {
+    return segmentPrefix + std::to_string(slot);
+  }
+}  // namespace flightRecorderFormat
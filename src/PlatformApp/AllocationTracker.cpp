@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// glibc's allocator under its internal names, so the replacements below can forward to it
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+}
+
+namespace {
+  std::atomic<uint64_t> processAllocations{0};
+  // Trivially initialized, so reading it never allocates, even on a thread's first allocation
+  thread_local uint64_t threadAllocations{0};
+
+  void Count() {
+    ++threadAllocations;
+    processAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void* NewOrThrow(const std::size_t size) {
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (!pointer) {
+      throw std::bad_alloc();
+    }
+    return pointer;
+  }
+
+  void* AlignedNewOrThrow(const std::size_t size, const std::align_val_t alignment) {
+    void* pointer = aligned_alloc(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+    if (!pointer) {
+      throw std::bad_alloc();
+    }
+    return pointer;
+  }
+}  // namespace
+
+uint64_t allocationTracker::ThreadAllocations() {
+  return threadAllocations;
+}
+
+uint64_t allocationTracker::ProcessAllocations() {
+  return processAllocations.load(std::memory_order_relaxed);
+}
+
+// The malloc family is counted.  operator new allocates through it, so each allocation is counted once.  free() and
+// operator delete are left to the runtime
+extern "C" {
+void* malloc(std::size_t size) {
+  Count();
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+  Count();
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, std::size_t size) {
+  Count();
+  return __libc_realloc(pointer, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+  Count();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+  Count();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, std::size_t alignment, std::size_t size) {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  Count();
+  *pointer = __libc_memalign(alignment, size);
+  return *pointer ? 0 : ENOMEM;
+}
+}
+
+void* operator new(std::size_t size) {
+  return NewOrThrow(size);
+}
+
+void* operator new[](std::size_t size) {
+  return NewOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AlignedNewOrThrow(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AlignedNewOrThrow(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return aligned_alloc(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return aligned_alloc(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+}
@@ -0,0 +1,20 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Heap allocation counters for builds with the SWERVE_TRACK_ALLOCATIONS CMake option.  Linking
+ *        AllocationTracker.cpp replaces operator new and the malloc family for the whole process, so every heap
+ *        allocation is counted, including those made inside the C++ and C runtimes and vendor libraries.
+ */
+namespace allocationTracker {
+  /// @brief Allocations made by the calling thread since it started
+  [[nodiscard]] uint64_t ThreadAllocations();
+  /// @brief Allocations made by every thread since the process started
+  [[nodiscard]] uint64_t ProcessAllocations();
+}  // namespace allocationTracker
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "FlightRecorder.h"
+#include "SerialLineSensor.h"
+#include "SwervePlatform.h"
+
+/**
+ * @brief What PlatformApp saw and commanded in one control loop tick.  Module arrays are in
+ *        SwervePlatform::ModuleIndex order, speeds are m/s and angles degrees.  Fields may be appended or reordered
+ *        freely: each segment describes its own layout
+ */
+struct FlightRecord {
+  uint64_t tick;
+  int64_t loopTime;    ///< Tick start on hardware::Clock (ns)
+  int64_t steadyTime;  ///< Tick start on steady_clock (ns), comparable with device timestamps
+
+  std::array<double, 6> axes;  ///< ControllerInterface::AxisStates order
+  uint32_t buttons;            ///< ControllerInterface::ButtonStates mask
+  bool controllerConnected;
+  bool driveMode;
+  bool homingMode;
+  bool lineFollowRequested;
+  std::array<double, 3> driveCommand;  ///< Interpolated longitudinal, lateral and rotation commands
+
+  SwervePlatform::ModuleCommand moduleCommand;
+  SwervePlatform::LineFollowState followState;
+  SwervePlatform::LineFollowDirection followDirection;
+  SerialLineSensor::RecoveryDirection recoveryDirection;
+  std::array<double, 4> desiredSpeed;    ///< Before Optimize
+  std::array<double, 4> desiredAngle;    ///< Before Optimize
+  std::array<double, 4> optimizedSpeed;  ///< As sent to the modules
+  std::array<double, 4> optimizedAngle;  ///< As sent to the modules
+  std::array<double, 4> turnPosition;
+  std::array<int32_t, 4> turnFaults;  ///< ctre Faults bitfields
+
+  uint32_t lineSequence;                    ///< Line sensor sample sequence number, 0 before the first sample
+  float lineAge;                            ///< Seconds since the sample arrived
+  SerialLineSensor::Channels lineChannels;  ///< Proportional coverage, 0=no line, 1=full line
+  bool linePredicted;
+  std::array<double, 3> linePrediction;  ///< Lateral offset (m), heading error (rad), curvature (1/m) steered for
+
+  bool fieldCentric;
+  bool poseValid;                       ///< False until the first pose update
+  std::array<double, 3> pose;           ///< Estimated x (m), y (m), heading (degrees) since start, Y left
+  std::array<double, 3> poseStdDev;     ///< Standard deviations of pose
+  std::array<double, 3> odometryTwist;  ///< Forward (m/s), left (m/s), yaw rate (degrees/s)
+  double imuYaw;                        ///< Raw gyro yaw (degrees)
+  double kinematicResidual;             ///< Module velocity disagreement with the odometry twist (m/s)
+};
+
+constexpr std::array flightRecordFields{FLIGHT_RECORDER_FIELD(FlightRecord, tick),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, loopTime),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, steadyTime),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, axes),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, buttons),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, controllerConnected),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, driveMode),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, homingMode),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, lineFollowRequested),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, driveCommand),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, moduleCommand),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, followState),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, followDirection),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, recoveryDirection),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, desiredSpeed),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, desiredAngle),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, optimizedSpeed),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, optimizedAngle),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, turnPosition),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, turnFaults),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, lineSequence),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, lineAge),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, lineChannels),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, linePredicted),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, linePrediction),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, fieldCentric),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, poseValid),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, pose),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, poseStdDev),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, odometryTwist),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, imuYaw),
+                                       FLIGHT_RECORDER_FIELD(FlightRecord, kinematicResidual)};
@@ -5,11 +5,16 @@
 
 #include "PlatformApp.h"
 
-#include "ctre/phoenix/platform/Platform.h"
-#include "ctre/phoenix/unmanaged/Unmanaged.h"
 #include "SerialLineSensor.h"
+#include "SwervePlatformHardware.h"
 #include "SwervePlatformHomingStorage.h"
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unistd.h>
 #include <signal.h>
 #include <thread>
@@ -22,15 +27,15 @@ bool shutdown = false;
 
 TimedDebounce::TimedDebounce(units::second_t activationTime, units::second_t deactivationTime)
     : m_activeVal{false}
-    , m_changeTime{std::chrono::steady_clock::now()}
+    , m_changeTime{hardware::Clock::now()}
     , m_activationTime{activationTime}
     , m_deactivationTime{deactivationTime} {};
 
-bool TimedDebounce::operator()(const bool newValue) {
+bool TimedDebounce::operator()(const bool newValue, const hardware::TickContext& tick) {
   if (newValue == m_activeVal) {
-    m_changeTime = std::chrono::steady_clock::now();
+    m_changeTime = tick.time;
   } else {
-    const std::chrono::duration<float> duration = std::chrono::steady_clock::now() - m_changeTime;
+    const std::chrono::duration<float> duration = tick.time - m_changeTime;
     if ((m_activeVal && duration.count() >= m_deactivationTime.to<float>()) ||
         (!m_activeVal && duration.count() >= m_activationTime.to<float>())) {
       m_activeVal = newValue;
@@ -39,6 +44,94 @@ bool TimedDebounce::operator()(const bool newValue) {
   return m_activeVal;
 }
 
+namespace {
+  /// @brief Base for per-user files: HOME, or the working directory if HOME is unset (e.g. under a systemd unit)
+  std::filesystem::path HomeDirectory() {
+    const char* home = std::getenv("HOME");
+    return std::filesystem::path{home ? home : "."};
+  }
+
+  /// @brief Fill the platform and line sensor part of a flight record from the state left by this tick's command
+  void RecordPlatformState(FlightRecord& record,
+                           const SwervePlatform& swervePlatform,
+                           const SerialLineSensor& lineSensor,
+                           const hardware::TickContext& tick) {
+    const auto& command = swervePlatform.LastCommand();
+    record.moduleCommand = command.command;
+    record.followState = swervePlatform.GetLineFollowState();
+    record.followDirection = swervePlatform.GetLineFollowDirection();
+    for (std::size_t module = 0; module < command.desired.size(); ++module) {
+      record.desiredSpeed[module] = command.desired[module].speed.to<double>();
+      record.desiredAngle[module] = command.desired[module].angle.Degrees().to<double>();
+      record.optimizedSpeed[module] = command.optimized[module].speed.to<double>();
+      record.optimizedAngle[module] = command.optimized[module].angle.Degrees().to<double>();
+      record.turnPosition[module] = command.turnPosition[module].to<double>();
+      record.turnFaults[module] = command.turnFaults[module];
+    }
+    record.linePredicted = command.linePrediction.has_value();
+    if (command.linePrediction) {
+      record.linePrediction = {command.linePrediction.value().lateralOffset,
+                               command.linePrediction.value().headingError,
+                               command.linePrediction.value().curvature};
+    }
+
+    const auto sensorSnapshot = lineSensor.GetSnapshot();
+    record.lineSequence = sensorSnapshot.sequence;
+    if (sensorSnapshot.sequence != 0) {
+      record.lineAge = std::chrono::duration<float>(tick.steadyTime - sensorSnapshot.updateTime).count();
+    }
+    record.lineChannels = sensorSnapshot.proportional;
+    record.recoveryDirection = lineSensor.GetRecoveryDirection(sensorSnapshot, tick.steadyTime);
+
+    const auto& pose = swervePlatform.LastPose();
+    record.fieldCentric = swervePlatform.GetControlMode() == SwervePlatform::ControlMode::fieldCentric;
+    record.poseValid = pose.estimate.has_value();
+    if (pose.estimate) {
+      const auto& estimate = pose.estimate.value();
+      record.pose = {
+          estimate.pose.x, estimate.pose.y, units::degree_t{units::radian_t{estimate.pose.heading}}.to<double>()};
+      record.poseStdDev = {estimate.stdDev.x,
+                           estimate.stdDev.y,
+                           units::degree_t{units::radian_t{estimate.stdDev.heading}}.to<double>()};
+    }
+    record.odometryTwist = {
+        pose.twist.vx, pose.twist.vy, units::degree_t{units::radian_t{pose.twist.omega}}.to<double>()};
+    record.imuYaw = pose.imuYaw;
+    record.kinematicResidual = pose.kinematicResidual.to<double>();
+  }
+
+  /// @brief Start streaming telemetry to the host[:port] named by telemetryConfig::targetVariable, if set
+  std::unique_ptr<TelemetryPublisher> StartTelemetry() {
+    const char* target = std::getenv(telemetryConfig::targetVariable);
+    if (!target) {
+      return nullptr;
+    }
+    TelemetryPublisher::Settings settings{.host = target,
+                                          .port = telemetryProtocol::defaultPort,
+                                          .sampleRate = telemetryConfig::defaultRate,
+                                          .batchPeriod = telemetryConfig::batchPeriod,
+                                          .schemaPeriod = telemetryConfig::schemaPeriod,
+                                          .queueCapacity = telemetryConfig::queueCapacity};
+    // A single colon separates the port; more than one is a bare IPv6 address
+    if (const auto colon = settings.host.find(':');
+        colon != std::string::npos && settings.host.find(':', colon + 1) == std::string::npos) {
+      settings.port = static_cast<uint16_t>(std::atoi(settings.host.c_str() + colon + 1));
+      settings.host.resize(colon);
+    }
+    if (const char* rate = std::getenv(telemetryConfig::rateVariable); rate) {
+      settings.sampleRate = std::atof(rate);
+    }
+    auto publisher = TelemetryPublisher::Create(telemetrySignals, settings);
+    if (!publisher) {
+      std::cout << "[ERROR] Could not start telemetry to " << target << '\n';
+    } else {
+      std::cout << "Streaming telemetry to " << settings.host << ':' << settings.port << " at " << settings.sampleRate
+                << " Hz\n";
+    }
+    return publisher;
+  }
+}  // namespace
+
 void signal_callback_handler(int signum) {
   std::cout << "Caught signal " << signum << '\n';
   // Terminate program
@@ -46,11 +139,39 @@ void signal_callback_handler(int signum) {
 }
 
 int main(int /*argc*/, char** /*argv*/) {
+  ArgosLib::StartLogWriter();
+
   // Register signal and signal handler]
   signal(SIGINT, signal_callback_handler);
   signal(SIGTERM, signal_callback_handler);
 
-  XBoxController controller(0);
+  std::unique_ptr<ControllerInterface> pController;
+  ControllerReplay<hardware::Clock>* pReplay = nullptr;
+  if (const char* replayFile = std::getenv(controllerConfig::replayFileVariable); replayFile) {
+    auto playback = ControllerPlayback::Load(replayFile);
+    if (!playback) {
+      std::cout << "[ERROR] Could not read controller recording " << replayFile << '\n';
+      return 1;
+    }
+    std::cout << "Replaying " << std::chrono::duration<double>(playback.value().Duration()).count()
+              << "s of controller input from " << replayFile << '\n';
+    auto pControllerReplay = std::make_unique<ControllerReplay<hardware::Clock>>(std::move(playback.value()));
+    pReplay = pControllerReplay.get();
+    pController = std::move(pControllerReplay);
+  } else {
+    auto backend = controllerConfig::backend;
+    if (const char* backendName = std::getenv(controllerConfig::backendVariable);
+        backendName && std::string_view{backendName} == "evdev") {
+      backend = XBoxController::Backend::kEvdev;
+    }
+    auto pXBoxController = std::make_unique<XBoxController>(controllerConfig::index, backend);
+    if (const char* recordFile = std::getenv(controllerConfig::recordFileVariable);
+        recordFile && !pXBoxController->StartRecording(recordFile)) {
+      std::cout << "[ERROR] Could not create controller recording " << recordFile << '\n';
+    }
+    pController = std::move(pXBoxController);
+  }
+  ControllerInterface& controller = *pController;
 
   SwervePlatform swervePlatform(dimensions,
                                 4_fps,
@@ -67,68 +188,148 @@ int main(int /*argc*/, char** /*argv*/) {
                                 sensorConfig::drive::frontLeftTurn{},
                                 sensorConfig::drive::frontRightTurn{},
                                 sensorConfig::drive::rearRightTurn{},
-                                sensorConfig::drive::rearLeftTurn{});
+                                sensorConfig::drive::rearLeftTurn{},
+                                sensorConfig::imu{});
+
+#ifdef SWERVE_SIMULATED_HARDWARE
+  PlatformSimulator::Parameters simulatorParams;
+  if (const char* realTimeFactor = std::getenv(simulatorConfig::realTimeFactorVariable); realTimeFactor) {
+    simulatorParams.realTimeFactor = std::atof(realTimeFactor);
+  }
+  simulatorParams.imuAddress = sensorConfig::imu::address;
+  PlatformSimulator simulator(dimensions, simulatorConfig::moduleAddresses, simulatorParams);
+#endif
 
-  const interpolationMap<decltype(joystickAxisMaps::driveLongSpeed.front().inVal),
-                         joystickAxisMaps::driveLongSpeed.size()>
+  constexpr interpolationMap<decltype(joystickAxisMaps::driveLongSpeed.front().inVal),
+                             joystickAxisMaps::driveLongSpeed.size()>
       driveMapLon(joystickAxisMaps::driveLongSpeed);
-  const interpolationMap<decltype(joystickAxisMaps::driveLatSpeed.front().inVal),
-                         joystickAxisMaps::driveLatSpeed.size()>
+  constexpr interpolationMap<decltype(joystickAxisMaps::driveLatSpeed.front().inVal),
+                             joystickAxisMaps::driveLatSpeed.size()>
       driveMapLat(joystickAxisMaps::driveLatSpeed);
-  const interpolationMap<decltype(joystickAxisMaps::driveRotSpeed.front().inVal),
-                         joystickAxisMaps::driveRotSpeed.size()>
+  constexpr interpolationMap<decltype(joystickAxisMaps::driveRotSpeed.front().inVal),
+                             joystickAxisMaps::driveRotSpeed.size()>
       driveMapRot(joystickAxisMaps::driveRotSpeed);
 
   TimedDebounce homingModeDebounce(2_s, 0_s);
   TimedDebounce homingCalDebounce(1_s, 0_s);
 
-  static bool driveMode = false;
-  static bool calMode = false;
-  static bool calTrigger = false;
+  using Button = ControllerInterface::Button;
+  ControllerInterface::ButtonEdges buttons;
+  bool driveMode = false;
+  bool homingMode = false;       // Homing mode debounce output on the previous tick
+  bool homingTriggered = false;  // Homing calibration debounce output on the previous tick
 
-  SerialLineSensor lineSensor{std::chrono::milliseconds(100)};
+  SerialLineSensor lineSensor{sensorConfig::lineSensor::timeout, sensorConfig::lineSensor::filter};
+  const std::filesystem::path lineSensorCalibrationFile =
+      HomeDirectory() / sensorConfig::lineSensor::calibrationFile;
+  if (!lineSensor.LoadCalibration(lineSensorCalibrationFile)) {
+    std::cout << "Line sensor calibration not found, using defaults\n";
+  }
+  lineSensor.SaveCalibrationOnChange(lineSensorCalibrationFile, sensorConfig::lineSensor::calibrationSaveInterval);
+
+  const auto flightRecorder = FlightRecorder::Create<FlightRecord>(
+      HomeDirectory() / flightRecorderConfig::directory,
+      flightRecordFields,
+      wpi::json{{"application", "PlatformApp"},
+                {"loopPeriod", controlLoop::main::period.to<double>()},
+#ifdef SWERVE_SIMULATED_HARDWARE
+                {"simulatedHardware", true},
+#else
+                {"simulatedHardware", false},
+#endif
+                {"lineChannelPositions", measureUp::lineSensor::channelPositions}},
+      flightRecorderConfig::settings);
+  if (!flightRecorder) {
+    std::cout << "[ERROR] Could not create flight recorder in " << flightRecorderConfig::directory << '\n';
+  }
 
+  const auto telemetry = StartTelemetry();
+  const hardware::CanBusMonitor canBusMonitor{canInterfaceName, canBusConfig::bitRate, canBusConfig::utilizationPeriod};
+
+  const std::chrono::milliseconds loopPeriod{controlLoop::main::period.to<int>()};
+  uint64_t tickIndex = 0;
+  std::optional<hardware::Clock::time_point> previousTickTime;
+  hardware::Clock::duration previousWork{0};  // Time the previous tick spent before sleeping
+#ifdef SWERVE_TRACK_ALLOCATIONS
+  const auto allocationWarmupTicks =
+      static_cast<uint64_t>((controlLoop::main::allocationWarmup / controlLoop::main::period).to<double>());
+  uint64_t allocatingTicks = 0;
+  uint64_t loopAllocations = 0;
+#endif
   while (!shutdown) {
+    // Everything below evaluates against this one reading of the clocks
+    const auto tick = hardware::TickContext::Begin(tickIndex++, loopPeriod);
+#ifdef SWERVE_TRACK_ALLOCATIONS
+    const auto tickStartAllocations = allocationTracker::ThreadAllocations();
+#endif
+    if (pReplay && pReplay->Finished()) {
+      std::cout << "Controller recording finished\n";
+      break;
+    }
     /// @todo robot mode management
-    ctre::phoenix::unmanaged::Unmanaged::FeedEnable(controlLoop::main::timeout.to<int>());
+    hardware::FeedEnable(controlLoop::main::timeout.to<int>());
+    swervePlatform.UpdatePose(tick);
     auto controllerState = controller.CurrentState();
 
+    FlightRecord record{};
+    record.tick = tick.index;
+    record.loopTime = std::chrono::nanoseconds{tick.time.time_since_epoch()}.count();
+    record.steadyTime = std::chrono::nanoseconds{tick.steadyTime.time_since_epoch()}.count();
+    record.controllerConnected = controllerState.has_value();
+
     // Error with controller, stop platform
     if (!controllerState) {
-      printf("No controller\n");
+      ARGOS_LOG_EVERY(std::chrono::seconds{1}, ArgosLib::LogLevel::kWarning, "No controller");
       swervePlatform.Stop();
+      buttons.Update(ControllerInterface::ButtonStates{});
       driveMode = false;
     } else {
       // std::cerr << controllerState.value() << '\n';
-      if (homingModeDebounce(controllerState.value().Buttons.LT && controllerState.value().Buttons.RT &&
-                             !controllerState.value().Buttons.RB && !driveMode)) {
-        if (!calMode) {
-          homingCalDebounce(false);  // Don't activate immediately
-          calMode = true;
+      buttons.Update(controllerState.value().Buttons);
+      const auto& axes = controllerState.value().Axes;
+      const auto [driveLon, driveLat, driveRot] =
+          map3(driveMapLon, driveMapLat, driveMapRot, {axes.LeftY, axes.LeftX, axes.RightX});
+      record.buttons = controllerState.value().Buttons.mask;
+      record.axes = {axes.LeftX, axes.LeftY, axes.LT, axes.RT, axes.RightX, axes.RightY};
+      record.driveCommand = {driveLon, driveLat, driveRot};
+
+      const bool homingRequested = homingModeDebounce(buttons.Held(Button::kLT) && buttons.Held(Button::kRT) &&
+                                                      !buttons.Held(Button::kRB) && !driveMode,
+                                                      tick);
+      if (homingRequested && !homingMode) {
+        homingCalDebounce(false, tick);  // Don't activate immediately
+      }
+      homingMode = homingRequested;
+      if (homingMode) {
+        const bool homingCal = homingCalDebounce(buttons.Held(Button::kA), tick);
+        if (homingCal && !homingTriggered) {
+          // swervePlatform.Home(0_deg);
         }
-        if (homingCalDebounce(controllerState.value().Buttons.A)) {
-          if (!calTrigger) {
-            calTrigger = true;
-            // swervePlatform.Home(0_deg);
-          }
+        homingTriggered = homingCal;
+        if (homingCal && swervePlatform.HomeSaveFailed()) {
+          controller.SetVibration(ArgosLib::VibrationSyncPulse(250_ms, 1.0));
+        } else if (homingCal) {
           controller.SetVibration(ArgosLib::VibrationConstant(0.5));
         } else {
-          calTrigger = false;
           controller.SetVibration(ArgosLib::VibrationAlternatePulse(1_s, 0.0, 1.0));
         }
-      } else {
-        calMode = false;
       }
 
-      if (controllerState.value().Buttons.RB) {
+      if (!homingMode && buttons.Pressed(Button::kStart)) {
+        // Field forward is wherever the platform faces now
+        swervePlatform.SetFieldOrientation(0_deg);
+        swervePlatform.SetControlMode(SwervePlatform::ControlMode::fieldCentric);
+      } else if (!homingMode && buttons.Pressed(Button::kBack)) {
+        swervePlatform.SetControlMode(SwervePlatform::ControlMode::robotCentric);
+      }
+
+      if (buttons.Held(Button::kRB)) {
         bool active = true;
         if (!driveMode) {
-          if (driveMapLon.map(controllerState.value().Axes.LeftY) == 0 &&
-              driveMapLat.map(controllerState.value().Axes.LeftX) == 0 &&
-              driveMapRot.map(controllerState.value().Axes.RightX) == 0 && !controllerState.value().Buttons.DUp &&
-              !controllerState.value().Buttons.DDown) {
+          if (driveLon == 0 && driveLat == 0 && driveRot == 0 && !buttons.Held(Button::kDUp) &&
+              !buttons.Held(Button::kDDown)) {
             // Vibration pulse to indicate drive mode activated
-            controller.SetVibration(0.3, 0.3, 500ms);
+            controller.SetVibration(0.3, 0.3, tick.steadyTime + 500ms);
             driveMode = true;
           } else {
             // Require 0 input before activating drive.  Vibrate to indicate error
@@ -136,20 +337,16 @@ int main(int /*argc*/, char** /*argv*/) {
             active = false;
           }
         }
-        if (active && !controllerState.value().Buttons.LB) {
-          swervePlatform.SwerveDrive(driveMapLon.map(controllerState.value().Axes.LeftY),
-                                     driveMapLat.map(controllerState.value().Axes.LeftX),
-                                     driveMapRot.map(controllerState.value().Axes.RightX));
+        if (active && !buttons.Held(Button::kLB)) {
+          swervePlatform.SwerveDrive(driveLon, driveLat, driveRot);
         } else if (active) {
-          swervePlatform.LineFollow(controllerState.value().Buttons.DUp,
-                                    controllerState.value().Buttons.DDown,
-                                    lineSensor.GetProportionalArrayStatus(),
-                                    lineSensor);
+          record.lineFollowRequested = true;
+          swervePlatform.LineFollow(tick, buttons.Held(Button::kDUp), buttons.Held(Button::kDDown), lineSensor);
         } else {
           swervePlatform.Stop();
         }
       } else {
-        if (!calMode) {
+        if (!homingMode) {
           // Prevent sticky cal mode vibration
           controller.SetVibration(0.0, 0.0);
         }
@@ -158,6 +355,43 @@ int main(int /*argc*/, char** /*argv*/) {
       }
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(controlLoop::main::period.to<int>()));
+    record.driveMode = driveMode;
+    record.homingMode = homingMode;
+    RecordPlatformState(record, swervePlatform, lineSensor, tick);
+    if (flightRecorder) {
+      flightRecorder->Append(record, tick.steadyTime.time_since_epoch());
+    }
+    if (telemetry) {
+      const auto values = TelemetryValues(record,
+                                          previousTickTime ? tick.time - previousTickTime.value() : loopPeriod,
+                                          previousWork,
+                                          canBusMonitor.Utilization());
+      telemetry->Publish(tick.index, tick.steadyTime, values);
+    }
+    previousTickTime = tick.time;
+
+#ifdef SWERVE_TRACK_ALLOCATIONS
+    if (const auto allocations = allocationTracker::ThreadAllocations() - tickStartAllocations;
+        allocations > 0 && tick.index >= allocationWarmupTicks) {
+      ++allocatingTicks;
+      loopAllocations += allocations;
+      ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Tick {} allocated {} times", tick.index, allocations);
+    }
+#endif
+
+    // Sleep to the deadline rather than a whole period so time spent in the loop does not stretch it
+    const auto remaining = tick.Remaining();
+    // Saturates at the period when the tick overruns; the next tick's period shows by how much
+    previousWork = tick.deadline - tick.time - remaining;
+    hardware::SleepFor(remaining);
+  }
+
+#ifdef SWERVE_TRACK_ALLOCATIONS
+  std::cout << "Control loop: " << allocatingTicks << " of " << tickIndex - std::min(tickIndex, allocationWarmupTicks)
+            << " ticks after warm-up allocated, " << loopAllocations << " allocations.  Whole process: "
+            << allocationTracker::ProcessAllocations() << " allocations\n";
+  if (allocatingTicks > 0) {
+    return 1;
   }
+#endif
 }
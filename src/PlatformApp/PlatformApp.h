@@ -5,14 +5,41 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
+
+#include <units/current.h>
 #include <units/voltage.h>
 #include <units/length.h>
 #include <units/time.h>
 
+#include "ctre/phoenix/motorcontrol/FeedbackDevice.h"
+#include "ctre/phoenix/motorcontrol/InvertType.h"
+#include "ctre/phoenix/motorcontrol/LimitSwitchType.h"
+#include "ctre/phoenix/motorcontrol/NeutralMode.h"
+#include "ctre/phoenix/motorcontrol/RemoteSensorSource.h"
+#include "ctre/phoenix/sensors/AbsoluteSensorRange.h"
+#include "ctre/phoenix/sensors/SensorInitializationStrategy.h"
+
+#include "CanBusMonitor.h"
+#include "ControllerRecording.h"
+#include "FlightRecord.h"
+#include "FlightRecorder.h"
+#include "SerialLineSensor.h"
 #include "SwervePlatform.h"
+#include "SwervePlatformHardware.h"
+#include "TelemetrySignals.h"
 #include "XBoxController.h"
+#include "argosLib/general/asyncLog.h"
 #include "argosLib/general/interpolation.h"
 
+#ifdef SWERVE_SIMULATED_HARDWARE
+#include "PlatformSimulator.h"
+#endif
+#ifdef SWERVE_TRACK_ALLOCATIONS
+#include "AllocationTracker.h"
+#endif
+
 constexpr SwervePlatform::PlatformDimensions dimensions{
     .platformLateralWidth = 48_in,
     .platformLongitudinalLength = 96_in,
@@ -25,6 +52,8 @@ namespace controlLoop {
   namespace main {
     constexpr units::millisecond_t timeout = 100_ms;
     constexpr units::millisecond_t period = 20_ms;
+    /// Start-up time excluded from allocation tracking (SWERVE_TRACK_ALLOCATIONS builds)
+    constexpr units::second_t allocationWarmup = 1_s;
   }  // namespace main
   namespace drive {
     namespace drive {
@@ -68,8 +97,47 @@ namespace joystickAxisMaps {
                                      interpMapPoint{1.0, 1.0}};
 }  // namespace joystickAxisMaps
 
+namespace controllerConfig {
+  constexpr int index = 0;
+  constexpr auto backend = XBoxController::Backend::kSDL;
+  /// Environment variable selecting the controller backend.  "evdev" reads the controller's event node directly,
+  /// anything else uses backend.  Make evdev the default once it has been checked against a real controller
+  constexpr auto backendVariable = "SWERVE_CONTROLLER_BACKEND";
+  /// Environment variable naming a file to record controller input to
+  constexpr auto recordFileVariable = "SWERVE_CONTROLLER_RECORD";
+  /// Environment variable naming a recording to drive from instead of the controller.  The run ends with the
+  /// recording.  In simulated builds replay follows simulated time, so SWERVE_SIM_REALTIME_FACTOR=0 replays as fast
+  /// as possible
+  constexpr auto replayFileVariable = "SWERVE_CONTROLLER_REPLAY";
+}  // namespace controllerConfig
+
 constexpr static auto canInterfaceName = "can0";
 
+namespace canBusConfig {
+  constexpr double bitRate = 1'000'000;
+  constexpr std::chrono::milliseconds utilizationPeriod{200};
+}  // namespace canBusConfig
+
+namespace flightRecorderConfig {
+  /// Segment ring for FlightRecord, relative to HOME.  Decode with FlightLogDecoder
+  constexpr char directory[] = ".local/share/Swerve-Platform/flightRecorder";
+  /// One minute per segment, the last 30 minutes kept
+  constexpr FlightRecorder::Settings settings{.segmentCount = 30, .recordsPerSegment = 3000};
+}  // namespace flightRecorderConfig
+
+namespace telemetryConfig {
+  /// Environment variable naming the host[:port] to stream telemetry to, e.g. a laptop or a broadcast address.  No
+  /// telemetry is sent when it is unset.  Watch with TelemetryReceiver
+  constexpr auto targetVariable = "SWERVE_TELEMETRY_TARGET";
+  /// Environment variable overriding the sample rate (Hz)
+  constexpr auto rateVariable = "SWERVE_TELEMETRY_RATE";
+  constexpr double defaultRate = 25;
+  constexpr std::chrono::milliseconds batchPeriod{100};
+  constexpr std::chrono::milliseconds schemaPeriod{1000};
+  /// Ten seconds of samples at the default rate, so a stalled sender never costs the loop anything
+  constexpr std::size_t queueCapacity = 256;
+}  // namespace telemetryConfig
+
 namespace sensorConfig {
   namespace drive {
     struct frontLeftTurn {
@@ -101,6 +169,23 @@ namespace sensorConfig {
       constexpr static auto magOffset = 0;
     };
   }  // namespace drive
+  struct imu {
+    constexpr static auto address = 13;
+    /// Mounting orientation (degrees) relative to the platform, X forward and Z up
+    constexpr static auto mountPoseYaw = 0.0;
+    constexpr static auto mountPosePitch = 0.0;
+    constexpr static auto mountPoseRoll = 0.0;
+  };
+  namespace lineSensor {
+    constexpr std::chrono::milliseconds timeout{100};
+    /// Sensor samples at 1kHz; deliver a few filtered samples per control loop
+    constexpr SerialLineSensor::Filter::Settings filter{.outputPeriod = std::chrono::milliseconds{5},
+                                                        .timeConstant = std::chrono::milliseconds{4}};
+    /// Learned thresholds, stored next to the module homes
+    constexpr char calibrationFile[] = ".config/Swerve-Platform/lineSensorCalibration";
+    /// Learned thresholds are saved as they change, since the platform is usually just switched off
+    constexpr std::chrono::seconds calibrationSaveInterval{10};
+  }  // namespace lineSensor
 }  // namespace sensorConfig
 
 namespace motorConfig {
@@ -225,6 +310,7 @@ namespace motorConfig {
       constexpr static auto remoteFilter0_addr = sensorConfig::drive::frontLeftTurn::address;
       constexpr static auto remoteFilter0_type =
           ctre::phoenix::motorcontrol::RemoteSensorSource::RemoteSensorSource_CANCoder;
+      constexpr static auto remoteSensorGearRatio = measureUp::turn::gearRatio;
       constexpr static auto pid0_selectedSensor = ctre::phoenix::motorcontrol::FeedbackDevice::RemoteSensor0;
       constexpr static auto pid0_kP = controlLoop::drive::rotate::kP;
       constexpr static auto pid0_kI = controlLoop::drive::rotate::kI;
@@ -252,6 +338,7 @@ namespace motorConfig {
       constexpr static auto remoteFilter0_addr = sensorConfig::drive::frontRightTurn::address;
       constexpr static auto remoteFilter0_type =
           ctre::phoenix::motorcontrol::RemoteSensorSource::RemoteSensorSource_CANCoder;
+      constexpr static auto remoteSensorGearRatio = measureUp::turn::gearRatio;
       constexpr static auto pid0_selectedSensor = ctre::phoenix::motorcontrol::FeedbackDevice::RemoteSensor0;
       constexpr static auto pid0_kP = controlLoop::drive::rotate::kP;
       constexpr static auto pid0_kI = controlLoop::drive::rotate::kI;
@@ -279,6 +366,7 @@ namespace motorConfig {
       constexpr static auto remoteFilter0_addr = sensorConfig::drive::rearRightTurn::address;
       constexpr static auto remoteFilter0_type =
           ctre::phoenix::motorcontrol::RemoteSensorSource::RemoteSensorSource_CANCoder;
+      constexpr static auto remoteSensorGearRatio = measureUp::turn::gearRatio;
       constexpr static auto pid0_selectedSensor = ctre::phoenix::motorcontrol::FeedbackDevice::RemoteSensor0;
       constexpr static auto pid0_kP = controlLoop::drive::rotate::kP;
       constexpr static auto pid0_kI = controlLoop::drive::rotate::kI;
@@ -306,6 +394,7 @@ namespace motorConfig {
       constexpr static auto remoteFilter0_addr = sensorConfig::drive::rearLeftTurn::address;
       constexpr static auto remoteFilter0_type =
           ctre::phoenix::motorcontrol::RemoteSensorSource::RemoteSensorSource_CANCoder;
+      constexpr static auto remoteSensorGearRatio = measureUp::turn::gearRatio;
       constexpr static auto pid0_selectedSensor = ctre::phoenix::motorcontrol::FeedbackDevice::RemoteSensor0;
       constexpr static auto pid0_kP = controlLoop::drive::rotate::kP;
       constexpr static auto pid0_kI = controlLoop::drive::rotate::kI;
@@ -326,14 +415,40 @@ namespace motorConfig {
   }  // namespace drive
 }  // namespace motorConfig
 
+#ifdef SWERVE_SIMULATED_HARDWARE
+namespace simulatorConfig {
+  /// Simulated devices for each module in SwervePlatform::ModuleIndex order
+  constexpr std::array<PlatformSimulator::ModuleAddresses, 4> moduleAddresses{
+      PlatformSimulator::ModuleAddresses{.drive = motorConfig::drive::frontLeftDrive::address,
+                                         .turn = motorConfig::drive::frontLeftTurn::address,
+                                         .encoder = sensorConfig::drive::frontLeftTurn::address},
+      PlatformSimulator::ModuleAddresses{.drive = motorConfig::drive::frontRightDrive::address,
+                                         .turn = motorConfig::drive::frontRightTurn::address,
+                                         .encoder = sensorConfig::drive::frontRightTurn::address},
+      PlatformSimulator::ModuleAddresses{.drive = motorConfig::drive::rearRightDrive::address,
+                                         .turn = motorConfig::drive::rearRightTurn::address,
+                                         .encoder = sensorConfig::drive::rearRightTurn::address},
+      PlatformSimulator::ModuleAddresses{.drive = motorConfig::drive::rearLeftDrive::address,
+                                         .turn = motorConfig::drive::rearLeftTurn::address,
+                                         .encoder = sensorConfig::drive::rearLeftTurn::address}};
+  /// Environment variable overriding simulated seconds per wall second.  0 runs as fast as possible
+  constexpr auto realTimeFactorVariable = "SWERVE_SIM_REALTIME_FACTOR";
+}  // namespace simulatorConfig
+#endif
+
 class TimedDebounce {
  public:
   TimedDebounce(units::second_t activationTime, units::second_t deactivationTime);
-  bool operator()(const bool newValue);
+  /**
+   * @brief Update with this tick's input
+   *
+   * @return Debounced value, changing once input has differed from it for the activation or deactivation time
+   */
+  bool operator()(const bool newValue, const hardware::TickContext& tick);
 
  private:
   bool m_activeVal;
-  std::chrono::time_point<std::chrono::steady_clock> m_changeTime;
+  std::chrono::time_point<hardware::Clock> m_changeTime;
   units::second_t m_activationTime;
   units::second_t m_deactivationTime;
 };
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "FlightRecord.h"
+#include "TelemetryPublisher.h"
+
+/// Signals PlatformApp streams live, in TelemetryValues() order.  Modules are in SwervePlatform::ModuleIndex order
+constexpr std::array telemetrySignals{
+    TelemetryPublisher::Signal{.name = "loop.period", .unit = "ms", .resolution = 0.01},
+    TelemetryPublisher::Signal{.name = "loop.work", .unit = "ms", .resolution = 0.01},
+    TelemetryPublisher::Signal{.name = "can.utilization", .unit = "%", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "frontLeft.speed", .unit = "m/s", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "frontRight.speed", .unit = "m/s", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "rearRight.speed", .unit = "m/s", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "rearLeft.speed", .unit = "m/s", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "frontLeft.angle", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "frontRight.angle", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "rearRight.angle", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "rearLeft.angle", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "frontLeft.position", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "frontRight.position", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "rearRight.position", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "rearLeft.position", .unit = "deg", .resolution = 0.1},
+    TelemetryPublisher::Signal{.name = "line.left", .unit = "", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "line.center", .unit = "", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "line.right", .unit = "", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "pose.x", .unit = "m", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "pose.y", .unit = "m", .resolution = 0.001},
+    TelemetryPublisher::Signal{.name = "pose.heading", .unit = "deg", .resolution = 0.1}};
+
+static_assert(SerialLineSensor::channelCount == 3, "telemetrySignals names one line signal per channel");
+
+/**
+ * @brief Telemetry sample for one tick
+ *
+ * @param record This tick's flight record.  Module speeds and angles are the setpoints after Optimize
+ * @param period Time since the previous tick started
+ * @param work Time the previous tick spent before sleeping
+ * @param canUtilization Fraction of CAN bus time used, NaN if unknown
+ */
+inline std::array<double, telemetrySignals.size()> TelemetryValues(const FlightRecord& record,
+                                                                   const std::chrono::duration<double> period,
+                                                                   const std::chrono::duration<double> work,
+                                                                   const double canUtilization) {
+  std::array<double, telemetrySignals.size()> values;
+  auto value = values.begin();
+  *value++ = period.count() * 1000;
+  *value++ = work.count() * 1000;
+  *value++ = canUtilization * 100;
+  for (const auto& moduleValues : {record.optimizedSpeed, record.optimizedAngle, record.turnPosition}) {
+    value = std::copy(moduleValues.begin(), moduleValues.end(), value);
+  }
+  for (const auto channel : record.lineChannels) {
+    *value++ = channel;
+  }
+  std::copy(record.pose.begin(), record.pose.end(), value);
+  return values;
+}
@@ -0,0 +1,282 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PlatformSimulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+namespace {
+  namespace falcon500 {
+    constexpr double nominalVoltage = 12.0;
+    constexpr double stallTorque = 4.69;     // Nm
+    constexpr double stallCurrent = 257.0;   // A
+    constexpr double freeCurrent = 1.5;      // A
+    constexpr double freeSpeed = 668.1;      // rad/s (6380 rpm)
+    constexpr double resistance = nominalVoltage / stallCurrent;
+    constexpr double torqueConstant = stallTorque / stallCurrent;
+    constexpr double velocityConstant = freeSpeed / (nominalVoltage - resistance * freeCurrent);  // rad/s/V
+  }  // namespace falcon500
+
+  constexpr double gravity = 9.80665;
+  constexpr double twoPi = 2.0 * M_PI;
+  constexpr double radToDeg = 180.0 / M_PI;
+  /// Speeds where friction torques reach their limit.  Keeps the model smooth through zero
+  constexpr double wheelStictionRate = 0.5;     // rad/s
+  constexpr double steeringStictionRate = 0.2;  // rad/s
+}  // namespace
+
+PlatformSimulator::PlatformSimulator(const SwervePlatform::PlatformDimensions& dimensions,
+                                     const std::array<ModuleAddresses, 4>& addresses)
+    : PlatformSimulator(dimensions, addresses, Parameters{}) {}
+
+PlatformSimulator::PlatformSimulator(const SwervePlatform::PlatformDimensions& dimensions,
+                                     const std::array<ModuleAddresses, 4>& addresses,
+                                     const Parameters& params)
+    : m_params{params}, m_busVoltage{params.batteryVoltage.to<double>()} {
+  const auto leverArms = SwervePlatform::ModuleLeverArms(dimensions);
+  for (size_t i = 0; i < m_modules.size(); ++i) {
+    // Lever arms are Y right, world is Y left
+    m_modules[i] = Module{.addresses = addresses[i],
+                          .x = leverArms[i].X().to<double>(),
+                          .y = -leverArms[i].Y().to<double>(),
+                          .normalForce = 0.0,
+                          .steerAngle = 0.0,
+                          .steerRate = 0.0,
+                          .wheelRate = 0.0,
+                          .wheelTurns = 0.0,
+                          .driveOutput = 0.0,
+                          .turnOutput = 0.0,
+                          .driveCurrent = 0.0,
+                          .turnCurrent = 0.0,
+                          .slipSpeed = 0.0};
+  }
+
+  // Static load on each wheel is the minimum-norm solution balancing weight and both tipping moments
+  Eigen::Matrix<double, 3, 4> equilibrium;
+  for (size_t i = 0; i < m_modules.size(); ++i) {
+    equilibrium(0, i) = 1.0;
+    equilibrium(1, i) = m_modules[i].x;
+    equilibrium(2, i) = m_modules[i].y;
+  }
+  const Eigen::Vector3d load{m_params.mass.to<double>() * gravity, 0.0, 0.0};
+  const Eigen::Matrix<double, 4, 1> normalForces =
+      equilibrium.transpose() * (equilibrium * equilibrium.transpose()).inverse() * load;
+  for (size_t i = 0; i < m_modules.size(); ++i) {
+    m_modules[i].normalForce = std::max(normalForces(i), 0.0);
+  }
+
+  if (m_params.yawInertia) {
+    m_yawInertia = m_params.yawInertia.value().to<double>();
+  } else {
+    const units::meter_t length = dimensions.platformLongitudinalLength;
+    const units::meter_t width = dimensions.platformLateralWidth;
+    m_yawInertia = m_params.mass.to<double>() * (std::pow(length.to<double>(), 2) + std::pow(width.to<double>(), 2)) /
+                   12.0;
+  }
+
+  hardware::SimulatedClock::Attach(this, m_params.fixedStep);
+  hardware::SimulatedClock::SetRealTimeFactor(m_params.realTimeFactor);
+}
+
+PlatformSimulator::~PlatformSimulator() {
+  hardware::SimulatedClock::Detach(this);
+}
+
+void PlatformSimulator::Step(const std::chrono::duration<double> dt) {
+  m_busVoltage = m_params.batteryVoltage.to<double>() - m_params.batteryResistance.to<double>() * m_supplyCurrent;
+
+  // Motor controllers close their loops on the sensor values from the previous step
+  for (auto& module : m_modules) {
+    auto driveMotor = hardware::SimulatedFalcon::Find(module.addresses.drive);
+    auto turnMotor = hardware::SimulatedFalcon::Find(module.addresses.turn);
+    module.driveOutput = 0.0;
+    module.turnOutput = 0.0;
+    if (driveMotor) {
+      driveMotor->SetExternallyDriven(true);
+      module.driveOutput = driveMotor->ComputeOutput(dt);
+    }
+    if (turnMotor) {
+      turnMotor->SetExternallyDriven(true);
+      module.turnOutput = turnMotor->ComputeOutput(dt);
+    }
+  }
+
+  const double h = dt.count() / std::max(m_params.substeps, 1);
+  for (int i = 0; i < std::max(m_params.substeps, 1); ++i) {
+    Integrate(h);
+  }
+
+  WriteSensors();
+  m_simulatedTime += dt;
+}
+
+frc::Pose2d PlatformSimulator::GetPose() const {
+  return frc::Pose2d{units::meter_t{m_x}, units::meter_t{m_y}, frc::Rotation2d{units::radian_t{m_heading}}};
+}
+
+frc::ChassisSpeeds PlatformSimulator::GetVelocity() const {
+  const double cosHeading = std::cos(m_heading);
+  const double sinHeading = std::sin(m_heading);
+  return frc::ChassisSpeeds{units::meters_per_second_t{cosHeading * m_vx + sinHeading * m_vy},
+                            units::meters_per_second_t{-sinHeading * m_vx + cosHeading * m_vy},
+                            units::radians_per_second_t{m_yawRate}};
+}
+
+PlatformSimulator::ModuleState PlatformSimulator::GetModuleState(const SwervePlatform::ModuleIndex index) const {
+  const auto& module = m_modules.at(index);
+  const units::meter_t wheelRadius = measureUp::drive::wheelDiameter / 2;
+  return ModuleState{.steeringAngle = units::radian_t{module.steerAngle},
+                     .wheelSurfaceSpeed = units::meters_per_second_t{module.wheelRate * wheelRadius.to<double>()},
+                     .slipSpeed = units::meters_per_second_t{module.slipSpeed},
+                     .driveCurrent = units::ampere_t{module.driveCurrent},
+                     .turnCurrent = units::ampere_t{module.turnCurrent}};
+}
+
+units::volt_t PlatformSimulator::GetBusVoltage() const {
+  return units::volt_t{m_busVoltage};
+}
+
+units::second_t PlatformSimulator::GetSimulatedTime() const {
+  return units::second_t{m_simulatedTime.count()};
+}
+
+double PlatformSimulator::MotorTorque(const hardware::SimulatedFalcon& motor,
+                                      const double output,
+                                      const double shaftSpeed,
+                                      double& statorCurrent,
+                                      double& supplyCurrent) const {
+  const auto& config = motor.GetParameters();
+  if (output == 0.0 && !config.neutralBrake) {
+    // Coast leaves windings open
+    statorCurrent = 0.0;
+    supplyCurrent = 0.0;
+    return 0.0;
+  }
+
+  // Voltage compensation scales output to the saturation voltage, but can't exceed what the battery supplies
+  const double busVoltage = std::max(m_busVoltage, 0.0);
+  const double appliedVoltage = config.voltCompSat ?
+                                    std::clamp(output * config.voltCompSat.value().to<double>(), -busVoltage, busVoltage) :
+                                    output * busVoltage;
+  const double dutyCycle = busVoltage > 0 ? std::abs(appliedVoltage) / busVoltage : 0.0;
+
+  statorCurrent = (appliedVoltage - shaftSpeed / falcon500::velocityConstant) / falcon500::resistance;
+  supplyCurrent = std::abs(statorCurrent) * dutyCycle;
+  if (config.supplyCurrentLimit && supplyCurrent > config.supplyCurrentLimit.value().to<double>()) {
+    statorCurrent *= config.supplyCurrentLimit.value().to<double>() / supplyCurrent;
+    supplyCurrent = config.supplyCurrentLimit.value().to<double>();
+  }
+  return falcon500::torqueConstant * statorCurrent;
+}
+
+void PlatformSimulator::Integrate(const double h) {
+  const units::meter_t wheelRadiusUnits = measureUp::drive::wheelDiameter / 2;
+  const double wheelRadius = wheelRadiusUnits.to<double>();
+  const double driveRatio = measureUp::drive::gearRatio;
+  const double steerRatio = m_params.steeringGearRatio;
+  const double slipVelocity = m_params.slipVelocity.to<double>();
+  const double cosHeading = std::cos(m_heading);
+  const double sinHeading = std::sin(m_heading);
+
+  double forceX = 0.0;
+  double forceY = 0.0;
+  double torque = 0.0;
+  double supplyCurrent = 0.0;
+
+  for (auto& module : m_modules) {
+    // Velocity of the contact patch in world frame
+    const double armX = cosHeading * module.x - sinHeading * module.y;
+    const double armY = sinHeading * module.x + cosHeading * module.y;
+    const double contactVx = m_vx - m_yawRate * armY;
+    const double contactVy = m_vy + m_yawRate * armX;
+
+    const double wheelHeading = m_heading + module.steerAngle;
+    const double headingX = std::cos(wheelHeading);
+    const double headingY = std::sin(wheelHeading);
+    const double longitudinalVel = contactVx * headingX + contactVy * headingY;
+    const double lateralVel = -contactVx * headingY + contactVy * headingX;
+
+    // Traction saturates at the friction limit, combined through the friction circle
+    const double frictionLimit = m_params.wheelFriction * module.normalForce;
+    module.slipSpeed = module.wheelRate * wheelRadius - longitudinalVel;
+    double longitudinalForce = frictionLimit * std::tanh(module.slipSpeed / slipVelocity);
+    double lateralForce = -frictionLimit * std::tanh(lateralVel / slipVelocity);
+    const double tractionForce = std::hypot(longitudinalForce, lateralForce);
+    if (tractionForce > frictionLimit && tractionForce > 0) {
+      longitudinalForce *= frictionLimit / tractionForce;
+      lateralForce *= frictionLimit / tractionForce;
+    }
+    const double moduleForceX = longitudinalForce * headingX - lateralForce * headingY;
+    const double moduleForceY = longitudinalForce * headingY + lateralForce * headingX;
+    forceX += moduleForceX;
+    forceY += moduleForceY;
+    torque += armX * moduleForceY - armY * moduleForceX;
+
+    double moduleSupplyCurrent = 0.0;
+    double driveTorque = 0.0;
+    double turnTorque = 0.0;
+    if (auto driveMotor = hardware::SimulatedFalcon::Find(module.addresses.drive); driveMotor) {
+      driveTorque = MotorTorque(
+                        *driveMotor, module.driveOutput, module.wheelRate * driveRatio, module.driveCurrent, moduleSupplyCurrent) *
+                    driveRatio;
+      supplyCurrent += moduleSupplyCurrent;
+    }
+    if (auto turnMotor = hardware::SimulatedFalcon::Find(module.addresses.turn); turnMotor) {
+      turnTorque = MotorTorque(
+                       *turnMotor, module.turnOutput, module.steerRate * steerRatio, module.turnCurrent, moduleSupplyCurrent) *
+                   steerRatio;
+      supplyCurrent += moduleSupplyCurrent;
+    }
+
+    const double rollingTorque = m_params.rollingResistance * module.normalForce * wheelRadius *
+                                 std::tanh(module.wheelRate / wheelStictionRate);
+    module.wheelRate +=
+        (driveTorque - longitudinalForce * wheelRadius - rollingTorque) / m_params.driveInertia.to<double>() * h;
+    module.wheelTurns += module.wheelRate * h / twoPi;
+
+    const double scrubTorque =
+        frictionLimit * m_params.scrubRadius.to<double>() * std::tanh(module.steerRate / steeringStictionRate);
+    module.steerRate += (turnTorque - scrubTorque) / m_params.steeringInertia.to<double>() * h;
+    module.steerAngle += module.steerRate * h;
+  }
+
+  // Semi-implicit Euler: velocities first, then positions from the new velocities
+  m_vx += forceX / m_params.mass.to<double>() * h;
+  m_vy += forceY / m_params.mass.to<double>() * h;
+  m_yawRate += torque / m_yawInertia * h;
+  m_x += m_vx * h;
+  m_y += m_vy * h;
+  m_heading += m_yawRate * h;
+  m_supplyCurrent = supplyCurrent;
+}
+
+void PlatformSimulator::WriteSensors() {
+  for (auto& module : m_modules) {
+    if (auto driveMotor = hardware::SimulatedFalcon::Find(module.addresses.drive); driveMotor) {
+      const double motorRotations = module.wheelTurns * measureUp::drive::gearRatio;
+      const double motorRate = module.wheelRate / twoPi * measureUp::drive::gearRatio;
+      driveMotor->SetSensorState(motorRotations * measureUp::drive::sensorCountsPerRev,
+                                 motorRate * measureUp::drive::sensorCountsPerRev / 10.0);
+    }
+    if (auto encoder = hardware::SimulatedCANCoder::Find(module.addresses.encoder); encoder) {
+      encoder->SetMechanismAngle(module.steerAngle * radToDeg);
+    }
+    if (auto turnMotor = hardware::SimulatedFalcon::Find(module.addresses.turn); turnMotor) {
+      const double motorRotations = module.steerAngle / twoPi * m_params.steeringGearRatio;
+      turnMotor->SetSensorState(
+          motorRotations * measureUp::drive::sensorCountsPerRev,
+          module.steerRate * radToDeg * measureUp::sensorConversion::swerveRotate::ticksPerDegree / 10.0);
+    }
+  }
+  if (m_params.imuAddress) {
+    if (auto imu = hardware::SimulatedPigeon2::Find(m_params.imuAddress.value()); imu) {
+      imu->SetMechanismState(m_heading * radToDeg, m_yawRate * radToDeg);
+    }
+  }
+}
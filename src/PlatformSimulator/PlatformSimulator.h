@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+#include <frc/geometry/Pose2d.h>
+#include <frc/kinematics/ChassisSpeeds.h>
+#include <units/current.h>
+#include <units/impedance.h>
+#include <units/mass.h>
+#include <units/moment_of_inertia.h>
+#include <units/velocity.h>
+#include <units/voltage.h>
+
+#include "SwervePlatform.h"
+#include "SwervePlatformHardware.h"
+
+/**
+ * @brief Deterministic rigid-body model of the swerve platform.  Drives the simulated motors and encoders created by
+ *        SwervePlatform and advances whenever the simulated clock does.
+ *
+ * World frame is X forward, Y left, counter-clockwise positive.  Steering angles follow the CANCoder mechanism angle.
+ */
+class PlatformSimulator : public hardware::SimulationInterface {
+ public:
+  struct ModuleAddresses {
+    int drive;
+    int turn;
+    int encoder;
+  };
+
+  struct Parameters {
+    units::kilogram_t mass{90_kg};
+    std::optional<units::kilogram_square_meter_t> yawInertia{std::nullopt};  ///< Uniform slab if not provided
+    double wheelFriction{0.9};                                                 ///< Tire to floor coefficient
+    units::meters_per_second_t slipVelocity{0.05_mps};  ///< Slip where traction nears the friction limit
+    double rollingResistance{0.015};
+    units::kilogram_square_meter_t driveInertia{0.004_kg_sq_m};  ///< Wheel plus reflected rotor inertia
+    double steeringGearRatio{measureUp::turn::gearRatio};
+    units::kilogram_square_meter_t steeringInertia{0.008_kg_sq_m};  ///< Module plus reflected rotor inertia
+    units::meter_t scrubRadius{0.01_m};                           ///< Effective contact patch radius when steering
+    units::volt_t batteryVoltage{12.6_V};
+    units::ohm_t batteryResistance{0.02_Ohm};
+    std::chrono::nanoseconds fixedStep{std::chrono::milliseconds{1}};  ///< Motor controller loop period
+    int substeps{4};                                                    ///< Physics integration steps per fixed step
+    double realTimeFactor{1.0};  ///< Simulated seconds per wall second.  0 runs as fast as possible
+    std::optional<int> imuAddress{std::nullopt};  ///< Simulated Pigeon2 to report the platform heading to, if any
+  };
+
+  struct ModuleState {
+    units::degree_t steeringAngle;
+    units::meters_per_second_t wheelSurfaceSpeed;
+    units::meters_per_second_t slipSpeed;
+    units::ampere_t driveCurrent;
+    units::ampere_t turnCurrent;
+  };
+
+  PlatformSimulator(const SwervePlatform::PlatformDimensions& dimensions,
+                    const std::array<ModuleAddresses, 4>& addresses);
+  PlatformSimulator(const SwervePlatform::PlatformDimensions& dimensions,
+                    const std::array<ModuleAddresses, 4>& addresses,
+                    const Parameters& params);
+  ~PlatformSimulator();
+  PlatformSimulator(const PlatformSimulator&) = delete;
+  PlatformSimulator& operator=(const PlatformSimulator&) = delete;
+
+  void Step(const std::chrono::duration<double> dt) override;
+
+  [[nodiscard]] frc::Pose2d GetPose() const;
+  [[nodiscard]] frc::ChassisSpeeds GetVelocity() const;
+  [[nodiscard]] ModuleState GetModuleState(const SwervePlatform::ModuleIndex index) const;
+  [[nodiscard]] units::volt_t GetBusVoltage() const;
+  [[nodiscard]] units::second_t GetSimulatedTime() const;
+
+ private:
+  struct Module {
+    ModuleAddresses addresses;
+    double x;             ///< Position from platform center (m)
+    double y;             ///< Position from platform center (m)
+    double normalForce;   ///< Static share of platform weight (N)
+    double steerAngle;    ///< rad
+    double steerRate;     ///< rad/s
+    double wheelRate;     ///< rad/s
+    double wheelTurns;    ///< Drive wheel rotations since start
+    double driveOutput;   ///< Motor controller output fraction
+    double turnOutput;    ///< Motor controller output fraction
+    double driveCurrent;  ///< Stator current (A)
+    double turnCurrent;   ///< Stator current (A)
+    double slipSpeed;     ///< Longitudinal slip (m/s)
+  };
+
+  /// @brief Torque of a Falcon 500 given applied output and shaft speed.  Updates stator and supply current
+  [[nodiscard]] double MotorTorque(const hardware::SimulatedFalcon& motor,
+                                   const double output,
+                                   const double shaftSpeed,
+                                   double& statorCurrent,
+                                   double& supplyCurrent) const;
+  void Integrate(const double h);
+  void WriteSensors();
+
+  const Parameters m_params;
+  double m_yawInertia;
+  std::array<Module, 4> m_modules;
+
+  double m_x{0.0};
+  double m_y{0.0};
+  double m_heading{0.0};
+  double m_vx{0.0};
+  double m_vy{0.0};
+  double m_yawRate{0.0};
+  double m_busVoltage;
+  double m_supplyCurrent{0.0};
+  std::chrono::duration<double> m_simulatedTime{0.0};
+};
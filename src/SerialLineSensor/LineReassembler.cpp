@@ -0,0 +1,70 @@
+#include "LineReassembler.h"
+
+#include <algorithm>
+
+std::span<char> LineReassembler::WritableSpan() {
+  if (m_size == 0) {
+    // Nothing to preserve, so start over for the largest contiguous region
+    m_head = 0;
+  }
+  const std::size_t tail = (m_head + m_size) % capacity;
+  const std::size_t contiguousFree = std::min(capacity - m_size, capacity - tail);
+  return std::span<char>(m_buffer.data() + tail, contiguousFree);
+}
+
+void LineReassembler::Commit(const std::size_t nBytes) {
+  m_size = std::min(m_size + nBytes, capacity);
+}
+
+std::optional<std::string_view> LineReassembler::NextLine() {
+  while (m_scanned < m_size) {
+    const char nextChar = m_buffer[(m_head + m_scanned) % capacity];
+    ++m_scanned;
+
+    if (nextChar != m_delimiter) {
+      if (m_discarding) {
+        Consume(m_scanned);
+      } else if (m_scanned > maxLineLength) {
+        Consume(m_scanned);
+        m_discarding = true;
+        ++m_discardedLines;
+      }
+      continue;
+    }
+
+    if (m_discarding) {
+      Consume(m_scanned);
+      m_discarding = false;
+      continue;
+    }
+
+    std::size_t lineLength = m_scanned - 1;
+    const char* lineStart = m_buffer.data() + m_head;
+    if (m_head + lineLength > capacity) {
+      const std::size_t firstPart = capacity - m_head;
+      std::copy_n(m_buffer.begin() + m_head, firstPart, m_lineScratch.begin());
+      std::copy_n(m_buffer.begin(), lineLength - firstPart, m_lineScratch.begin() + firstPart);
+      lineStart = m_lineScratch.data();
+    }
+    Consume(m_scanned);
+
+    if (m_delimiter == '\n' && lineLength > 0 && lineStart[lineLength - 1] == '\r') {
+      --lineLength;
+    }
+    return std::string_view(lineStart, lineLength);
+  }
+  return std::nullopt;
+}
+
+void LineReassembler::Reset() {
+  m_head = 0;
+  m_size = 0;
+  m_scanned = 0;
+  m_discarding = true;
+}
+
+void LineReassembler::Consume(const std::size_t nBytes) {
+  m_head = (m_head + nBytes) % capacity;
+  m_size -= nBytes;
+  m_scanned -= nBytes;
+}
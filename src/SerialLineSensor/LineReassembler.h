@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+/**
+ * @brief Fixed-capacity ring buffer that splits a serial byte stream into delimiter-terminated records.
+ *        Never allocates.
+ */
+class LineReassembler {
+ public:
+  constexpr static std::size_t capacity = 256;
+  constexpr static std::size_t maxLineLength = 64;  ///< Longer records are discarded through the next delimiter
+
+  /**
+   * @brief Largest contiguous free region of the ring.  Fill with received bytes and then call Commit()
+   */
+  [[nodiscard]] std::span<char> WritableSpan();
+
+  /**
+   * @brief Mark bytes written into WritableSpan() as received
+   */
+  void Commit(const std::size_t nBytes);
+
+  /**
+   * @brief Extract the next complete record
+   *
+   * @return Record without delimiter (or trailing '\r' for newline-delimited records), or std::nullopt if no complete
+   *         record is buffered.  The view may point into scratch storage that the next NextLine() overwrites, or into
+   *         ring space that is handed out again once consumed.  Copy what is needed before the next call to
+   *         NextLine(), WritableSpan(), Commit() or Reset()
+   */
+  [[nodiscard]] std::optional<std::string_view> NextLine();
+
+  /**
+   * @brief Drop buffered bytes, e.g. after reconnecting.  Bytes up to the next delimiter are skipped since the stream
+   *        may resume mid-record.  Does not reset GetDiscardedLines()
+   */
+  void Reset();
+
+  /**
+   * @brief Change the record terminator.  Applies to bytes not yet returned by NextLine()
+   */
+  void SetDelimiter(const char delimiter) { m_delimiter = delimiter; }
+
+  /// @brief Records dropped for exceeding maxLineLength
+  [[nodiscard]] uint32_t GetDiscardedLines() const { return m_discardedLines; }
+
+ private:
+  void Consume(const std::size_t nBytes);
+
+  std::array<char, capacity> m_buffer;
+  std::array<char, maxLineLength> m_lineScratch;  ///< Records that wrap the end of the ring are copied here
+  std::size_t m_head{0};                          ///< Index of oldest buffered byte
+  std::size_t m_size{0};                          ///< Bytes buffered
+  std::size_t m_scanned{0};                       ///< Bytes already searched for a terminator
+  bool m_discarding{false};                       ///< Skipping remainder of an overlong record
+  char m_delimiter{'\n'};
+  uint32_t m_discardedLines{0};
+};
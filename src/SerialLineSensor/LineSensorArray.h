@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Weighted centroid of one line sensor sample
+ */
+struct LineCentroid {
+  double position;  ///< Lateral line position in meters, same axis as the channel positions
+  double weight;    ///< Sum of channel weights.  Larger means more of the line is under the array
+  bool saturated;   ///< Only an outermost channel sees the line, so the true position may be further out
+};
+
+/**
+ * @brief Per-channel calibration and normalization for a reflectance sensor bar.
+ *
+ * Channel data is kept as one array per quantity rather than one struct per channel, so every per-sample operation
+ * is a branch-free loop over contiguous values that the compiler can vectorize.
+ *
+ * @tparam N Number of sensor channels
+ */
+template <std::size_t N>
+class LineSensorArray {
+  static_assert(N >= 2 && N <= 32, "Channel masks are 32 bits");
+
+ public:
+  using Channels = std::array<double, N>;
+  using ChannelMask = uint32_t;  ///< Bit i set for channel i
+
+  /**
+   * @brief Raw readings at the two ends of each channel's range.  Either may be the larger value
+   */
+  struct Calibration {
+    Channels lineLevel;   ///< Reading with the full line under the channel
+    Channels floorLevel;  ///< Reading with no line under the channel
+  };
+
+  /// @brief Same calibration for every channel
+  [[nodiscard]] constexpr static Calibration UniformCalibration(const double lineLevel, const double floorLevel) {
+    Calibration calibration{};
+    calibration.lineLevel.fill(lineLevel);
+    calibration.floorLevel.fill(floorLevel);
+    return calibration;
+  }
+
+  explicit LineSensorArray(const Calibration& calibration) { SetCalibration(calibration); }
+
+  void SetCalibration(const Calibration& calibration) {
+    m_calibration = calibration;
+    // Precompute normalized = raw * scale + offset so normalization is one multiply-add per channel
+    for (std::size_t i = 0; i < N; ++i) {
+      const double range = calibration.lineLevel[i] - calibration.floorLevel[i];
+      m_scale[i] = range != 0 ? 1.0 / range : 0.0;
+      m_offset[i] = -calibration.floorLevel[i] * m_scale[i];
+    }
+  }
+
+  [[nodiscard]] const Calibration& GetCalibration() const { return m_calibration; }
+
+  /**
+   * @brief Convert raw readings to line coverage
+   *
+   * @return Per channel, 0=no line, 1=full line
+   */
+  [[nodiscard]] Channels Normalize(const Channels& raw) const {
+    Channels normalized;
+    for (std::size_t i = 0; i < N; ++i) {
+      normalized[i] = std::clamp(raw[i] * m_scale[i] + m_offset[i], 0.0, 1.0);
+    }
+    return normalized;
+  }
+
+  /**
+   * @brief Channels whose normalized value is at least level
+   */
+  [[nodiscard]] static ChannelMask Threshold(const Channels& normalized, const double level) {
+    ChannelMask mask = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      mask |= static_cast<ChannelMask>(normalized[i] >= level) << i;
+    }
+    return mask;
+  }
+
+  /// @brief Mask with every channel set
+  constexpr static ChannelMask allChannels = N == 32 ? ~ChannelMask{0} : (ChannelMask{1} << N) - 1;
+  /// @brief Mask of the first (leftmost) channel
+  constexpr static ChannelMask firstChannel = ChannelMask{1};
+  /// @brief Mask of the last (rightmost) channel
+  constexpr static ChannelMask lastChannel = ChannelMask{1} << (N - 1);
+
+ private:
+  Calibration m_calibration;
+  Channels m_scale;
+  Channels m_offset;
+};
+
+/**
+ * @brief Evenly spaced channel positions centered on the array
+ *
+ * @param spacing Distance between adjacent channels in meters
+ * @return Lateral position of each channel, first channel most negative
+ */
+template <std::size_t N>
+[[nodiscard]] constexpr std::array<double, N> CenteredChannelPositions(const double spacing) {
+  std::array<double, N> positions{};
+  for (std::size_t i = 0; i < N; ++i) {
+    positions[i] = (static_cast<double>(i) - (N - 1) / 2.0) * spacing;
+  }
+  return positions;
+}
+
+/**
+ * @brief Locate the line under a sensor array
+ *
+ * @tparam N Number of sensor channels
+ * @param weights Per-channel line coverage, 0=no line, 1=full line
+ * @param positions Lateral position of each channel in meters, ordered so the outermost channels are first and last
+ * @return Centroid, or std::nullopt if no channel sees the line
+ */
+template <std::size_t N>
+[[nodiscard]] std::optional<LineCentroid> WeightedCentroid(const std::array<double, N>& weights,
+                                                           const std::array<double, N>& positions) {
+  double weightSum = 0;
+  double momentSum = 0;
+  for (std::size_t i = 0; i < N; ++i) {
+    weightSum += weights[i];
+    momentSum += weights[i] * positions[i];
+  }
+  if (weightSum <= 0) {
+    return std::nullopt;
+  }
+  double interiorWeight = 0;
+  for (std::size_t i = 1; i + 1 < N; ++i) {
+    interiorWeight += weights[i];
+  }
+  return LineCentroid{.position = momentSum / weightSum, .weight = weightSum, .saturated = interiorWeight <= 0};
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+#include "LineSensorArray.h"
+
+/**
+ * @brief Learns per-channel line and floor levels from the raw readings seen while driving.
+ *
+ * Each channel keeps a fixed-bin histogram of raw readings with exponential forgetting.  Every sample updates all
+ * histograms and re-estimates one channel (round robin) by splitting its histogram into floor and line clusters with
+ * Otsu's method, so memory and time per sample are constant.  A new calibration is adopted only when a level moves
+ * further than the hysteresis band, which keeps thresholds from chattering.
+ *
+ * @tparam N Number of sensor channels
+ */
+template <std::size_t N>
+class LineSensorCalibrator {
+ public:
+  using Calibration = typename LineSensorArray<N>::Calibration;
+  using Channels = typename LineSensorArray<N>::Channels;
+  constexpr static std::size_t binCount = 128;  ///< 8 counts per bin for a 10-bit ADC
+
+  struct Settings {
+    double maxReading{1023};           ///< Largest raw reading (10-bit ADC)
+    double halfLife{30000};            ///< Samples until an old reading counts half as much (30s at 1kHz)
+    double minimumSamples{2000};       ///< Effective samples per channel before estimating
+    double minimumLineFraction{0.01};  ///< Line cluster must hold at least this fraction of readings
+    double minimumContrast{30};        ///< Cluster means must differ by at least this many counts
+    double floorNoiseMargin{2};        ///< Floor level is this many floor standard deviations toward the line
+    double hysteresis{8};              ///< Counts a level must move before the calibration changes
+  };
+
+  /**
+   * @param initial Calibration used until enough data is seen.  Its polarity (line above or below floor) is kept
+   */
+  explicit LineSensorCalibrator(const Calibration& initial) : LineSensorCalibrator(initial, Settings{}) {}
+  LineSensorCalibrator(const Calibration& initial, const Settings& settings)
+      : m_settings{settings}
+      , m_calibration{initial}
+      , m_growth{std::exp2(1.0 / settings.halfLife)}
+      , m_binWidth{(settings.maxReading + 1) / binCount} {
+    for (auto& histogram : m_histograms) {
+      histogram.fill(0);
+    }
+  }
+
+  [[nodiscard]] const Calibration& GetCalibration() const { return m_calibration; }
+
+  /// @brief Replace the calibration, e.g. with one loaded from storage.  Learned histograms are kept
+  void SetCalibration(const Calibration& calibration) { m_calibration = calibration; }
+
+  /**
+   * @brief Add one raw reading per channel
+   *
+   * @return true if the calibration changed
+   */
+  bool AddSample(const Channels& raw) {
+    // Growing the increment instead of decaying every bin gives exponential forgetting in O(1)
+    m_increment *= m_growth;
+    if (m_increment > renormalizeLimit) {
+      for (auto& histogram : m_histograms) {
+        for (auto& bin : histogram) {
+          bin /= m_increment;
+        }
+      }
+      m_total /= m_increment;
+      m_increment = 1;
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+      const auto bin = std::min(static_cast<std::size_t>(std::max(raw[i], 0.0) / m_binWidth), binCount - 1);
+      m_histograms[i][bin] += m_increment;
+    }
+    m_total += m_increment;
+
+    const auto channel = m_nextChannel;
+    m_nextChannel = (m_nextChannel + 1) % N;
+    return EstimateChannel(channel);
+  }
+
+  /**
+   * @brief Write the calibration as text
+   */
+  void Save(std::ostream& output) const {
+    output << N << '\n';
+    for (std::size_t i = 0; i < N; ++i) {
+      output << m_calibration.lineLevel[i] << ' ' << m_calibration.floorLevel[i] << '\n';
+    }
+  }
+
+  /**
+   * @brief Read a calibration written by Save()
+   *
+   * @return false if the data is malformed or for a different channel count.  Calibration is unchanged
+   */
+  bool Load(std::istream& input) {
+    std::size_t channelCount = 0;
+    Calibration loaded;
+    if (!(input >> channelCount) || channelCount != N) {
+      return false;
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+      if (!(input >> loaded.lineLevel[i] >> loaded.floorLevel[i]) || !std::isfinite(loaded.lineLevel[i]) ||
+          !std::isfinite(loaded.floorLevel[i]) || loaded.lineLevel[i] == loaded.floorLevel[i]) {
+        return false;
+      }
+    }
+    m_calibration = loaded;
+    return true;
+  }
+
+ private:
+  constexpr static double renormalizeLimit = 1e20;
+
+  /// @return true if the channel's levels changed
+  bool EstimateChannel(const std::size_t channel) {
+    if (m_total / m_increment < m_settings.minimumSamples) {
+      return false;
+    }
+    const auto& histogram = m_histograms[channel];
+
+    double weight = 0;
+    double moment = 0;
+    double secondMoment = 0;
+    for (std::size_t bin = 0; bin < binCount; ++bin) {
+      const double value = (bin + 0.5) * m_binWidth;
+      weight += histogram[bin];
+      moment += histogram[bin] * value;
+      secondMoment += histogram[bin] * value * value;
+    }
+
+    // Otsu: split maximizing between-cluster variance
+    double lowWeight = 0;
+    double lowMoment = 0;
+    double lowSecondMoment = 0;
+    double bestScore = 0;
+    double bestLowWeight = 0;
+    double bestLowMoment = 0;
+    double bestLowSecondMoment = 0;
+    for (std::size_t bin = 0; bin + 1 < binCount; ++bin) {
+      const double value = (bin + 0.5) * m_binWidth;
+      lowWeight += histogram[bin];
+      lowMoment += histogram[bin] * value;
+      lowSecondMoment += histogram[bin] * value * value;
+      const double highWeight = weight - lowWeight;
+      if (lowWeight <= 0 || highWeight <= 0) {
+        continue;
+      }
+      const double meanDifference = lowMoment / lowWeight - (moment - lowMoment) / highWeight;
+      const double score = lowWeight * highWeight * meanDifference * meanDifference;
+      if (score > bestScore) {
+        bestScore = score;
+        bestLowWeight = lowWeight;
+        bestLowMoment = lowMoment;
+        bestLowSecondMoment = lowSecondMoment;
+      }
+    }
+    if (bestScore <= 0) {
+      return false;
+    }
+
+    const double highWeight = weight - bestLowWeight;
+    const double lowMean = bestLowMoment / bestLowWeight;
+    const double highMean = (moment - bestLowMoment) / highWeight;
+    const double lowStdDev = std::sqrt(std::max(bestLowSecondMoment / bestLowWeight - lowMean * lowMean, 0.0));
+    const double highStdDev =
+        std::sqrt(std::max((secondMoment - bestLowSecondMoment) / highWeight - highMean * highMean, 0.0));
+
+    const bool lineBelowFloor = m_calibration.lineLevel[channel] < m_calibration.floorLevel[channel];
+    const double lineWeight = lineBelowFloor ? bestLowWeight : highWeight;
+    if (lineWeight / weight < m_settings.minimumLineFraction || highMean - lowMean < m_settings.minimumContrast) {
+      // Line not seen often enough on this channel to tell it from the floor
+      return false;
+    }
+
+    // Floor level is set past the floor noise so an uncovered channel reads 0
+    const double lineLevel = lineBelowFloor ? lowMean : highMean;
+    const double floorLevel = lineBelowFloor ? highMean - m_settings.floorNoiseMargin * highStdDev
+                                             : lowMean + m_settings.floorNoiseMargin * lowStdDev;
+    if (std::abs(floorLevel - lineLevel) < m_settings.minimumContrast / 2 ||
+        (floorLevel > lineLevel) != lineBelowFloor) {
+      return false;
+    }
+
+    if (std::abs(lineLevel - m_calibration.lineLevel[channel]) <= m_settings.hysteresis &&
+        std::abs(floorLevel - m_calibration.floorLevel[channel]) <= m_settings.hysteresis) {
+      return false;
+    }
+    m_calibration.lineLevel[channel] = lineLevel;
+    m_calibration.floorLevel[channel] = floorLevel;
+    return true;
+  }
+
+  Settings m_settings;
+  Calibration m_calibration;
+  double m_growth;
+  double m_binWidth;
+  std::array<std::array<double, binCount>, N> m_histograms;
+  double m_increment{1};  ///< Weight of the newest sample relative to the histogram scale
+  double m_total{0};      ///< Sum of each channel's histogram
+  std::size_t m_nextChannel{0};
+};
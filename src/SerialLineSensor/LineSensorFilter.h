@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <span>
+
+/**
+ * @brief First-order low-pass filter and decimator for line sensor channels.  Keeps a fixed-length history of
+ *        decimated outputs.
+ *
+ * @tparam N Number of sensor channels
+ */
+template <std::size_t N>
+class LineSensorFilter {
+ public:
+  constexpr static std::size_t historySize = 32;
+
+  struct Settings {
+    std::chrono::microseconds outputPeriod{0};  ///< Minimum sensor time between outputs.  0 outputs every sample
+    std::chrono::microseconds timeConstant{0};  ///< Low-pass time constant.  0 disables filtering
+  };
+
+  struct Sample {
+    std::chrono::microseconds timestamp;  ///< Sensor time of the most recent input sample
+    std::array<double, N> channels;       ///< Raw sensor units
+  };
+
+  explicit LineSensorFilter(const Settings& settings) : m_settings{settings} {}
+
+  /**
+   * @brief Filter one input sample
+   *
+   * @param timestamp Sensor time of the sample.  Must not decrease between calls
+   * @param channels Raw channel values
+   * @return true if a new output sample was produced
+   */
+  bool AddSample(const std::chrono::microseconds timestamp, const std::array<double, N>& channels) {
+    if (!m_lastInputTime || m_settings.timeConstant.count() <= 0) {
+      m_state = channels;
+    } else {
+      const std::chrono::duration<double> dt = std::max(timestamp - m_lastInputTime.value(), decltype(timestamp){0});
+      const double alpha = 1.0 - std::exp(-dt / std::chrono::duration<double>(m_settings.timeConstant));
+      for (std::size_t i = 0; i < N; ++i) {
+        m_state[i] += alpha * (channels[i] - m_state[i]);
+      }
+    }
+    m_lastInputTime = timestamp;
+
+    // Decimate by sensor time so output rate doesn't depend on the firmware sample rate
+    if (m_nextOutputTime && timestamp < m_nextOutputTime.value()) {
+      return false;
+    }
+    if (!m_nextOutputTime || timestamp - m_nextOutputTime.value() >= m_settings.outputPeriod) {
+      m_nextOutputTime = timestamp + m_settings.outputPeriod;
+    } else {
+      m_nextOutputTime = m_nextOutputTime.value() + m_settings.outputPeriod;
+    }
+    m_newestIndex = (m_newestIndex + 1) % historySize;
+    m_history[m_newestIndex] = Sample{.timestamp = timestamp, .channels = m_state};
+    m_historyCount = std::min(m_historyCount + 1, historySize);
+    return true;
+  }
+
+  /**
+   * @brief Forget filter state and history, e.g. after the sensor reconnects
+   */
+  void Reset() {
+    m_lastInputTime = std::nullopt;
+    m_nextOutputTime = std::nullopt;
+    m_historyCount = 0;
+  }
+
+  /// @brief Most recent output sample, if any
+  [[nodiscard]] std::optional<Sample> Latest() const {
+    if (m_historyCount == 0) {
+      return std::nullopt;
+    }
+    return m_history[m_newestIndex];
+  }
+
+  /**
+   * @brief Copy output samples, newest first
+   *
+   * @param destination Filled with up to destination.size() samples
+   * @return Number of samples copied
+   */
+  std::size_t CopyHistory(std::span<Sample> destination) const {
+    const std::size_t count = std::min(destination.size(), m_historyCount);
+    for (std::size_t i = 0; i < count; ++i) {
+      destination[i] = m_history[(m_newestIndex + historySize - i) % historySize];
+    }
+    return count;
+  }
+
+ private:
+  Settings m_settings;
+  std::array<double, N> m_state{};
+  std::optional<std::chrono::microseconds> m_lastInputTime{std::nullopt};
+  std::optional<std::chrono::microseconds> m_nextOutputTime{std::nullopt};
+  std::array<Sample, historySize> m_history{};
+  std::size_t m_newestIndex{0};
+  std::size_t m_historyCount{0};
+};
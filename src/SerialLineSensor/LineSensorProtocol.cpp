@@ -0,0 +1,68 @@
+#include "LineSensorProtocol.h"
+
+namespace lineSensorProtocol {
+
+  uint16_t Crc16(std::span<const uint8_t> data) {
+    uint16_t crc = 0xFFFF;
+    for (const auto byte : data) {
+      crc ^= static_cast<uint16_t>(byte) << 8;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+      }
+    }
+    return crc;
+  }
+
+  DecodeResult DecodeFrame(std::string_view encoded, Frame& frame) {
+    if (encoded.empty() || encoded.size() > maxEncodedFrameSize) {
+      return DecodeResult::framingError;
+    }
+
+    // COBS: each code byte gives the distance to the next zero, 0xFF meaning a run without one
+    std::array<uint8_t, maxFrameSize> decoded;
+    std::size_t decodedSize = 0;
+    std::size_t readIndex = 0;
+    while (readIndex < encoded.size()) {
+      const auto code = static_cast<uint8_t>(encoded[readIndex++]);
+      if (code == 0 || readIndex + code - 1 > encoded.size()) {
+        return DecodeResult::framingError;
+      }
+      for (int i = 1; i < code; ++i) {
+        if (decodedSize >= decoded.size()) {
+          return DecodeResult::framingError;
+        }
+        decoded[decodedSize++] = static_cast<uint8_t>(encoded[readIndex++]);
+      }
+      if (code != 0xFF && readIndex < encoded.size()) {
+        if (decodedSize >= decoded.size()) {
+          return DecodeResult::framingError;
+        }
+        decoded[decodedSize++] = 0;
+      }
+    }
+
+    if (decodedSize < headerSize + crcSize) {
+      return DecodeResult::framingError;
+    }
+    const uint8_t channelCount = decoded[1];
+    if (channelCount > maxChannels || decodedSize != headerSize + 2 * channelCount + crcSize) {
+      return DecodeResult::framingError;
+    }
+
+    const auto payloadSize = decodedSize - crcSize;
+    const uint16_t receivedCrc = decoded[payloadSize] | (decoded[payloadSize + 1] << 8);
+    if (Crc16(std::span<const uint8_t>(decoded.data(), payloadSize)) != receivedCrc) {
+      return DecodeResult::checksumError;
+    }
+
+    frame.sequence = decoded[0];
+    frame.channelCount = channelCount;
+    frame.timestamp = static_cast<uint32_t>(decoded[2]) | (static_cast<uint32_t>(decoded[3]) << 8) |
+                      (static_cast<uint32_t>(decoded[4]) << 16) | (static_cast<uint32_t>(decoded[5]) << 24);
+    for (std::size_t channel = 0; channel < channelCount; ++channel) {
+      frame.channels[channel] = decoded[headerSize + 2 * channel] | (decoded[headerSize + 2 * channel + 1] << 8);
+    }
+    return DecodeResult::ok;
+  }
+
+}  // namespace lineSensorProtocol
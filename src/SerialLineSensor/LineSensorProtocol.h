@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/**
+ * @brief Wire format shared with arduino/line_sensor/line_sensor.ino
+ *
+ * Serial runs at 500000 baud (115200 for older firmware), 8N1.  Firmware samples at 1kHz.
+ *
+ * Firmware starts in ASCII mode at 50Hz, sending "l: %04d, c: %04d, r: %04d\r\n" per sample.  The host requests another
+ * version by sending "protocol <version>\n".  Firmware that supports it replies "\r\nprotocol <version>\r\n" and
+ * switches; older firmware ignores the request and stays in ASCII mode.
+ *
+ * Binary frames are COBS encoded and terminated by 0x00.  Decoded layout (little endian):
+ *   uint8_t  sequence         Incremented per frame, wraps at 256
+ *   uint8_t  channelCount
+ *   uint32_t timestamp        Firmware micros() at sample time
+ *   uint16_t channels[channelCount]
+ *   uint16_t crc              CRC-16/CCITT-FALSE over all preceding bytes
+ */
+namespace lineSensorProtocol {
+  constexpr uint8_t asciiVersion = 0;
+  constexpr uint8_t binaryVersion = 1;
+  constexpr std::string_view binaryVersionRequest = "protocol 1\n";
+  constexpr std::string_view binaryVersionAck = "protocol 1";
+  constexpr char asciiDelimiter = '\n';
+  constexpr char binaryDelimiter = '\0';
+
+  constexpr std::size_t maxChannels = 16;
+  constexpr std::size_t headerSize = 6;
+  constexpr std::size_t crcSize = 2;
+  constexpr std::size_t maxFrameSize = headerSize + 2 * maxChannels + crcSize;
+  /// COBS adds at most one byte per 254 bytes of payload
+  constexpr std::size_t maxEncodedFrameSize = maxFrameSize + 1;
+
+  struct Frame {
+    uint8_t sequence;
+    uint8_t channelCount;
+    uint32_t timestamp;  ///< Microseconds
+    std::array<uint16_t, maxChannels> channels;
+  };
+
+  enum class DecodeResult { ok, framingError, checksumError };
+
+  /**
+   * @brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+   */
+  [[nodiscard]] uint16_t Crc16(std::span<const uint8_t> data);
+
+  /**
+   * @brief Decode one COBS-encoded frame, excluding its 0x00 delimiter
+   *
+   * @param encoded Bytes received between delimiters
+   * @param frame Filled when result is DecodeResult::ok
+   * @return DecodeResult::framingError if COBS encoding or length is invalid, DecodeResult::checksumError if CRC does
+   *         not match
+   */
+  [[nodiscard]] DecodeResult DecodeFrame(std::string_view encoded, Frame& frame);
+
+  /**
+   * @brief Frames missing between two received sequence numbers
+   */
+  [[nodiscard]] constexpr uint8_t MissedFrames(const uint8_t previousSequence, const uint8_t sequence) {
+    return static_cast<uint8_t>(sequence - previousSequence - 1);
+  }
+}  // namespace lineSensorProtocol
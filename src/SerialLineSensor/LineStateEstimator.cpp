@@ -0,0 +1,114 @@
+#include "LineStateEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+LineStateEstimator::LineStateEstimator() : LineStateEstimator(Settings{}) {}
+
+LineStateEstimator::LineStateEstimator(const Settings& settings)
+    : m_settings{settings}, m_x{Vector::Zero()}, m_P{Matrix::Zero()} {}
+
+void LineStateEstimator::Reset() {
+  m_x.setZero();
+  m_P.setZero();
+  m_timestamp = std::nullopt;
+  m_initialized = false;
+}
+
+bool LineStateEstimator::Update(const std::chrono::microseconds timestamp,
+                                const std::optional<LineCentroid>& centroid,
+                                const Motion& motion) {
+  if (m_timestamp && timestamp <= m_timestamp.value()) {
+    return false;
+  }
+  const bool visible = centroid && centroid.value().weight >= m_settings.minimumWeight;
+
+  if (!m_initialized) {
+    m_timestamp = timestamp;
+    if (visible) {
+      // Nothing is known about heading or curvature until the offset has been tracked for a while
+      const double offsetStdDev = m_settings.measurementStdDev + m_settings.saturatedStdDev;
+      m_x << centroid.value().position, 0, 0;
+      m_P = Vector{offsetStdDev * offsetStdDev,
+                   m_settings.initialHeadingStdDev * m_settings.initialHeadingStdDev,
+                   m_settings.initialCurvatureStdDev * m_settings.initialCurvatureStdDev}
+                .asDiagonal();
+      m_lastMeasurement = timestamp;
+      m_initialized = true;
+    }
+    return true;
+  }
+
+  TimeUpdate(std::chrono::duration<double>(timestamp - m_timestamp.value()).count(), motion);
+  m_timestamp = timestamp;
+  if (!visible) {
+    return true;
+  }
+
+  // Less of the line under the array means a noisier centroid.  An edge-only reading is biased toward the array
+  const double stdDev = m_settings.measurementStdDev / std::min(centroid.value().weight, 1.0);
+  double variance = stdDev * stdDev;
+  if (centroid.value().saturated) {
+    variance += m_settings.saturatedStdDev * m_settings.saturatedStdDev;
+  }
+
+  // Scalar measurement of the offset (H = [1 0 0]), so no matrix inverse is needed
+  const double innovation = centroid.value().position - m_x(0);
+  const double innovationVariance = m_P(0, 0) + variance;
+  const Vector gain = m_P.col(0) / innovationVariance;
+  m_x += gain * innovation;
+  m_P -= gain * m_P.row(0);
+  m_P = 0.5 * (m_P + m_P.transpose()).eval();
+  m_lastMeasurement = timestamp;
+  return true;
+}
+
+std::optional<LineStateEstimator::Estimate> LineStateEstimator::Latest() const {
+  if (!m_initialized) {
+    return std::nullopt;
+  }
+  return Estimate{.timestamp = m_timestamp.value(),
+                  .lastMeasurement = m_lastMeasurement,
+                  .state = State{.lateralOffset = m_x(0), .headingError = m_x(1), .curvature = m_x(2)},
+                  .stdDev = State{.lateralOffset = std::sqrt(m_P(0, 0)),
+                                  .headingError = std::sqrt(m_P(1, 1)),
+                                  .curvature = std::sqrt(m_P(2, 2))}};
+}
+
+std::optional<LineStateEstimator::State> LineStateEstimator::Predict(const std::chrono::microseconds timestamp,
+                                                                     const Motion& motion) const {
+  if (!m_initialized) {
+    return std::nullopt;
+  }
+  const double dt = std::max(std::chrono::duration<double>(timestamp - m_timestamp.value()).count(), 0.0);
+  const Vector predicted = PredictMean(m_x, dt, motion);
+  return State{.lateralOffset = predicted(0), .headingError = predicted(1), .curvature = predicted(2)};
+}
+
+void LineStateEstimator::TimeUpdate(const double dt, const Motion& motion) {
+  const Matrix transition = Transition(dt, motion);
+  const Vector processVariance{m_settings.offsetProcessStdDev * m_settings.offsetProcessStdDev * dt,
+                               m_settings.headingProcessStdDev * m_settings.headingProcessStdDev * dt,
+                               m_settings.curvatureProcessStdDev * m_settings.curvatureProcessStdDev * dt};
+  m_x = PredictMean(m_x, dt, motion);
+  m_P = transition * m_P * transition.transpose();
+  m_P += processVariance.asDiagonal();
+}
+
+LineStateEstimator::Vector LineStateEstimator::PredictMean(const Vector& x, const double dt, const Motion& motion) {
+  // Exact for constant speed, yaw rate and curvature under the small angle approximation
+  const double distance = motion.speed * dt;
+  return Vector{
+      x(0) + distance * x(1) + 0.5 * distance * distance * x(2) - motion.lateralSpeed * dt -
+          0.5 * distance * motion.yawRate * dt,
+      x(1) + distance * x(2) - motion.yawRate * dt,
+      x(2),
+  };
+}
+
+LineStateEstimator::Matrix LineStateEstimator::Transition(const double dt, const Motion& motion) {
+  const double distance = motion.speed * dt;
+  Matrix transition;
+  transition << 1, distance, 0.5 * distance * distance, 0, 1, distance, 0, 0, 1;
+  return transition;
+}
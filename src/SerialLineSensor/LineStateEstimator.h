@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include <Eigen/Core>
+
+#include "LineSensorArray.h"
+
+/**
+ * @brief Kalman filter tracking the line relative to a moving sensor array.
+ *
+ * State is lateral offset y (m), heading error psi (rad) and curvature kappa (1/m), all positive toward the positive
+ * channel positions.  With forward speed u, lateral speed w and yaw rate omega of the array (small angles):
+ *   dy/dt = u * psi - w
+ *   dpsi/dt = u * kappa - omega
+ *   dkappa/dt = noise
+ * Only y is measured; heading and curvature become observable as the platform moves along the line.  All storage is
+ * fixed size.
+ */
+class LineStateEstimator {
+ public:
+  struct Settings {
+    double measurementStdDev{0.004};     ///< Centroid noise (m) with the full line under the array
+    double saturatedStdDev{0.02};        ///< Extra centroid noise (m) when only an edge channel sees the line
+    double minimumWeight{0.05};          ///< Centroids with less total weight are ignored
+    double offsetProcessStdDev{0.02};    ///< Lateral offset random walk (m/sqrt(s)), e.g. wheel slip
+    double headingProcessStdDev{0.2};    ///< Heading error random walk (rad/sqrt(s))
+    double curvatureProcessStdDev{1.0};  ///< Curvature random walk (1/m/sqrt(s))
+    double initialHeadingStdDev{0.3};    ///< Heading uncertainty (rad) when the line is first seen
+    double initialCurvatureStdDev{1.0};  ///< Curvature uncertainty (1/m) when the line is first seen
+  };
+
+  /// @brief Sensor array motion over the ground, in the array's frame
+  struct Motion {
+    double speed{0};         ///< Forward speed (m/s)
+    double lateralSpeed{0};  ///< Lateral speed (m/s), positive toward positive channel positions
+    double yawRate{0};       ///< Yaw rate (rad/s), positive turns the forward axis toward positive channel positions
+  };
+
+  struct State {
+    double lateralOffset;  ///< m
+    double headingError;   ///< rad
+    double curvature;      ///< 1/m
+  };
+
+  struct Estimate {
+    std::chrono::microseconds timestamp;        ///< Sensor time the estimate applies to
+    std::chrono::microseconds lastMeasurement;  ///< Sensor time of the most recent fused centroid
+    State state;
+    State stdDev;
+  };
+
+  LineStateEstimator();
+  explicit LineStateEstimator(const Settings& settings);
+
+  /**
+   * @brief Forget the line, e.g. when line following stops
+   */
+  void Reset();
+
+  /**
+   * @brief Advance to a sample and fuse its centroid
+   *
+   * @param timestamp Sensor time of the sample.  Samples not newer than the last one are ignored
+   * @param centroid Line position in the sample, or std::nullopt if the line is not visible
+   * @param motion Array motion since the previous sample
+   * @return true if the sample was used
+   */
+  bool Update(std::chrono::microseconds timestamp, const std::optional<LineCentroid>& centroid, const Motion& motion);
+
+  /// @brief Current estimate, or std::nullopt until the line has been seen
+  [[nodiscard]] std::optional<Estimate> Latest() const;
+
+  /**
+   * @brief Extrapolate the estimate without changing it, e.g. to when a command takes effect
+   *
+   * @param timestamp Sensor time to predict to.  Times before the estimate return the estimate
+   * @param motion Expected array motion until timestamp
+   */
+  [[nodiscard]] std::optional<State> Predict(std::chrono::microseconds timestamp, const Motion& motion) const;
+
+ private:
+  using Vector = Eigen::Vector3d;
+  using Matrix = Eigen::Matrix3d;
+
+  /// @brief Propagate mean and covariance by dt seconds
+  void TimeUpdate(double dt, const Motion& motion);
+  static Vector PredictMean(const Vector& x, double dt, const Motion& motion);
+  static Matrix Transition(double dt, const Motion& motion);
+
+  Settings m_settings;
+  Vector m_x;
+  Matrix m_P;
+  std::optional<std::chrono::microseconds> m_timestamp{std::nullopt};
+  std::chrono::microseconds m_lastMeasurement{0};
+  bool m_initialized{false};
+};
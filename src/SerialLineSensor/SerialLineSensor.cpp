@@ -1,95 +1,389 @@
 #include "SerialLineSensor.h"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <fcntl.h>
 #include <errno.h>
+#include <linux/netlink.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #include <termios.h>
 #include <unistd.h>
 
-SerialLineSensor::SerialLineSensor(const std::string& serialDeviceName, const std::chrono::milliseconds timeout)
-    : m_serialDeviceName{serialDeviceName}, m_timeout{timeout} {
+#include "LineSensorProtocol.h"
+#include "argosLib/general/asyncLog.h"
+#include "argosLib/general/durableFile.h"
+
+namespace {
+  /// Older firmware ignores version requests, so stop asking after a few.  Counted from the first ASCII record, since
+  /// opening the port resets the board and requests sent while the bootloader runs are lost
+  constexpr int maxVersionRequests = 3;
+  constexpr std::chrono::milliseconds versionRequestInterval{500};
+  /// Current firmware streams at 500k baud, older firmware at 115200.  Alternate until one produces valid records
+  constexpr std::array<speed_t, 2> baudRates{B500000, B115200};
+  constexpr std::array<int, 2> baudRateValues{500000, 115200};
+  /// Boards may reset when the port opens, so allow time for the bootloader before expecting data
+  constexpr std::chrono::milliseconds connectTimeout{2500};
+  /// Rescan interval when hotplug events are unavailable or opening the port failed
+  constexpr std::chrono::milliseconds fallbackScanInterval{1000};
+  /// After a hotplug event, look for the device this often until udev has created its links
+  constexpr std::chrono::milliseconds hotplugRetryInterval{100};
+  constexpr int maxHotplugRetries = 20;
+
+  void AddToEpoll(const int epollFd, const int fd) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      std::cerr << "Could not watch file descriptor " << fd << '\n';
+    }
+  }
+
+  /**
+   * @brief Open a socket receiving kernel device uevents
+   *
+   * @return Socket descriptor or -1 if unavailable (e.g. in a container)
+   */
+  int OpenHotplugSocket() {
+    const int hotplugSocket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (hotplugSocket < 0) {
+      return -1;
+    }
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;  // Kernel events
+    if (bind(hotplugSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+      close(hotplugSocket);
+      return -1;
+    }
+    return hotplugSocket;
+  }
+
+  /**
+   * @brief Drain pending uevents
+   *
+   * @return true if a tty device was added
+   */
+  bool ReadHotplugEvents(const int hotplugSocket) {
+    bool ttyAdded = false;
+    std::array<char, 4096> message;
+    ssize_t nBytes;
+    while ((nBytes = recv(hotplugSocket, message.data(), message.size(), 0)) > 0) {
+      // Message starts with "<action>@<devpath>\0" followed by KEY=value pairs
+      const std::string_view header(message.data(), strnlen(message.data(), nBytes));
+      if (header.starts_with("add@") && header.find("/tty/") != std::string_view::npos) {
+        ttyAdded = true;
+      }
+    }
+    return ttyAdded;
+  }
+
+  /**
+   * @brief Open and configure a serial port for non-blocking raw reads
+   *
+   * @return Port descriptor or std::nullopt on failure
+   */
+  std::optional<int> OpenSerialPort(const std::string& portFName, const speed_t baudRate) {
+    const int serialPort = open(portFName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (serialPort < 0) {
+      std::cerr << "Could not connect\n";
+      return std::nullopt;
+    }
+    struct termios tty;
+
+    if (tcgetattr(serialPort, &tty) != 0) {
+      std::cerr << "Could not get attributes\n";
+      close(serialPort);
+      return std::nullopt;
+    }
+
+    // Set baudrate
+    cfsetispeed(&tty, baudRate);
+    cfsetospeed(&tty, baudRate);
+
+    // 8N1
+    tty.c_cflag &= ~PARENB;
+    tty.c_cflag &= ~CSTOPB;
+    tty.c_cflag &= ~CSIZE;
+    tty.c_cflag |= CS8;
+
+    // Disable hardware based flow control
+    tty.c_cflag &= ~CRTSCTS;
+
+    // Enable receiver
+    tty.c_cflag |= CREAD | CLOCAL;
+
+    // Disable software based flow control
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+
+    // Termios non-canonical mode.  Records are split by LineReassembler, not the tty driver
+    tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ECHONL | ISIG);
+    tty.c_iflag &= ~(ICRNL | INLCR | IGNCR | ISTRIP);
+    tty.c_oflag &= ~OPOST;
+
+    // Reads return immediately; epoll signals when data is available
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+
+    // Save tty
+    if (tcsetattr(serialPort, TCSANOW, &tty) < 0) {
+      close(serialPort);
+      std::cerr << "Failed to configure port!\n";
+      return std::nullopt;
+    }
+
+    // Flush RX Buffer
+    if (tcflush(serialPort, TCIFLUSH) < 0) {
+      close(serialPort);
+      std::cerr << "Failed to flush buffer!\n";
+      return std::nullopt;
+    }
+    return serialPort;
+  }
+}  // namespace
+
+template <std::size_t N>
+BasicSerialLineSensor<N>::BasicSerialLineSensor(const std::string& serialDeviceName,
+                                                const std::chrono::milliseconds timeout,
+                                                const typename Filter::Settings& filterSettings)
+    : m_serialDeviceName{serialDeviceName}
+    , m_timeout{timeout}
+    , m_shutdownEvent{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}
+    , m_filter{filterSettings} {
   m_runThread.store(true);
-  m_receiveThread = std::thread(&SerialLineSensor::ReceiverThread, this);
+  m_receiveThread = std::thread(&BasicSerialLineSensor::ReceiverThread, this);
 }
 
-SerialLineSensor::SerialLineSensor(const std::chrono::milliseconds timeout)
-    : m_serialDeviceName{""}, m_timeout{timeout} {
+template <std::size_t N>
+BasicSerialLineSensor<N>::BasicSerialLineSensor(const std::chrono::milliseconds timeout,
+                                                const typename Filter::Settings& filterSettings)
+    : m_serialDeviceName{""}
+    , m_timeout{timeout}
+    , m_shutdownEvent{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}
+    , m_filter{filterSettings} {
   m_runThread.store(true);
-  m_receiveThread = std::thread(&SerialLineSensor::ReceiverThread, this);
+  m_receiveThread = std::thread(&BasicSerialLineSensor::ReceiverThread, this);
 }
 
-SerialLineSensor::~SerialLineSensor() {
+template <std::size_t N>
+BasicSerialLineSensor<N>::~BasicSerialLineSensor() {
   m_runThread.store(false);
+  // Wake the receive thread immediately
+  const uint64_t wake = 1;
+  if (write(m_shutdownEvent, &wake, sizeof(wake)) < 0) {
+    std::cerr << "Could not signal receive thread\n";
+  }
   m_receiveThread.join();
+  close(m_shutdownEvent);
+
+  if (m_saveThread.joinable()) {
+    {
+      std::scoped_lock lock(m_saveMutex);
+      m_stopSaving = true;
+    }
+    m_saveWake.notify_one();
+    m_saveThread.join();
+  }
+}
+
+template <std::size_t N>
+[[nodiscard]] typename BasicSerialLineSensor<N>::Snapshot BasicSerialLineSensor<N>::GetSnapshot() const {
+  return m_snapshot.Load();
+}
+
+template <std::size_t N>
+[[nodiscard]] std::optional<typename LineSensorArray<N>::ChannelMask> BasicSerialLineSensor<N>::GetDetectedChannels()
+    const {
+  return GetDetectedChannels(GetSnapshot(), std::chrono::steady_clock::now());
 }
 
-[[nodiscard]] std::optional<int16_t> SerialLineSensor::GetRawLeft() const {
-  auto rawValues = GetRawArrayStatus();
-  if (!rawValues) {
+template <std::size_t N>
+[[nodiscard]] std::optional<typename LineSensorArray<N>::ChannelMask> BasicSerialLineSensor<N>::GetDetectedChannels(
+    const Snapshot& snapshot, const TimePoint now) const {
+  auto proportional = GetProportionalArrayStatus(snapshot, now);
+  if (!proportional) {
     return std::nullopt;
   }
-  return rawValues.value().left;
+  return Array::Threshold(proportional.value(), detectionLevel);
 }
 
-[[nodiscard]] std::optional<int16_t> SerialLineSensor::GetRawCenter() const {
-  auto rawValues = GetRawArrayStatus();
-  if (!rawValues) {
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::Channels>
+BasicSerialLineSensor<N>::GetProportionalArrayStatus() const {
+  return GetProportionalArrayStatus(GetSnapshot(), std::chrono::steady_clock::now());
+}
+
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::Channels>
+BasicSerialLineSensor<N>::GetProportionalArrayStatus(const Snapshot& snapshot, const TimePoint now) const {
+  if (TimedOut(snapshot, now)) {
     return std::nullopt;
   }
-  return rawValues.value().center;
+  return snapshot.proportional;
 }
 
-[[nodiscard]] std::optional<int16_t> SerialLineSensor::GetRawRight() const {
-  auto rawValues = GetRawArrayStatus();
-  if (!rawValues) {
-    return std::nullopt;
+template <std::size_t N>
+void BasicSerialLineSensor<N>::SetCalibration(const Calibration& calibration) {
+  std::scoped_lock lock(m_calibratorMutex, m_filterMutex);
+  m_calibrator.SetCalibration(calibration);
+  m_array.SetCalibration(calibration);
+}
+
+template <std::size_t N>
+[[nodiscard]] typename BasicSerialLineSensor<N>::Calibration BasicSerialLineSensor<N>::GetCalibration() const {
+  std::scoped_lock lock(m_filterMutex);
+  return m_array.GetCalibration();
+}
+
+template <std::size_t N>
+bool BasicSerialLineSensor<N>::LoadCalibration(const std::filesystem::path& file) {
+  std::ifstream calibrationFile(file);
+  std::scoped_lock lock(m_calibratorMutex, m_filterMutex);
+  if (!calibrationFile || !m_calibrator.Load(calibrationFile)) {
+    return false;
   }
-  return rawValues.value().right;
+  m_array.SetCalibration(m_calibrator.GetCalibration());
+  return true;
 }
 
-[[nodiscard]] std::optional<SensorArrayStatus> SerialLineSensor::GetArrayStatus() const {
-  auto rawValues = GetRawArrayStatus();
-  if (!rawValues) {
-    return std::nullopt;
+template <std::size_t N>
+bool BasicSerialLineSensor<N>::SaveCalibration(const std::filesystem::path& file) const {
+  std::ostringstream contents;
+  {
+    std::scoped_lock lock(m_calibratorMutex);
+    m_calibrator.Save(contents);
+  }
+  std::error_code error;
+  std::filesystem::create_directories(file.parent_path(), error);
+  const auto text = contents.str();
+  return ArgosLib::ReplaceFileDurably(file, std::as_bytes(std::span{text}));
+}
+
+template <std::size_t N>
+void BasicSerialLineSensor<N>::SaveCalibrationOnChange(const std::filesystem::path& file,
+                                                       const std::chrono::milliseconds minInterval) {
+  if (!m_saveThread.joinable()) {
+    m_saveThread = std::thread(&BasicSerialLineSensor::SaveThread, this, file, minInterval);
   }
-  return SensorArrayStatus{.leftLineDetected = rawValues.value().left < m_calibrationActivateThreshold,
-                           .centerLineDetected = rawValues.value().center < m_calibrationActivateThreshold,
-                           .rightLineDetected = rawValues.value().right < m_calibrationActivateThreshold};
 }
 
-[[nodiscard]] std::optional<ProportionalArrayStatus> SerialLineSensor::GetProportionalArrayStatus() const {
-  auto rawValues = GetRawArrayStatus();
-  if (!rawValues) {
+template <std::size_t N>
+void BasicSerialLineSensor<N>::SaveThread(const std::filesystem::path file,
+                                          const std::chrono::milliseconds minInterval) {
+  std::unique_lock lock(m_saveMutex);
+  std::optional<std::chrono::steady_clock::time_point> lastSave;
+  while (true) {
+    m_saveWake.wait(lock, [this]() { return m_calibrationChanged || m_stopSaving; });
+    // Thresholds settle over several re-estimates, so wait out the interval and save the latest
+    if (lastSave) {
+      m_saveWake.wait_until(lock, lastSave.value() + minInterval, [this]() { return m_stopSaving; });
+    }
+    if (m_calibrationChanged) {
+      m_calibrationChanged = false;
+      lock.unlock();
+      if (!SaveCalibration(file)) {
+        ARGOS_LOG(ArgosLib::LogLevel::kError, "Could not save line sensor calibration");
+      }
+      lastSave = std::chrono::steady_clock::now();
+      lock.lock();
+    }
+    if (m_stopSaving) {
+      return;
+    }
+  }
+}
+
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::RawChannels>
+BasicSerialLineSensor<N>::GetRawArrayStatus() const {
+  return GetRawArrayStatus(GetSnapshot(), std::chrono::steady_clock::now());
+}
+
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::RawChannels> BasicSerialLineSensor<N>::GetRawArrayStatus(
+    const Snapshot& snapshot, const TimePoint now) const {
+  if (TimedOut(snapshot, now)) {
     return std::nullopt;
   }
-  double range = m_calibrationDeactivateThreshold - m_calibrationActivateThreshold;
-  return ProportionalArrayStatus{
-      .left = std::clamp((m_calibrationDeactivateThreshold - rawValues.value().left) / range, 0.0, 1.0),
-      .center = std::clamp((m_calibrationDeactivateThreshold - rawValues.value().center) / range, 0.0, 1.0),
-      .right = std::clamp((m_calibrationDeactivateThreshold - rawValues.value().right) / range, 0.0, 1.0)};
+  return snapshot.raw;
 }
 
-[[nodiscard]] std::optional<RawSensorArrayStatus> SerialLineSensor::GetRawArrayStatus() const {
-  std::scoped_lock lock(m_dataMutex);
-  auto timeout = (std::chrono::steady_clock::now() - m_lastUpdateTime) > m_timeout;
-  if (timeout || !m_currentLeft || !m_currentCenter || !m_currentRight) {
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::FilteredSample>
+BasicSerialLineSensor<N>::GetFilteredArrayStatus() const {
+  const auto snapshot = GetSnapshot();
+  if (TimedOut(snapshot, std::chrono::steady_clock::now())) {
     return std::nullopt;
   }
-  return RawSensorArrayStatus{
-      .left = m_currentLeft.value(), .center = m_currentCenter.value(), .right = m_currentRight.value()};
+  return snapshot.filtered;
+}
+
+template <std::size_t N>
+std::size_t BasicSerialLineSensor<N>::GetFilteredHistory(std::span<FilteredSample> destination) const {
+  return GetFilteredHistory(GetSnapshot(), std::chrono::steady_clock::now(), destination);
 }
 
-[[nodiscard]] SerialLineSensor::RecoveryDirection SerialLineSensor::GetRecoveryDirection() {
-  std::scoped_lock lock(m_dataMutex);
-  if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_recoveryStartTime) >
-      m_recoveryTime) {
-    m_activeRecoveryDirection = RecoveryDirection::Timeout;
+template <std::size_t N>
+std::size_t BasicSerialLineSensor<N>::GetFilteredHistory(const Snapshot& snapshot,
+                                                         const TimePoint now,
+                                                         std::span<FilteredSample> destination) const {
+  if (TimedOut(snapshot, now)) {
+    return 0;
   }
-  return m_activeRecoveryDirection;
+  std::scoped_lock lock(m_filterMutex);
+  return m_filter.CopyHistory(destination);
 }
 
-[[nodiscard]] bool SerialLineSensor::GetRecoveryActive() {
-  switch (GetRecoveryDirection()) {
+template <std::size_t N>
+std::size_t BasicSerialLineSensor<N>::GetProportionalHistory(std::span<FilteredSample> destination) const {
+  return GetProportionalHistory(GetSnapshot(), std::chrono::steady_clock::now(), destination);
+}
+
+template <std::size_t N>
+std::size_t BasicSerialLineSensor<N>::GetProportionalHistory(const Snapshot& snapshot,
+                                                             const TimePoint now,
+                                                             std::span<FilteredSample> destination) const {
+  if (TimedOut(snapshot, now)) {
+    return 0;
+  }
+  std::scoped_lock lock(m_filterMutex);
+  const auto count = m_filter.CopyHistory(destination);
+  for (auto& sample : destination.first(count)) {
+    sample.channels = m_array.Normalize(sample.channels);
+  }
+  return count;
+}
+
+template <std::size_t N>
+[[nodiscard]] typename BasicSerialLineSensor<N>::RecoveryDirection BasicSerialLineSensor<N>::GetRecoveryDirection()
+    const {
+  return GetRecoveryDirection(GetSnapshot(), std::chrono::steady_clock::now());
+}
+
+template <std::size_t N>
+[[nodiscard]] typename BasicSerialLineSensor<N>::RecoveryDirection BasicSerialLineSensor<N>::GetRecoveryDirection(
+    const Snapshot& snapshot, const TimePoint now) const {
+  if (std::chrono::duration_cast<std::chrono::milliseconds>(now - snapshot.recoveryStartTime) > m_recoveryTime) {
+    return RecoveryDirection::Timeout;
+  }
+  return snapshot.recoveryDirection;
+}
+
+template <std::size_t N>
+[[nodiscard]] bool BasicSerialLineSensor<N>::GetRecoveryActive() const {
+  return GetRecoveryActive(GetSnapshot(), std::chrono::steady_clock::now());
+}
+
+template <std::size_t N>
+[[nodiscard]] bool BasicSerialLineSensor<N>::GetRecoveryActive(const Snapshot& snapshot, const TimePoint now) const {
+  switch (GetRecoveryDirection(snapshot, now)) {
     case RecoveryDirection::Left:
     case RecoveryDirection::Right:
       return true;
@@ -98,10 +392,70 @@ SerialLineSensor::~SerialLineSensor() {
   }
 }
 
-void SerialLineSensor::ReceiverThread() {
+template <std::size_t N>
+[[nodiscard]] uint32_t BasicSerialLineSensor<N>::GetFramingErrorCount() const {
+  return m_framingErrors.load();
+}
+
+template <std::size_t N>
+[[nodiscard]] uint32_t BasicSerialLineSensor<N>::GetCorruptFrameCount() const {
+  return m_corruptFrames.load();
+}
+
+template <std::size_t N>
+[[nodiscard]] uint32_t BasicSerialLineSensor<N>::GetDroppedFrameCount() const {
+  return m_droppedFrames.load();
+}
+
+template <std::size_t N>
+[[nodiscard]] uint8_t BasicSerialLineSensor<N>::GetProtocolVersion() const {
+  return m_protocolVersion.load();
+}
+
+template <std::size_t N>
+[[nodiscard]] bool BasicSerialLineSensor<N>::TimedOut(const Snapshot& snapshot, const TimePoint now) const {
+  return snapshot.sequence == 0 || (now - snapshot.updateTime) > m_timeout;
+}
+
+template <std::size_t N>
+void BasicSerialLineSensor<N>::ReceiverThread() {
+  LineReassembler reassembler;
+  int versionRequests = 0;
+  std::chrono::time_point<std::chrono::steady_clock> lastVersionRequestTime;
+  std::size_t baudIndex = 0;
+  std::chrono::time_point<std::chrono::steady_clock> connectTime;
+  std::chrono::time_point<std::chrono::steady_clock> lastRecordTime;
+  bool recordReceived = false;
+  // Next time to look for the device.  Empty while waiting for a hotplug event
+  std::optional<std::chrono::time_point<std::chrono::steady_clock>> nextScanTime{std::chrono::steady_clock::now()};
+  int hotplugRetries = 0;
+
+  const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) {
+    std::cerr << "Could not create epoll instance\n";
+    return;
+  }
+  AddToEpoll(epollFd, m_shutdownEvent);
+  const int hotplugSocket = OpenHotplugSocket();
+  if (hotplugSocket >= 0) {
+    AddToEpoll(epollFd, hotplugSocket);
+  } else {
+    std::cerr << "Hotplug events unavailable, polling for line sensor\n";
+  }
+
+  auto disconnect = [&]() {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, m_serialPort, nullptr);
+    close(m_serialPort);
+    m_connected = false;
+    // Device may still be present, e.g. after switching baud rate
+    nextScanTime = std::chrono::steady_clock::now();
+  };
+
   while (m_runThread.load()) {
+    auto now = std::chrono::steady_clock::now();
+
     // Connect
-    while (m_runThread.load() && !m_connected) {
+    if (!m_connected && nextScanTime && now >= nextScanTime.value()) {
       std::string portFName = m_serialDeviceName;
       if (portFName.empty()) {
         auto discoveredPort = DiscoverSerialDevice();
@@ -110,108 +464,121 @@ void SerialLineSensor::ReceiverThread() {
         }
       }
 
-      std::cout << "Port name: " << portFName << '\n';
-
-      if (portFName.empty()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        continue;
-      }
-
-      m_serialPort = open(portFName.c_str(), O_RDWR | O_NOCTTY);
-      if (m_serialPort >= 0) {
-        struct termios tty;
-
-        if (tcgetattr(m_serialPort, &tty) != 0) {
-          std::cerr << "Could not get attributes\n";
-          close(m_serialPort);
-          continue;
+      if (portFName.empty() || !std::filesystem::exists(portFName)) {
+        if (hotplugRetries > 0) {
+          // Device links are created shortly after the kernel announces the device
+          --hotplugRetries;
+          nextScanTime = now + hotplugRetryInterval;
+        } else if (hotplugSocket < 0) {
+          nextScanTime = now + fallbackScanInterval;
+        } else {
+          nextScanTime = std::nullopt;
         }
+      } else {
+        std::cout << "Port name: " << portFName << " (" << baudRateValues[baudIndex] << " baud)\n";
+        auto serialPort = OpenSerialPort(portFName, baudRates[baudIndex]);
+        if (serialPort) {
+          m_serialPort = serialPort.value();
+          AddToEpoll(epollFd, m_serialPort);
+
+          // Sensor may have been left in binary mode by a previous connection; ASCII ack lines are still recognized
+          reassembler.Reset();
+          reassembler.SetDelimiter(lineSensorProtocol::asciiDelimiter);
+          m_protocolVersion.store(lineSensorProtocol::asciiVersion);
+          m_lastSequence = std::nullopt;
+          m_lastFirmwareTimestamp = std::nullopt;
+          {
+            std::scoped_lock lock(m_filterMutex);
+            m_filter.Reset();
+          }
+          versionRequests = 0;
+          lastVersionRequestTime = {};
+          connectTime = now;
+          recordReceived = false;
+          m_connected = true;
+        } else {
+          nextScanTime = now + fallbackScanInterval;
+        }
+      }
+    }
 
-        // Set baudrate
-        cfsetispeed(&tty, B115200);
-        cfsetospeed(&tty, B115200);
-
-        // 8N1
-        tty.c_cflag &= ~PARENB;
-        tty.c_cflag &= ~CSTOPB;
-        tty.c_cflag &= ~CSIZE;
-        tty.c_cflag |= CS8;
-
-        // Disable hardware based flow control
-        tty.c_cflag &= ~CRTSCTS;
-
-        // Enable receiver
-        tty.c_cflag |= CREAD | CLOCAL;
-
-        // Disable software based flow control
-        tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+    // Records show the firmware is running and listening
+    const bool requestVersion = m_connected && recordReceived &&
+                                m_protocolVersion.load() == lineSensorProtocol::asciiVersion &&
+                                versionRequests < maxVersionRequests;
+    if (requestVersion && now - lastVersionRequestTime > versionRequestInterval) {
+      const auto& request = lineSensorProtocol::binaryVersionRequest;
+      if (write(m_serialPort, request.data(), request.size()) < 0) {
+        std::cerr << "Failed to request protocol version\n";
+      }
+      ++versionRequests;
+      lastVersionRequestTime = now;
+    }
 
-        // Termois Non Canonical Mode
-        tty.c_lflag |= ICANON;
+    // Sleep until data, hotplug, shutdown or the next deadline
+    std::optional<std::chrono::time_point<std::chrono::steady_clock>> deadline{std::nullopt};
+    if (m_connected) {
+      deadline = recordReceived ? lastRecordTime + m_timeout : connectTime + connectTimeout;
+      if (requestVersion) {
+        deadline = std::min(deadline.value(), lastVersionRequestTime + versionRequestInterval);
+      }
+    } else {
+      deadline = nextScanTime;
+    }
+    int timeoutMs = -1;
+    if (deadline) {
+      // Round up so the deadline has passed on wake
+      timeoutMs = std::max<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(deadline.value() - std::chrono::steady_clock::now()).count(), 0);
+    }
 
-        // Timeout in deciseconds for read
-        tty.c_cc[VTIME] = 1;
+    std::array<epoll_event, 4> events;
+    const int nEvents = epoll_wait(epollFd, events.data(), events.size(), timeoutMs);
+    if (nEvents < 0 && errno != EINTR) {
+      ARGOS_LOG_EVERY(std::chrono::seconds{1}, ArgosLib::LogLevel::kError, "epoll_wait failed");
+      break;
+    }
 
-        // Save tty
-        if (tcsetattr(m_serialPort, TCSANOW, &tty) < 0) {
-          close(m_serialPort);
-          std::cerr << "Failed to configure port!\n";
-          continue;
+    for (int i = 0; i < nEvents; ++i) {
+      const int eventFd = events[i].data.fd;
+      if (eventFd == m_shutdownEvent) {
+        continue;
+      } else if (eventFd == hotplugSocket) {
+        if (ReadHotplugEvents(hotplugSocket) && !m_connected) {
+          nextScanTime = std::chrono::steady_clock::now();
+          hotplugRetries = maxHotplugRetries;
         }
-
-        // Flush RX Buffer
-        if (tcflush(m_serialPort, TCIFLUSH) < 0) {
-          close(m_serialPort);
-          std::cerr << "Failed to flush buffer!\n";
-          continue;
+      } else if (m_connected && eventFd == m_serialPort) {
+        if (events[i].events & EPOLLIN) {
+          const auto receiveBuffer = reassembler.WritableSpan();
+          const auto nBytes = read(m_serialPort, receiveBuffer.data(), receiveBuffer.size());
+          if (nBytes > 0) {
+            reassembler.Commit(nBytes);
+            if (ProcessRecords(reassembler)) {
+              lastRecordTime = m_working.updateTime;
+              recordReceived = true;
+            }
+          } else if (nBytes < 0 && errno != EAGAIN && errno != EINTR) {
+            ARGOS_LOG(ArgosLib::LogLevel::kError, "Bad data received");
+            disconnect();
+            continue;
+          }
+        }
+        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+          ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Line sensor disconnected");
+          disconnect();
         }
-
-        m_connected = true;
-
-      } else {
-        std::cerr << "Could not connect\n";
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
       }
     }
 
-    // Receive data
-    while (m_runThread.load() && m_connected) {
-      char buf[256];
-
-      int nBytes = read(m_serialPort, &buf, sizeof(buf));
-
-      if (nBytes < 0) {
-        std::cerr << "Bad data received\n";
-        close(m_serialPort);
-        m_connected = false;
-      } else if (nBytes > 0) {
-        auto rawStates = ParseMessage(std::string_view(buf, nBytes));
-        if (rawStates) {
-          std::scoped_lock lock(m_dataMutex);
-          if (m_currentLeft <= m_calibrationDeactivateThreshold && m_currentRight > m_calibrationDeactivateThreshold) {
-            m_activeRecoveryDirection = RecoveryDirection::Left;
-          } else if (m_currentRight <= m_calibrationDeactivateThreshold &&
-                     m_currentLeft > m_calibrationDeactivateThreshold) {
-            m_activeRecoveryDirection = RecoveryDirection::Right;
-          }
-          /// @todo fix left/right in arduino code or something...
-          m_currentLeft = rawStates.value().right;
-          m_currentCenter = rawStates.value().center;
-          m_currentRight = rawStates.value().left;
-          if (m_currentLeft < m_calibrationDeactivateThreshold || m_currentCenter < m_calibrationDeactivateThreshold ||
-              m_currentRight < m_calibrationDeactivateThreshold) {
-            m_activeRecoveryDirection = RecoveryDirection::LineDetected;
-            m_recoveryStartTime = std::chrono::steady_clock::now();
-          }
-          m_lastUpdateTime = std::chrono::steady_clock::now();
-          std::cout << m_currentLeft.value() << ' ' << m_currentCenter.value() << ' ' << m_currentRight.value() << '\n';
-        }
-      } else if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
-                                                                       m_lastUpdateTime) > m_timeout) {
-        std::cerr << "Lost connection\n";
-        close(m_serialPort);
-        m_connected = false;
+    // Garbage (e.g. wrong baud rate) counts as lost connection too
+    now = std::chrono::steady_clock::now();
+    if (m_connected && (recordReceived ? now - lastRecordTime > m_timeout : now - connectTime > connectTimeout)) {
+      ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Lost connection");
+      if (!recordReceived) {
+        baudIndex = (baudIndex + 1) % baudRates.size();
       }
+      disconnect();
     }
   }
 
@@ -219,32 +586,158 @@ void SerialLineSensor::ReceiverThread() {
     close(m_serialPort);
     m_connected = false;
   }
+  if (hotplugSocket >= 0) {
+    close(hotplugSocket);
+  }
+  close(epollFd);
 }
 
-[[nodiscard]] std::optional<RawSensorArrayStatus> SerialLineSensor::ParseMessage(std::string_view message) {
-  if (message.size() < 25) {
-    std::cerr << "Not enough data (" << message.size() << ")\n";
-    return std::nullopt;
+template <std::size_t N>
+bool BasicSerialLineSensor<N>::ProcessRecords(LineReassembler& reassembler) {
+  bool filterUpdated = false;
+  while (auto line = reassembler.NextLine()) {
+    if (line.value().empty()) {
+      continue;
+    }
+    if (m_protocolVersion.load() == lineSensorProtocol::binaryVersion) {
+      lineSensorProtocol::Frame frame;
+      switch (lineSensorProtocol::DecodeFrame(line.value(), frame)) {
+        case lineSensorProtocol::DecodeResult::ok:
+          if (m_lastSequence) {
+            m_droppedFrames += lineSensorProtocol::MissedFrames(m_lastSequence.value(), frame.sequence);
+          }
+          m_lastSequence = frame.sequence;
+          if (m_lastFirmwareTimestamp) {
+            // Unsigned difference is correct across micros() rollover
+            m_sensorTime +=
+                std::chrono::microseconds{static_cast<uint32_t>(frame.timestamp - m_lastFirmwareTimestamp.value())};
+          } else {
+            m_sensorTime = std::chrono::microseconds{frame.timestamp};
+          }
+          m_lastFirmwareTimestamp = frame.timestamp;
+          if (frame.channelCount == N) {
+            filterUpdated |= AddSample(m_sensorTime, std::span<const uint16_t, N>{frame.channels.data(), N});
+          } else {
+            ++m_parseErrors;
+          }
+          break;
+        case lineSensorProtocol::DecodeResult::checksumError:
+          ++m_corruptFrames;
+          break;
+        case lineSensorProtocol::DecodeResult::framingError:
+          ++m_parseErrors;
+          break;
+      }
+    } else if (line.value() == lineSensorProtocol::binaryVersionAck) {
+      // Remainder of the stream is binary frames with firmware timestamps
+      reassembler.SetDelimiter(lineSensorProtocol::binaryDelimiter);
+      m_protocolVersion.store(lineSensorProtocol::binaryVersion);
+      {
+        std::scoped_lock lock(m_filterMutex);
+        m_filter.Reset();
+      }
+      ARGOS_LOG(ArgosLib::LogLevel::kInfo, "Line sensor using binary protocol");
+    } else {
+      auto parsed = ParseMessage(line.value());
+      if (parsed) {
+        // ASCII records carry no timestamp, so use receive time
+        filterUpdated |= AddSample(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()),
+            parsed.value());
+      } else {
+        ++m_parseErrors;
+      }
+    }
   }
-  if (message.substr(0, 3) != "l: " || message.substr(7, 5) != ", c: " || message.substr(16, 5) != ", r: ") {
-    std::cerr << "Didn't find stuff\n";
-    return std::nullopt;
+  m_framingErrors.store(m_parseErrors + reassembler.GetDiscardedLines());
+  if (!filterUpdated) {
+    return false;
   }
-  try {
-    return RawSensorArrayStatus{
-        .left = static_cast<uint16_t>(std::stoul(std::string(message.substr(3, 4)), nullptr, 10)),
-        .center = static_cast<uint16_t>(std::stoul(std::string(message.substr(12, 4)), nullptr, 10)),
-        .right = static_cast<uint16_t>(std::stoul(std::string(message.substr(21, 4)), nullptr, 10))};
-  } catch (std::invalid_argument&) {
-    std::cerr << "Invalid argument\n";
-    return std::nullopt;
-  } catch (std::out_of_range&) {
-    std::cerr << "Out of range\n";
+
+  std::unique_lock lock(m_filterMutex);
+  const auto filtered = m_filter.Latest().value();
+  // Direction to search if the line is lost is the edge it was last seen under
+  const auto previouslySeen = Array::Threshold(m_working.proportional, visibleLevel);
+  if ((previouslySeen & Array::firstChannel) && !(previouslySeen & Array::lastChannel)) {
+    m_working.recoveryDirection = RecoveryDirection::Left;
+  } else if ((previouslySeen & Array::lastChannel) && !(previouslySeen & Array::firstChannel)) {
+    m_working.recoveryDirection = RecoveryDirection::Right;
+  }
+  std::transform(filtered.channels.begin(), filtered.channels.end(), m_working.raw.begin(), [](const double channel) {
+    return static_cast<uint16_t>(std::lround(channel));
+  });
+  m_working.proportional = m_array.Normalize(filtered.channels);
+  lock.unlock();
+  m_working.filtered = filtered;
+  if (Array::Threshold(m_working.proportional, visibleLevel) != 0) {
+    m_working.recoveryDirection = RecoveryDirection::LineDetected;
+    m_working.recoveryStartTime = std::chrono::steady_clock::now();
+  }
+  m_working.updateTime = std::chrono::steady_clock::now();
+  ++m_working.sequence;
+  m_snapshot.Store(m_working);
+  return true;
+}
+
+template <std::size_t N>
+bool BasicSerialLineSensor<N>::AddSample(const std::chrono::microseconds timestamp,
+                                         std::span<const uint16_t, N> rawValues) {
+  /// @todo fix left/right in arduino code or something...
+  Channels channels;
+  std::reverse_copy(rawValues.begin(), rawValues.end(), channels.begin());
+  // Re-estimation scans a histogram, so it runs without m_filterMutex to keep readers from waiting on it
+  std::optional<Calibration> learned;
+  {
+    std::scoped_lock lock(m_calibratorMutex);
+    if (m_calibrator.AddSample(channels)) {
+      learned = m_calibrator.GetCalibration();
+    }
+  }
+  if (learned) {
+    {
+      std::scoped_lock lock(m_saveMutex);
+      m_calibrationChanged = true;
+    }
+    m_saveWake.notify_one();
+  }
+  std::scoped_lock lock(m_filterMutex);
+  if (learned) {
+    m_array.SetCalibration(learned.value());
+  }
+  return m_filter.AddSample(timestamp, channels);
+}
+
+template <std::size_t N>
+[[nodiscard]] std::optional<typename BasicSerialLineSensor<N>::RawChannels> BasicSerialLineSensor<N>::ParseMessage(
+    std::string_view message) {
+  // Expected format: "<label>: %04d" per channel separated by ", ", e.g. "l: %04d, c: %04d, r: %04d"
+  RawChannels values;
+  for (std::size_t i = 0; i < N; ++i) {
+    if (i > 0) {
+      if (!message.starts_with(", ")) {
+        return std::nullopt;
+      }
+      message.remove_prefix(2);
+    }
+    const auto labelEnd = message.find(": ");
+    if (labelEnd == std::string_view::npos) {
+      return std::nullopt;
+    }
+    message.remove_prefix(labelEnd + 2);
+    const auto [fieldEnd, error] = std::from_chars(message.data(), message.data() + message.size(), values[i]);
+    if (error != std::errc{}) {
+      return std::nullopt;
+    }
+    message.remove_prefix(fieldEnd - message.data());
+  }
+  if (!message.empty()) {
     return std::nullopt;
   }
+  return values;
 }
 
-[[nodiscard]] std::optional<std::filesystem::path> SerialLineSensor::DiscoverSerialDevice() {
+template <std::size_t N>
+[[nodiscard]] std::optional<std::filesystem::path> BasicSerialLineSensor<N>::DiscoverSerialDevice() {
   try {
     for (const auto& candidatePort : std::filesystem::directory_iterator("/dev/serial/by-id")) {
       auto candidatePortFname = candidatePort.path().filename().string();
@@ -262,3 +755,7 @@ void SerialLineSensor::ReceiverThread() {
     return std::nullopt;
   }
 }
+
+template class BasicSerialLineSensor<3>;
+template class BasicSerialLineSensor<8>;
+template class BasicSerialLineSensor<16>;
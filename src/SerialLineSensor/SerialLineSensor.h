@@ -1,71 +1,192 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
 #include <filesystem>
+#include <limits>
+#include <span>
 
-struct SensorArrayStatus {
-  bool leftLineDetected;
-  bool centerLineDetected;
-  bool rightLineDetected;
-};
-
-struct RawSensorArrayStatus {
-  uint16_t left;
-  uint16_t center;
-  uint16_t right;
-};
+#include "LineReassembler.h"
+#include "LineSensorArray.h"
+#include "LineSensorCalibrator.h"
+#include "LineSensorFilter.h"
+#include "argosLib/general/seqlock.h"
 
-struct ProportionalArrayStatus {
-  double left;    ///< 0=no line, 1=full line
-  double center;  ///< 0=no line, 1=full line
-  double right;   ///< 0=no line, 1=full line
-};
-
-class SerialLineSensor {
+/**
+ * @brief Reads a reflectance sensor bar over serial and publishes normalized samples
+ *
+ * @tparam N Number of sensor channels.  Must match the firmware
+ */
+template <std::size_t N>
+class BasicSerialLineSensor {
  public:
   enum class RecoveryDirection { LineDetected, Left, Right, Timeout };
-  SerialLineSensor(const std::string& serialDeviceName, const std::chrono::milliseconds timeout);
-  SerialLineSensor(const std::chrono::milliseconds timeout);
-  ~SerialLineSensor();
+  constexpr static std::size_t channelCount = N;
+  using Array = LineSensorArray<N>;
+  using Calibration = typename Array::Calibration;
+  using Channels = typename Array::Channels;  ///< Ordered left to right
+  using RawChannels = std::array<uint16_t, N>;
+  using Filter = LineSensorFilter<N>;
+  using FilteredSample = typename Filter::Sample;
+
+  BasicSerialLineSensor(const std::string& serialDeviceName,
+                        const std::chrono::milliseconds timeout,
+                        const typename Filter::Settings& filterSettings = typename Filter::Settings{});
+  BasicSerialLineSensor(const std::chrono::milliseconds timeout,
+                        const typename Filter::Settings& filterSettings = typename Filter::Settings{});
+  ~BasicSerialLineSensor();
+
+  /**
+   * @brief Everything published by the receive thread for one sample.  Trivially copyable so it can be read without
+   *        locking
+   */
+  struct Snapshot {
+    uint32_t sequence{0};  ///< Incremented for every published sample.  0 until the first sample arrives
+    RawChannels raw{};
+    Channels proportional{};  ///< 0=no line, 1=full line
+    FilteredSample filtered{};
+    std::chrono::steady_clock::time_point updateTime{};
+    std::chrono::steady_clock::time_point recoveryStartTime{};
+    RecoveryDirection recoveryDirection{RecoveryDirection::Timeout};
+  };
 
-  [[nodiscard]] std::optional<int16_t> GetRawLeft() const;
-  [[nodiscard]] std::optional<int16_t> GetRawCenter() const;
-  [[nodiscard]] std::optional<int16_t> GetRawRight() const;
+  using TimePoint = std::chrono::steady_clock::time_point;
 
-  [[nodiscard]] std::optional<SensorArrayStatus> GetArrayStatus() const;
-  [[nodiscard]] std::optional<RawSensorArrayStatus> GetRawArrayStatus() const;
-  [[nodiscard]] std::optional<ProportionalArrayStatus> GetProportionalArrayStatus() const;
+  /**
+   * @brief Latest sensor state.  Never blocks.  Use the overloads below to interpret one consistent sample at one
+   *        time, e.g. the current control loop tick.  Overloads without a time read the clock themselves
+   */
+  [[nodiscard]] Snapshot GetSnapshot() const;
 
-  [[nodiscard]] RecoveryDirection GetRecoveryDirection();
+  /// @brief Channels fully over the line
+  [[nodiscard]] std::optional<typename Array::ChannelMask> GetDetectedChannels() const;
+  [[nodiscard]] std::optional<typename Array::ChannelMask> GetDetectedChannels(const Snapshot& snapshot,
+                                                                               TimePoint now) const;
+  [[nodiscard]] std::optional<RawChannels> GetRawArrayStatus() const;
+  [[nodiscard]] std::optional<RawChannels> GetRawArrayStatus(const Snapshot& snapshot, TimePoint now) const;
+  /// @brief Line coverage per channel, 0=no line, 1=full line
+  [[nodiscard]] std::optional<Channels> GetProportionalArrayStatus() const;
+  [[nodiscard]] std::optional<Channels> GetProportionalArrayStatus(const Snapshot& snapshot, TimePoint now) const;
 
-  [[nodiscard]] bool GetRecoveryActive();
+  /// @brief Replace the per-channel calibration.  Applies from the next sample and is refined online from there
+  void SetCalibration(const Calibration& calibration);
+  /// @brief Calibration in use, including online refinements
+  [[nodiscard]] Calibration GetCalibration() const;
+  /**
+   * @brief Restore a calibration written by SaveCalibration(), e.g. from a previous run
+   *
+   * @return false if the file is missing, malformed or for a different channel count
+   */
+  bool LoadCalibration(const std::filesystem::path& file);
+  /**
+   * @brief Write the calibration in use.  The file is replaced atomically, so a crash leaves the previous calibration.
+   *        Blocks on the disk
+   *
+   * @return false if the file could not be written
+   */
+  bool SaveCalibration(const std::filesystem::path& file) const;
+  /**
+   * @brief Save the calibration to file from a background thread whenever a new one is learned, at most once per
+   *        minInterval.  A change not yet saved is written on destruction.  Call at most once, e.g. after
+   *        LoadCalibration()
+   */
+  void SaveCalibrationOnChange(const std::filesystem::path& file, std::chrono::milliseconds minInterval);
+
+  /// @brief Latest low-pass filtered, decimated sample.  Raw values above are this sample rounded
+  [[nodiscard]] std::optional<FilteredSample> GetFilteredArrayStatus() const;
+  /**
+   * @brief Copy recent filtered samples, newest first.  Empty if data has timed out
+   *
+   * @param destination Filled with up to destination.size() (at most Filter::historySize) samples
+   * @return Number of samples copied
+   */
+  std::size_t GetFilteredHistory(std::span<FilteredSample> destination) const;
+  std::size_t GetFilteredHistory(const Snapshot& snapshot, TimePoint now, std::span<FilteredSample> destination) const;
+  /**
+   * @brief Copy recent filtered samples normalized to line coverage, newest first.  Empty if data has timed out
+   *
+   * @param destination Filled with up to destination.size() (at most Filter::historySize) samples
+   * @return Number of samples copied
+   */
+  std::size_t GetProportionalHistory(std::span<FilteredSample> destination) const;
+  std::size_t GetProportionalHistory(const Snapshot& snapshot,
+                                     TimePoint now,
+                                     std::span<FilteredSample> destination) const;
+
+  [[nodiscard]] RecoveryDirection GetRecoveryDirection() const;
+  [[nodiscard]] RecoveryDirection GetRecoveryDirection(const Snapshot& snapshot, TimePoint now) const;
+
+  [[nodiscard]] bool GetRecoveryActive() const;
+  [[nodiscard]] bool GetRecoveryActive(const Snapshot& snapshot, TimePoint now) const;
+
+  /// @brief Records received since construction that could not be parsed or were too long to buffer
+  [[nodiscard]] uint32_t GetFramingErrorCount() const;
+  /// @brief Binary frames received since construction with a bad checksum
+  [[nodiscard]] uint32_t GetCorruptFrameCount() const;
+  /// @brief Binary frames skipped in the sequence since construction, including those that were corrupt
+  [[nodiscard]] uint32_t GetDroppedFrameCount() const;
+  /// @brief Protocol negotiated with the sensor.  See LineSensorProtocol.h
+  [[nodiscard]] uint8_t GetProtocolVersion() const;
 
  private:
   std::string m_serialDeviceName;
   int m_serialPort;
-  /// @todo calibration procedure...
-  uint16_t m_calibrationActivateThreshold{940};
-  uint16_t m_calibrationDeactivateThreshold{1000};
-  std::optional<uint16_t> m_currentLeft{std::nullopt};
-  std::optional<uint16_t> m_currentCenter{std::nullopt};
-  std::optional<uint16_t> m_currentRight{std::nullopt};
-  std::chrono::time_point<std::chrono::steady_clock> m_lastUpdateTime;
+  /// Starting calibration for every channel until learned or loaded
+  constexpr static double defaultLineLevel = 940;
+  constexpr static double defaultFloorLevel = 1000;
+  constexpr static double detectionLevel = 1.0;  ///< Normalized value where a channel is fully over the line
+  /// Normalized value where a channel starts to see the line
+  constexpr static double visibleLevel = std::numeric_limits<double>::epsilon();
   std::chrono::milliseconds m_timeout{std::chrono::milliseconds{100}};
   std::chrono::milliseconds m_recoveryTime{std::chrono::milliseconds{1000}};
-  std::chrono::time_point<std::chrono::steady_clock> m_recoveryStartTime;
-  RecoveryDirection m_activeRecoveryDirection{RecoveryDirection::Timeout};
+  Snapshot m_working;  ///< Receive thread's copy of the next snapshot
+  Seqlock<Snapshot> m_snapshot{m_working};
+  int m_shutdownEvent;  ///< eventfd signaled to stop the receive thread
   std::thread m_receiveThread;
   std::atomic<bool> m_runThread{false};
+  std::atomic<uint32_t> m_framingErrors{0};
+  std::atomic<uint32_t> m_corruptFrames{0};
+  std::atomic<uint32_t> m_droppedFrames{0};
+  std::atomic<uint8_t> m_protocolVersion{0};
+  uint32_t m_parseErrors{0};
   bool m_connected{false};
-  mutable std::mutex m_dataMutex;
+  std::optional<uint8_t> m_lastSequence{std::nullopt};  ///< Most recent binary frame sequence number
+  std::optional<uint32_t> m_lastFirmwareTimestamp{std::nullopt};
+  std::chrono::microseconds m_sensorTime{0};  ///< Firmware timestamp extended past 32-bit rollover
+  Filter m_filter;
+  Array m_array{Array::UniformCalibration(defaultLineLevel, defaultFloorLevel)};
+  LineSensorCalibrator<N> m_calibrator{Array::UniformCalibration(defaultLineLevel, defaultFloorLevel)};
+  mutable std::mutex m_filterMutex;      ///< Protects m_filter history and m_array
+  mutable std::mutex m_calibratorMutex;  ///< Protects m_calibrator.  Taken before m_filterMutex when both are needed
 
+  std::mutex m_saveMutex;
+  std::condition_variable m_saveWake;
+  bool m_calibrationChanged{false};  ///< Guarded by m_saveMutex.  Learned since the last save
+  bool m_stopSaving{false};          ///< Guarded by m_saveMutex
+  std::thread m_saveThread;          ///< Runs SaveThread() once SaveCalibrationOnChange() is called
+
+  /// @brief No sample yet, or the latest is older than the timeout at now
+  [[nodiscard]] bool TimedOut(const Snapshot& snapshot, TimePoint now) const;
   void ReceiverThread();
-  [[nodiscard]] static std::optional<RawSensorArrayStatus> ParseMessage(std::string_view message);
+  void SaveThread(std::filesystem::path file, std::chrono::milliseconds minInterval);
+  /// @brief Handle every complete record and publish a snapshot if filter output changed
+  bool ProcessRecords(LineReassembler& reassembler);
+  /// @brief Filter one sample and refine calibration.  Caller must hold neither mutex
+  bool AddSample(const std::chrono::microseconds timestamp, std::span<const uint16_t, N> rawValues);
+  [[nodiscard]] static std::optional<RawChannels> ParseMessage(std::string_view message);
   [[nodiscard]] static std::optional<std::filesystem::path> DiscoverSerialDevice();
 };
+
+extern template class BasicSerialLineSensor<3>;
+extern template class BasicSerialLineSensor<8>;
+extern template class BasicSerialLineSensor<16>;
+
+/// Sensor bar fitted to the platform
+using SerialLineSensor = BasicSerialLineSensor<3>;
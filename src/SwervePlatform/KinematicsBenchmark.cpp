@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @file Times swerve forward kinematics both ways: solving through a HouseholderQR of the inverse kinematics on every
+///       call, as wpimath used to, and multiplying by the pseudo-inverse frc::SwerveDriveKinematics now precomputes.
+///       Runs a four module layout like the platform's and a six module layout, and checks both methods agree.
+///
+///       Usage: KinematicsBenchmark [iterations]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/QR>
+#include <frc/kinematics/SwerveDriveKinematics.h>
+#include <wpi/array.h>
+
+namespace {
+  constexpr std::size_t defaultIterations = 1000000;
+  /// Distinct module state sets cycled through, so no result can be hoisted out of the loop
+  constexpr std::size_t sampleCount = 1024;
+
+  /// Defeats dead code elimination of the benchmarked results
+  volatile double sink;
+
+  struct Result {
+    double qrNs;          ///< Per call
+    double multiplyNs;    ///< Per call
+    double residualNs;    ///< Per call, multiply plus residual
+    double maxDeviation;  ///< Largest difference between the two methods' chassis speeds
+  };
+
+  template <std::size_t NumModules>
+  wpi::array<frc::Translation2d, NumModules> ModuleLocations() {
+    wpi::array<frc::Translation2d, NumModules> locations{wpi::empty_array};
+    // Evenly spaced on an ellipse, roughly the platform's footprint
+    for (std::size_t i = 0; i < NumModules; ++i) {
+      const double angle = M_PI / NumModules + 2 * M_PI * i / NumModules;
+      locations[i] = frc::Translation2d{units::meter_t{0.35 * std::cos(angle)}, units::meter_t{0.3 * std::sin(angle)}};
+    }
+    return locations;
+  }
+
+  template <std::size_t NumModules>
+  using ModuleVector = Eigen::Matrix<double, NumModules * 2, 1>;
+
+  template <typename Function>
+  double NanosecondsPerCall(const std::size_t iterations, Function&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+      function(i % sampleCount);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+  }
+
+  template <std::size_t NumModules>
+  Result Run(const std::size_t iterations) {
+    const auto locations = ModuleLocations<NumModules>();
+    const frc::SwerveDriveKinematics<NumModules> kinematics{locations};
+
+    // Same matrix frc::SwerveDriveKinematics builds for the physical center
+    Eigen::Matrix<double, NumModules * 2, 3> inverseKinematics;
+    for (std::size_t i = 0; i < NumModules; ++i) {
+      inverseKinematics.row(i * 2) << 1, 0, -locations[i].Y().template to<double>();
+      inverseKinematics.row(i * 2 + 1) << 0, 1, locations[i].X().template to<double>();
+    }
+    const auto qr = inverseKinematics.householderQr();
+
+    // Module velocities from random chassis speeds, with noise standing in for slip
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<double> speed{-2.0, 2.0};
+    std::normal_distribution<double> slip{0.0, 0.02};
+    std::vector<wpi::array<frc::SwerveModuleState, NumModules>> states(
+        sampleCount, wpi::array<frc::SwerveModuleState, NumModules>{wpi::empty_array});
+    std::vector<ModuleVector<NumModules>> velocities(sampleCount);
+    for (std::size_t sample = 0; sample < sampleCount; ++sample) {
+      const Eigen::Vector3d chassis{speed(generator), speed(generator), speed(generator)};
+      ModuleVector<NumModules> velocity = inverseKinematics * chassis;
+      for (Eigen::Index element = 0; element < velocity.size(); ++element) {
+        velocity(element) += slip(generator);
+      }
+      for (std::size_t i = 0; i < NumModules; ++i) {
+        const double x = velocity(i * 2);
+        const double y = velocity(i * 2 + 1);
+        states[sample][i] = frc::SwerveModuleState{units::meters_per_second_t{std::hypot(x, y)}, frc::Rotation2d{x, y}};
+      }
+      velocities[sample] = velocity;
+    }
+
+    Result result{};
+    // Both methods take the same module states, so both pay for the conversion to velocity vectors
+    result.qrNs = NanosecondsPerCall(iterations, [&](const std::size_t sample) {
+      ModuleVector<NumModules> velocity;
+      for (std::size_t i = 0; i < NumModules; ++i) {
+        const auto& state = states[sample][i];
+        velocity(i * 2) = state.speed.template to<double>() * state.angle.Cos();
+        velocity(i * 2 + 1) = state.speed.template to<double>() * state.angle.Sin();
+      }
+      const Eigen::Vector3d chassis = qr.solve(velocity);
+      sink = chassis(2);
+    });
+    result.multiplyNs = NanosecondsPerCall(iterations, [&](const std::size_t sample) {
+      sink = kinematics.ToChassisSpeeds(states[sample]).omega.template to<double>();
+    });
+    result.residualNs = NanosecondsPerCall(iterations, [&](const std::size_t sample) {
+      units::meters_per_second_t residual;
+      sink = kinematics.ToChassisSpeedsWithResidual(states[sample], &residual).omega.template to<double>() +
+             residual.template to<double>();
+    });
+
+    for (std::size_t sample = 0; sample < sampleCount; ++sample) {
+      const Eigen::Vector3d expected = qr.solve(velocities[sample]);
+      const auto actual = kinematics.ToChassisSpeeds(states[sample]);
+      result.maxDeviation = std::max({result.maxDeviation,
+                                      std::abs(expected(0) - actual.vx.template to<double>()),
+                                      std::abs(expected(1) - actual.vy.template to<double>()),
+                                      std::abs(expected(2) - actual.omega.template to<double>())});
+    }
+    return result;
+  }
+
+  void Print(const std::size_t modules, const Result& result) {
+    std::printf("%7zu %12.1f %12.1f %12.1f %8.1fx %12.2e\n",
+                modules,
+                result.qrNs,
+                result.multiplyNs,
+                result.residualNs,
+                result.qrNs / result.multiplyNs,
+                result.maxDeviation);
+  }
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::size_t iterations = defaultIterations;
+  if (argc > 1) {
+    iterations = std::strtoull(argv[1], nullptr, 10);
+  }
+  if (argc > 2 || iterations == 0) {
+    std::fprintf(stderr, "Usage: KinematicsBenchmark [iterations]\n");
+    return 2;
+  }
+
+  std::printf("Forward kinematics, %zu calls each (ns per call)\n", iterations);
+  std::printf("%7s %12s %12s %12s %9s %12s\n", "modules", "QR solve", "multiply", "+residual", "speedup", "max diff");
+  Print(4, Run<4>(iterations));
+  Print(6, Run<6>(iterations));
+  return 0;
+}
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PoseEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  double Seconds(const std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double>(duration).count();
+  }
+}  // namespace
+
+PoseEstimator::PoseEstimator() : PoseEstimator(Settings{}) {}
+
+PoseEstimator::PoseEstimator(const Settings& settings) : m_settings{settings}, m_history{} {}
+
+void PoseEstimator::Reset() {
+  m_newest = 0;
+  m_count = 0;
+  m_yawOffset = std::nullopt;
+  m_lastMeasurement = std::nullopt;
+}
+
+void PoseEstimator::Predict(const std::chrono::nanoseconds timestamp, const Twist& twist) {
+  if (m_count == 0) {
+    // The starting pose defines the field frame, so it is known exactly
+    m_newest = 0;
+    m_history[m_newest] = Snapshot{.timestamp = timestamp, .twist = twist, .x = Vector::Zero(), .P = Matrix::Zero()};
+    m_count = 1;
+    return;
+  }
+  const auto& newest = History(0);
+  if (timestamp <= newest.timestamp) {
+    return;
+  }
+  Vector x = newest.x;
+  Matrix P = newest.P;
+  TimeUpdate(x, P, Seconds(timestamp - newest.timestamp), twist);
+  m_newest = (m_newest + 1) % historySize;
+  m_history[m_newest] = Snapshot{.timestamp = timestamp, .twist = twist, .x = x, .P = P};
+  m_count = std::min(m_count + 1, historySize);
+}
+
+bool PoseEstimator::FuseYaw(const std::chrono::nanoseconds timestamp, const double yaw) {
+  if (m_count == 0 || (m_lastMeasurement && timestamp <= m_lastMeasurement.value())) {
+    return false;
+  }
+  // Newest snapshot at or before the measurement
+  std::size_t age = 0;
+  while (age < m_count && History(age).timestamp > timestamp) {
+    ++age;
+  }
+  // Only snapshots are kept, so state between a snapshot and a reading fused after it is lost.  At most one reading
+  // per update interval can be fused
+  if (age == m_count || (m_lastMeasurement && History(age).timestamp < m_lastMeasurement.value())) {
+    return false;
+  }
+
+  auto& base = History(age);
+  Vector x = base.x;
+  Matrix P = base.P;
+  auto measurementTime = base.timestamp;
+  if (age > 0) {
+    // The next snapshot holds the twist over this interval.  Readings newer than every snapshot apply to the newest
+    measurementTime = timestamp;
+    TimeUpdate(x, P, Seconds(timestamp - base.timestamp), History(age - 1).twist);
+  }
+  m_lastMeasurement = measurementTime;
+
+  if (!m_yawOffset) {
+    m_yawOffset = x(2) - yaw;
+    return true;
+  }
+
+  // Scalar measurement of the heading (H = [0 0 1]), so no matrix inverse is needed
+  const double innovation = std::remainder(yaw + m_yawOffset.value() - x(2), 2 * M_PI);
+  const double innovationVariance = P(2, 2) + m_settings.yawStdDev * m_settings.yawStdDev;
+  const Vector gain = P.col(2) / innovationVariance;
+  x += gain * innovation;
+  P -= gain * P.row(2);
+  P = 0.5 * (P + P.transpose()).eval();
+
+  if (age == 0) {
+    base.x = x;
+    base.P = P;
+    return true;
+  }
+  // Replay the twists since the measurement
+  auto time = measurementTime;
+  for (std::size_t replayAge = age; replayAge-- > 0;) {
+    auto& snapshot = History(replayAge);
+    TimeUpdate(x, P, Seconds(snapshot.timestamp - time), snapshot.twist);
+    snapshot.x = x;
+    snapshot.P = P;
+    time = snapshot.timestamp;
+  }
+  return true;
+}
+
+std::optional<PoseEstimator::Estimate> PoseEstimator::Latest() const {
+  if (m_count == 0) {
+    return std::nullopt;
+  }
+  const auto& newest = m_history[m_newest];
+  return Estimate{.timestamp = newest.timestamp,
+                  .pose = Pose{.x = newest.x(0), .y = newest.x(1), .heading = newest.x(2)},
+                  .stdDev = Pose{.x = std::sqrt(newest.P(0, 0)),
+                                 .y = std::sqrt(newest.P(1, 1)),
+                                 .heading = std::sqrt(newest.P(2, 2))}};
+}
+
+void PoseEstimator::TimeUpdate(Vector& x, Matrix& P, const double dt, const Twist& twist) const {
+  if (dt <= 0) {
+    return;
+  }
+  // Rotate the twist at the mid-interval heading, which is exact to second order for constant yaw rate
+  const double heading = x(2) + 0.5 * twist.omega * dt;
+  const double cosHeading = std::cos(heading);
+  const double sinHeading = std::sin(heading);
+  const double dx = (twist.vx * cosHeading - twist.vy * sinHeading) * dt;
+  const double dy = (twist.vx * sinHeading + twist.vy * cosHeading) * dt;
+
+  Matrix transition = Matrix::Identity();
+  transition(0, 2) = -dy;
+  transition(1, 2) = dx;
+  x += Vector{dx, dy, twist.omega * dt};
+
+  // Random walk while stopped, plus an error proportional to the distance moved.  Translation noise is the same in
+  // every direction, so it needs no rotation into the field frame
+  const double distance = std::hypot(dx, dy);
+  const double turned = twist.omega * dt;
+  const double translationVariance = m_settings.translationStdDev * m_settings.translationStdDev * dt +
+                                     std::pow(m_settings.slipFraction * distance, 2);
+  const double rotationVariance =
+      m_settings.rotationStdDev * m_settings.rotationStdDev * dt + std::pow(m_settings.slipFraction * turned, 2);
+  P = transition * P * transition.transpose();
+  P += Vector{translationVariance, translationVariance, rotationVariance}.asDiagonal();
+}
+
+PoseEstimator::Snapshot& PoseEstimator::History(const std::size_t age) {
+  return m_history[(m_newest + historySize - age) % historySize];
+}
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+#include <Eigen/Core>
+
+/**
+ * @brief Extended Kalman filter tracking the platform pose from wheel odometry and gyro yaw.
+ *
+ * State is field position x, y (m) and heading theta (rad), with X forward and Y left of the pose at the first
+ * Predict() and counter-clockwise positive.  Heading is continuous, not wrapped.  Odometry twists drive the time
+ * update; gyro yaw is the only measurement.  Yaw arrives late, so the filter keeps a short history of its state:
+ * a measurement is fused at its own time and the twists since then are replayed.  All storage is fixed size.
+ */
+class PoseEstimator {
+ public:
+  struct Settings {
+    double translationStdDev{0.02};  ///< Position random walk (m/sqrt(s)) with the wheels stopped
+    double rotationStdDev{0.01};     ///< Heading random walk (rad/sqrt(s)) with the platform not turning
+    double slipFraction{0.05};       ///< Twist error as a fraction of twist, e.g. wheel slip or wear
+    double yawStdDev{0.002};         ///< Gyro yaw noise (rad)
+  };
+
+  /// @brief Platform velocity in its own frame
+  struct Twist {
+    double vx{0};     ///< Forward (m/s)
+    double vy{0};     ///< Left (m/s)
+    double omega{0};  ///< Yaw rate (rad/s), counter-clockwise positive
+  };
+
+  struct Pose {
+    double x;        ///< m
+    double y;        ///< m
+    double heading;  ///< rad
+  };
+
+  struct Estimate {
+    std::chrono::nanoseconds timestamp;
+    Pose pose;
+    Pose stdDev;
+  };
+
+  /// Time updates kept for replay.  Measurements older than this many updates are dropped
+  constexpr static std::size_t historySize = 32;
+
+  PoseEstimator();
+  explicit PoseEstimator(const Settings& settings);
+
+  /**
+   * @brief Forget the pose and gyro alignment.  The next Predict() starts again at the origin
+   */
+  void Reset();
+
+  /**
+   * @brief Advance to a new time
+   *
+   * @param timestamp Time of the update.  Times not newer than the last update are ignored
+   * @param twist Platform velocity, assumed constant since the last update
+   */
+  void Predict(std::chrono::nanoseconds timestamp, const Twist& twist);
+
+  /**
+   * @brief Fuse a gyro yaw reading at the time it was measured.  The first reading after Reset() only aligns the gyro
+   *        with the estimated heading
+   *
+   * @param timestamp When the gyro measured yaw.  May be earlier than the last Predict()
+   * @param yaw Gyro yaw (rad), counter-clockwise positive.  Continuous
+   * @return false if the reading is older than the history or than a reading already fused
+   */
+  bool FuseYaw(std::chrono::nanoseconds timestamp, double yaw);
+
+  /// @brief Estimate as of the last Predict(), or std::nullopt before the first one
+  [[nodiscard]] std::optional<Estimate> Latest() const;
+
+ private:
+  using Vector = Eigen::Vector3d;
+  using Matrix = Eigen::Matrix3d;
+
+  struct Snapshot {
+    std::chrono::nanoseconds timestamp;
+    Twist twist;  ///< Applied from the previous snapshot to this one
+    Vector x;
+    Matrix P;
+  };
+
+  /// @brief Propagate mean and covariance by dt seconds
+  void TimeUpdate(Vector& x, Matrix& P, double dt, const Twist& twist) const;
+  [[nodiscard]] Snapshot& History(std::size_t age);
+
+  Settings m_settings;
+  std::array<Snapshot, historySize> m_history;  ///< Ring ending at m_newest
+  std::size_t m_newest{0};
+  std::size_t m_count{0};
+  std::optional<double> m_yawOffset{std::nullopt};  ///< Heading minus gyro yaw
+  std::optional<std::chrono::nanoseconds> m_lastMeasurement{std::nullopt};
+};
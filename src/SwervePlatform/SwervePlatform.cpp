@@ -5,31 +5,56 @@
 
 #include "SwervePlatform.h"
 #include <iostream>
-#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
+#include "argosLib/general/asyncLog.h"
 #include "argosLib/general/swerveUtils.h"
 
+namespace {
+  namespace lineFollow {
+    /// Fraction of max velocity.  Raise only once measureUp::lineSensor geometry is measured on the platform
+    constexpr double speed = 0.5;
+    constexpr double maxTurn = 0.5;           ///< Fraction of max angular rate
+    constexpr units::meter_t lookahead{0.3};  ///< Distance over which lateral offset is corrected
+    /// Time from computing a command until modules respond: one control period plus CAN and motor response
+    constexpr std::chrono::milliseconds actuationLatency{30};
+  }  // namespace lineFollow
+  namespace poseEstimation {
+    /// Age of IMU readings when read: half the 10ms status frame period plus CAN transport
+    constexpr std::chrono::milliseconds imuLatency{7};
+  }  // namespace poseEstimation
+}  // namespace
+
 void SwervePlatform::SwerveDrive(const double fwVelocity,
                                  const double latVelocity,
                                  const double rotateVelocity,
                                  const bool lineFollow,
                                  frc::Translation2d offset) {
+  if (!lineFollow) {
+    m_lastCommand.linePrediction.reset();
+  }
+
   // Halt motion
   if (fwVelocity == 0 && latVelocity == 0 && rotateVelocity == 0) {
-    m_motorDriveFrontLeft.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorTurnFrontLeft.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorDriveFrontRight.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorTurnFrontRight.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorDriveRearRight.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorTurnRearRight.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorDriveRearLeft.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
-    m_motorTurnRearLeft.Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    BeginCommandTelemetry(ModuleCommand::stopped);
+    m_motorDriveFrontLeft->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorTurnFrontLeft->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorDriveFrontRight->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorTurnFrontRight->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorDriveRearRight->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorTurnRearRight->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorDriveRearLeft->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
+    m_motorTurnRearLeft->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0.0);
     return;
   }
 
   if (!lineFollow) {
     m_followDirection = LineFollowDirection::unknown;
     m_followState = LineFollowState::normal;
+    m_lineStateEstimator.Reset();
+    m_lineFollowMotion = LineStateEstimator::Motion{};
   }
 
   auto moduleStates = RawModuleStates(fwVelocity, latVelocity, rotateVelocity, offset);
@@ -38,90 +63,105 @@ void SwervePlatform::SwerveDrive(const double fwVelocity,
   std::for_each(
       moduleStates.begin(), moduleStates.end(), [](frc::SwerveModuleState& state) { state.angle = -state.angle; });
 
+  // Reads turn positions once for both Optimize and the log
+  BeginCommandTelemetry(ModuleCommand::driving);
+  std::copy(moduleStates.begin(), moduleStates.end(), m_lastCommand.desired.begin());
+  const auto& turnPosition = m_lastCommand.turnPosition;
+
   moduleStates.at(ModuleIndex::frontLeft) = Optimize(
       moduleStates.at(ModuleIndex::frontLeft),
-      measureUp::sensorConversion::swerveRotate::toAngle(m_motorTurnFrontLeft.GetSelectedSensorPosition()),
-      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnFrontLeft.GetSelectedSensorVelocity()),
-      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveFrontLeft.GetSelectedSensorVelocity()),
+      turnPosition.at(ModuleIndex::frontLeft),
+      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnFrontLeft->GetSelectedSensorVelocity()),
+      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveFrontLeft->GetSelectedSensorVelocity()),
       m_maxVelocity);
   moduleStates.at(ModuleIndex::frontRight) = Optimize(
       moduleStates.at(ModuleIndex::frontRight),
-      measureUp::sensorConversion::swerveRotate::toAngle(m_motorTurnFrontRight.GetSelectedSensorPosition()),
-      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnFrontRight.GetSelectedSensorVelocity()),
-      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveFrontRight.GetSelectedSensorVelocity()),
+      turnPosition.at(ModuleIndex::frontRight),
+      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnFrontRight->GetSelectedSensorVelocity()),
+      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveFrontRight->GetSelectedSensorVelocity()),
       m_maxVelocity);
   moduleStates.at(ModuleIndex::rearRight) = Optimize(
       moduleStates.at(ModuleIndex::rearRight),
-      measureUp::sensorConversion::swerveRotate::toAngle(m_motorTurnRearRight.GetSelectedSensorPosition()),
-      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnRearRight.GetSelectedSensorVelocity()),
-      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveRearRight.GetSelectedSensorVelocity()),
+      turnPosition.at(ModuleIndex::rearRight),
+      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnRearRight->GetSelectedSensorVelocity()),
+      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveRearRight->GetSelectedSensorVelocity()),
       m_maxVelocity);
   moduleStates.at(ModuleIndex::rearLeft) = Optimize(
       moduleStates.at(ModuleIndex::rearLeft),
-      measureUp::sensorConversion::swerveRotate::toAngle(m_motorTurnRearLeft.GetSelectedSensorPosition()),
-      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnRearLeft.GetSelectedSensorVelocity()),
-      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveRearLeft.GetSelectedSensorVelocity()),
+      turnPosition.at(ModuleIndex::rearLeft),
+      0_rpm,  //  measureUp::sensorConversion::swerveRotate::toAngVel(m_motorTurnRearLeft->GetSelectedSensorVelocity()),
+      0_fps,  //  measureUp::sensorConversion::swerveDrive::toVel(m_motorDriveRearLeft->GetSelectedSensorVelocity()),
       m_maxVelocity);
 
-  ctre::phoenix::motorcontrol::Faults turnFrontLeftFaults, turnFrontRightFaults, turnRearRightFaults,
-      turnRearLeftFaults;
-  m_motorTurnFrontLeft.GetFaults(turnFrontLeftFaults);
-  m_motorTurnFrontRight.GetFaults(turnFrontRightFaults);
-  m_motorTurnRearRight.GetFaults(turnRearRightFaults);
-  m_motorTurnRearLeft.GetFaults(turnRearLeftFaults);
+  std::copy(moduleStates.begin(), moduleStates.end(), m_lastCommand.optimized.begin());
 
-  m_motorDriveFrontLeft.Set(
+  m_motorDriveFrontLeft->Set(
       ctre::phoenix::motorcontrol::ControlMode::Velocity,
       measureUp::sensorConversion::swerveDrive::fromVel(moduleStates.at(ModuleIndex::frontLeft).speed));
-  m_motorTurnFrontLeft.Set(
-      ctre::phoenix::motorcontrol::TalonFXControlMode::Position,
+  m_motorTurnFrontLeft->Set(
+      ctre::phoenix::motorcontrol::ControlMode::Position,
       measureUp::sensorConversion::swerveRotate::fromAngle(moduleStates.at(ModuleIndex::frontLeft).angle.Degrees()));
-  m_motorDriveFrontRight.Set(
+  m_motorDriveFrontRight->Set(
       ctre::phoenix::motorcontrol::ControlMode::Velocity,
       measureUp::sensorConversion::swerveDrive::fromVel(moduleStates.at(ModuleIndex::frontRight).speed));
-  m_motorTurnFrontRight.Set(
-      ctre::phoenix::motorcontrol::TalonFXControlMode::Position,
+  m_motorTurnFrontRight->Set(
+      ctre::phoenix::motorcontrol::ControlMode::Position,
       measureUp::sensorConversion::swerveRotate::fromAngle(moduleStates.at(ModuleIndex::frontRight).angle.Degrees()));
-  m_motorDriveRearRight.Set(
+  m_motorDriveRearRight->Set(
       ctre::phoenix::motorcontrol::ControlMode::Velocity,
       measureUp::sensorConversion::swerveDrive::fromVel(moduleStates.at(ModuleIndex::rearRight).speed));
-  m_motorTurnRearRight.Set(
-      ctre::phoenix::motorcontrol::TalonFXControlMode::Position,
+  m_motorTurnRearRight->Set(
+      ctre::phoenix::motorcontrol::ControlMode::Position,
       measureUp::sensorConversion::swerveRotate::fromAngle(moduleStates.at(ModuleIndex::rearRight).angle.Degrees()));
-  m_motorDriveRearLeft.Set(
+  m_motorDriveRearLeft->Set(
       ctre::phoenix::motorcontrol::ControlMode::Velocity,
       measureUp::sensorConversion::swerveDrive::fromVel(moduleStates.at(ModuleIndex::rearLeft).speed));
-  m_motorTurnRearLeft.Set(
-      ctre::phoenix::motorcontrol::TalonFXControlMode::Position,
+  m_motorTurnRearLeft->Set(
+      ctre::phoenix::motorcontrol::ControlMode::Position,
       measureUp::sensorConversion::swerveRotate::fromAngle(moduleStates.at(ModuleIndex::rearLeft).angle.Degrees()));
 }
 
-void SwervePlatform::LineFollow(bool forward,
+void SwervePlatform::LineFollow(const hardware::TickContext& tick,
+                                bool forward,
                                 bool reverse,
-                                std::optional<ProportionalArrayStatus> arrayStatus,
-                                SerialLineSensor& lineSensor) {
+                                const SerialLineSensor& lineSensor) {
+  m_lastCommand.linePrediction.reset();
+
+  // Interpret a single sample at the tick time so array status, recovery state and history agree
+  const auto sensorSnapshot = lineSensor.GetSnapshot();
+  const auto arrayStatus = lineSensor.GetProportionalArrayStatus(sensorSnapshot, tick.steadyTime);
+  const auto recoveryDirection = lineSensor.GetRecoveryDirection(sensorSnapshot, tick.steadyTime);
+
+  using SensorArray = SerialLineSensor::Array;
+
   if (!arrayStatus || (!forward && !reverse) ||
-      (!lineSensor.GetRecoveryActive() && (arrayStatus.value().left < std::numeric_limits<double>::epsilon() &&
-                                           arrayStatus.value().center < std::numeric_limits<double>::epsilon() &&
-                                           arrayStatus.value().right < std::numeric_limits<double>::epsilon()))) {
+      (!lineSensor.GetRecoveryActive(sensorSnapshot, tick.steadyTime) &&
+       SensorArray::Threshold(arrayStatus.value(), std::numeric_limits<double>::epsilon()) == 0)) {
+    m_lineStateEstimator.Reset();
+    m_lineFollowMotion = LineStateEstimator::Motion{};
     Stop();
     return;
   }
 
   auto desiredFollowDirection = forward ? LineFollowDirection::forward : LineFollowDirection::reverse;
 
-  const double forwardSpeed = desiredFollowDirection == LineFollowDirection::forward ? 0.5 : -0.5;
+  const double forwardSpeed =
+      desiredFollowDirection == LineFollowDirection::forward ? lineFollow::speed : -lineFollow::speed;
 
-  if (arrayStatus.value().left > 0.5 && arrayStatus.value().center > 0.5 && arrayStatus.value().right > 0.5) {
+  // Line across the whole array marks the end
+  if (SensorArray::Threshold(arrayStatus.value(), 0.5) == SensorArray::allChannels) {
     if (desiredFollowDirection == m_followDirection) {
       // Reached end of line, don't cross
       Stop(true);
+      m_lineFollowMotion = LineStateEstimator::Motion{};
       m_followState = LineFollowState::endStop;
-      std::cout << "Stop!\n";
+      ARGOS_LOG_EVERY(std::chrono::seconds{1}, ArgosLib::LogLevel::kInfo, "Stop!");
       return;
     } else {
       // Leaving end line.  Don't change stored direction because then the platform will stop next loop
       m_followState = LineFollowState::endStop;
+      m_lineFollowMotion =
+          LineStateEstimator::Motion{.speed = units::meters_per_second_t{m_maxVelocity * forwardSpeed}.to<double>()};
       SwerveDrive(forwardSpeed, 0, 0, true);
       return;
     }
@@ -131,7 +171,8 @@ void SwervePlatform::LineFollow(bool forward,
   } else if (desiredFollowDirection == m_followDirection) {
     m_followState = LineFollowState::pastEnd;
     Stop(true);
-    std::cout << "Stop (past end)!\n";
+    m_lineFollowMotion = LineStateEstimator::Motion{};
+    ARGOS_LOG_EVERY(std::chrono::seconds{1}, ArgosLib::LogLevel::kInfo, "Stop (past end)!");
     return;
   } else if (m_followState != LineFollowState::pastEnd) {
     m_followState = LineFollowState::normal;
@@ -141,113 +182,208 @@ void SwervePlatform::LineFollow(bool forward,
   if (desiredFollowDirection == LineFollowDirection::reverse) {
     offset *= -1.0;
   }
+  const double speed = units::meters_per_second_t{m_maxVelocity * forwardSpeed}.to<double>();
+  // Rotating about offset moves the sensor array sideways by yawRate * leverArm
+  const double leverArm = (measureUp::lineSensor::longitudinalPosition - offset.X()).to<double>();
+
+  // Feed every sample since the last loop, oldest first, assuming the previous command was in effect throughout
+  std::array<SerialLineSensor::FilteredSample, SerialLineSensor::Filter::historySize> history;
+  const auto historyCount = lineSensor.GetProportionalHistory(sensorSnapshot, tick.steadyTime, history);
+  for (auto sample = history.rend() - historyCount; sample != history.rend(); ++sample) {
+    m_lineStateEstimator.Update(sample->timestamp,
+                                WeightedCentroid(sample->channels, measureUp::lineSensor::channelPositions),
+                                m_lineFollowMotion);
+  }
+
+  // Steer for where the line will be when this command reaches the modules.  Sensor time is mapped to host time
+  // through the newest sample, so transport latency is included
+  const auto actuationTime =
+      sensorSnapshot.filtered.timestamp +
+      std::chrono::duration_cast<std::chrono::microseconds>(tick.steadyTime + lineFollow::actuationLatency -
+                                                            sensorSnapshot.updateTime);
+  const auto predicted = m_lineStateEstimator.Predict(actuationTime, m_lineFollowMotion);
+  m_lastCommand.linePrediction = predicted;
 
   double leftTurnSpeed = 0;
+  if (predicted) {
+    // Offset decays over the lookahead distance; heading then settles at leverArm * curvature, which tracks curves
+    // without a separate feedforward term
+    const units::radians_per_second_t yawRate{
+        (speed * predicted.value().headingError +
+         std::abs(speed) * predicted.value().lateralOffset / lineFollow::lookahead.to<double>()) /
+        leverArm};
+    leftTurnSpeed = std::clamp((yawRate / m_maxAngularRate).to<double>(), -lineFollow::maxTurn, lineFollow::maxTurn);
 
-  if (arrayStatus.value().left > std::numeric_limits<double>::epsilon()) {
-    leftTurnSpeed = arrayStatus.value().left;
-    if (arrayStatus.value().center <= std::numeric_limits<double>::epsilon() && arrayStatus.value().left < 0.75) {
-      leftTurnSpeed = (2.0 - arrayStatus.value().left);
+    ARGOS_LOG_EVERY(std::chrono::milliseconds{100},
+                    ArgosLib::LogLevel::kInfo,
+                    "y:{:.3} h:{:.3} k:{:.3} t:{:.3}",
+                    predicted.value().lateralOffset,
+                    predicted.value().headingError,
+                    predicted.value().curvature,
+                    leftTurnSpeed);
+  } else {
+    // Line not seen since line following started
+    if (recoveryDirection == SerialLineSensor::RecoveryDirection::Left) {
+      leftTurnSpeed = -0.15;
+    } else if (recoveryDirection == SerialLineSensor::RecoveryDirection::Right) {
+      leftTurnSpeed = 0.15;
     }
-    leftTurnSpeed *= -0.075;
-  } else if (arrayStatus.value().right > std::numeric_limits<double>::epsilon()) {
-    leftTurnSpeed = arrayStatus.value().right;
-    if (arrayStatus.value().center <= std::numeric_limits<double>::epsilon() && arrayStatus.value().right < 0.75) {
-      leftTurnSpeed = (2.0 - arrayStatus.value().right);
+    if (desiredFollowDirection == LineFollowDirection::reverse) {
+      leftTurnSpeed *= -1.0;
     }
-    leftTurnSpeed *= 0.075;
-  } else if (lineSensor.GetRecoveryDirection() == SerialLineSensor::RecoveryDirection::Left) {
-    leftTurnSpeed = -0.15;
-  } else if (lineSensor.GetRecoveryDirection() == SerialLineSensor::RecoveryDirection::Right) {
-    leftTurnSpeed = 0.15;
   }
 
-  if (desiredFollowDirection == LineFollowDirection::reverse) {
-    leftTurnSpeed *= -1.0;
-  }
-
-  std::cout << std::setprecision(3) << "l:" << arrayStatus.value().left << " c:" << arrayStatus.value().center
-            << " r:" << arrayStatus.value().right << " t:" << leftTurnSpeed << '\n';
-
+  const double yawRate = units::radians_per_second_t{m_maxAngularRate * leftTurnSpeed}.to<double>();
+  m_lineFollowMotion =
+      LineStateEstimator::Motion{.speed = speed, .lateralSpeed = yawRate * leverArm, .yawRate = yawRate};
   SwerveDrive(forwardSpeed, 0, leftTurnSpeed, true, offset);
 }
 
 void SwervePlatform::Stop(bool active) {
-  for (const auto motor : {&m_motorDriveFrontLeft,
-                           &m_motorDriveFrontRight,
-                           &m_motorDriveRearRight,
-                           &m_motorDriveRearLeft,
-                           &m_motorTurnFrontLeft,
-                           &m_motorTurnFrontRight,
-                           &m_motorTurnRearRight,
-                           &m_motorTurnRearLeft}) {
+  BeginCommandTelemetry(active ? ModuleCommand::holding : ModuleCommand::stopped);
+  m_lastCommand.linePrediction.reset();
+  for (const auto motor : {m_motorDriveFrontLeft.get(),
+                           m_motorDriveFrontRight.get(),
+                           m_motorDriveRearRight.get(),
+                           m_motorDriveRearLeft.get(),
+                           m_motorTurnFrontLeft.get(),
+                           m_motorTurnFrontRight.get(),
+                           m_motorTurnRearRight.get(),
+                           m_motorTurnRearLeft.get()}) {
     if (active) {
-      motor->Set(ctre::phoenix::motorcontrol::TalonFXControlMode::Velocity, 0);
+      motor->Set(ctre::phoenix::motorcontrol::ControlMode::Velocity, 0);
     } else {
-      motor->Set(ctre::phoenix::motorcontrol::TalonFXControlMode::PercentOutput, 0);
+      motor->Set(ctre::phoenix::motorcontrol::ControlMode::PercentOutput, 0);
     }
   }
 }
 
+void SwervePlatform::UpdatePose(const hardware::TickContext& tick) {
+  const std::array driveMotors{m_motorDriveFrontLeft.get(),
+                               m_motorDriveFrontRight.get(),
+                               m_motorDriveRearRight.get(),
+                               m_motorDriveRearLeft.get()};
+  const std::array turnMotors{m_motorTurnFrontLeft.get(),
+                              m_motorTurnFrontRight.get(),
+                              m_motorTurnRearRight.get(),
+                              m_motorTurnRearLeft.get()};
+  // Module angles are commanded negated (see SwerveDrive()), so undo that to get back to the kinematics frame
+  wpi::array<frc::SwerveModuleState, 4> moduleStates{wpi::empty_array};
+  for (std::size_t module = 0; module < moduleStates.size(); ++module) {
+    moduleStates[module] = frc::SwerveModuleState{
+        measureUp::sensorConversion::swerveDrive::toVel(driveMotors[module]->GetSelectedSensorVelocity()),
+        frc::Rotation2d{-measureUp::sensorConversion::swerveRotate::toAngle(
+            turnMotors[module]->GetSelectedSensorPosition())}};
+  }
+  // Kinematics frame is Y right and clockwise positive
+  const auto chassisSpeeds =
+      m_pSwerveKinematicsModel->ToChassisSpeedsWithResidual(moduleStates, &m_lastPose.kinematicResidual);
+  m_lastPose.twist = PoseEstimator::Twist{.vx = chassisSpeeds.vx.to<double>(),
+                                          .vy = -chassisSpeeds.vy.to<double>(),
+                                          .omega = -chassisSpeeds.omega.to<double>()};
+  // The gyro measures yaw rate directly; wheels scrub and slip when turning
+  double gyroRates[3];
+  if (m_imu->GetRawGyro(gyroRates) == ctre::phoenix::ErrorCode::OK) {
+    m_lastPose.twist.omega = units::radians_per_second_t{units::degrees_per_second_t{gyroRates[2]}}.to<double>();
+  }
+
+  const std::chrono::nanoseconds now{tick.time.time_since_epoch()};
+  m_poseEstimator.Predict(now, m_lastPose.twist);
+  m_lastPose.imuYaw = m_imu->GetYaw();
+  if (m_imu->GetLastError() == ctre::phoenix::ErrorCode::OK) {
+    m_poseEstimator.FuseYaw(now - poseEstimation::imuLatency,
+                            units::radian_t{units::degree_t{m_lastPose.imuYaw}}.to<double>());
+  }
+  m_lastPose.estimate = m_poseEstimator.Latest();
+}
+
 void SwervePlatform::Home(const units::degree_t currentAngle) {
   // SetPosition expects a value in degrees
-  m_encoderTurnFrontLeft.SetPosition(currentAngle.to<double>(), 50);
-  m_encoderTurnFrontRight.SetPosition(currentAngle.to<double>(), 50);
-  m_encoderTurnRearRight.SetPosition(currentAngle.to<double>(), 50);
-  m_encoderTurnRearLeft.SetPosition(currentAngle.to<double>(), 50);
+  m_encoderTurnFrontLeft->SetPosition(currentAngle.to<double>(), 50);
+  m_encoderTurnFrontRight->SetPosition(currentAngle.to<double>(), 50);
+  m_encoderTurnRearRight->SetPosition(currentAngle.to<double>(), 50);
+  m_encoderTurnRearLeft->SetPosition(currentAngle.to<double>(), 50);
 
   // GetAbsolutePosition returns degrees in configured range
   const ArgosLib::SwerveModulePositions newHomePositions{
-      .FrontLeft{units::make_unit<units::degree_t>(m_encoderTurnFrontLeft.GetAbsolutePosition()) + currentAngle},
-      .FrontRight{units::make_unit<units::degree_t>(m_encoderTurnFrontRight.GetAbsolutePosition()) + currentAngle},
-      .RearRight{units::make_unit<units::degree_t>(m_encoderTurnRearRight.GetAbsolutePosition()) + currentAngle},
-      .RearLeft{units::make_unit<units::degree_t>(m_encoderTurnRearLeft.GetAbsolutePosition()) + currentAngle},
+      .FrontLeft{units::make_unit<units::degree_t>(m_encoderTurnFrontLeft->GetAbsolutePosition()) + currentAngle},
+      .FrontRight{units::make_unit<units::degree_t>(m_encoderTurnFrontRight->GetAbsolutePosition()) + currentAngle},
+      .RearRight{units::make_unit<units::degree_t>(m_encoderTurnRearRight->GetAbsolutePosition()) + currentAngle},
+      .RearLeft{units::make_unit<units::degree_t>(m_encoderTurnRearLeft->GetAbsolutePosition()) + currentAngle},
   };
 
   m_pHomingStorage->Save(newHomePositions);
 }
 
-void SwervePlatform::SetFieldOrientation(const units::degree_t currentAngle [[maybe_unused]]) {
-  /// @todo Implement field-oriented functions when IMU enabled
-  // m_fieldOrientationOffset = m_IMU.GetRotation2d();
+void SwervePlatform::SetFieldOrientation(const units::degree_t currentAngle) {
+  const units::radian_t heading{m_lastPose.estimate ? m_lastPose.estimate.value().pose.heading : 0.0};
+  m_fieldOrientationOffset = heading - currentAngle;
 }
 
 void SwervePlatform::SetControlMode(const ControlMode newControlMode) {
   switch (newControlMode) {
     case ControlMode::fieldCentric:
-      std::printf("Switching to field-centric control\n");
+      ARGOS_LOG(ArgosLib::LogLevel::kInfo, "Switching to field-centric control");
       break;
     case ControlMode::robotCentric:
-      std::printf("Switching to robot-centric control\n");
+      ARGOS_LOG(ArgosLib::LogLevel::kInfo, "Switching to robot-centric control");
       break;
   }
   m_activeControlMode = newControlMode;
 }
 
+void SwervePlatform::BeginCommandTelemetry(const ModuleCommand command) {
+  const std::array turnMotors{m_motorTurnFrontLeft.get(),
+                              m_motorTurnFrontRight.get(),
+                              m_motorTurnRearRight.get(),
+                              m_motorTurnRearLeft.get()};
+  m_lastCommand.command = command;
+  m_lastCommand.desired = {};
+  m_lastCommand.optimized = {};
+  for (std::size_t module = 0; module < turnMotors.size(); ++module) {
+    m_lastCommand.turnPosition[module] =
+        measureUp::sensorConversion::swerveRotate::toAngle(turnMotors[module]->GetSelectedSensorPosition());
+    ctre::phoenix::motorcontrol::Faults faults;
+    turnMotors[module]->GetFaults(faults);
+    m_lastCommand.turnFaults[module] = faults.ToBitfield();
+  }
+}
+
 void SwervePlatform::InitializeTurnEncoderAngles() {
   const auto homeAngles = m_pHomingStorage->Load();
 
   if (homeAngles) {
     const units::degree_t curFrontLeftPosition =
-        units::make_unit<units::degree_t>(m_encoderTurnFrontLeft.GetAbsolutePosition()) - homeAngles.value().FrontLeft;
+        units::make_unit<units::degree_t>(m_encoderTurnFrontLeft->GetAbsolutePosition()) - homeAngles.value().FrontLeft;
     const units::degree_t curFrontRighPosition =
-        units::make_unit<units::degree_t>(m_encoderTurnFrontRight.GetAbsolutePosition()) -
+        units::make_unit<units::degree_t>(m_encoderTurnFrontRight->GetAbsolutePosition()) -
         homeAngles.value().FrontRight;
     const units::degree_t curRearRightPosition =
-        units::make_unit<units::degree_t>(m_encoderTurnRearRight.GetAbsolutePosition()) - homeAngles.value().RearRight;
+        units::make_unit<units::degree_t>(m_encoderTurnRearRight->GetAbsolutePosition()) - homeAngles.value().RearRight;
     const units::degree_t curRearLeftPosition =
-        units::make_unit<units::degree_t>(m_encoderTurnRearLeft.GetAbsolutePosition()) - homeAngles.value().RearLeft;
+        units::make_unit<units::degree_t>(m_encoderTurnRearLeft->GetAbsolutePosition()) - homeAngles.value().RearLeft;
 
     // SetPosition expects a value in degrees
-    m_encoderTurnFrontLeft.SetPosition(curFrontLeftPosition.to<double>(), 50);
-    m_encoderTurnFrontRight.SetPosition(curFrontRighPosition.to<double>(), 50);
-    m_encoderTurnRearRight.SetPosition(curRearRightPosition.to<double>(), 50);
-    m_encoderTurnRearLeft.SetPosition(curRearLeftPosition.to<double>(), 50);
+    m_encoderTurnFrontLeft->SetPosition(curFrontLeftPosition.to<double>(), 50);
+    m_encoderTurnFrontRight->SetPosition(curFrontRighPosition.to<double>(), 50);
+    m_encoderTurnRearRight->SetPosition(curRearRightPosition.to<double>(), 50);
+    m_encoderTurnRearLeft->SetPosition(curRearLeftPosition.to<double>(), 50);
   } else {
     std::cout << "[ERROR] Could not load home positions from persistent storage.\n";
   }
 }
 
+wpi::array<frc::Translation2d, 4> SwervePlatform::ModuleLeverArms(const PlatformDimensions& dimensions) {
+  return {frc::Translation2d{dimensions.platformLongitudinalLength / 2 - dimensions.frontLeftModule.longitudinalInset,
+                             -dimensions.platformLateralWidth / 2 + dimensions.frontLeftModule.lateralInset},
+          frc::Translation2d{dimensions.platformLongitudinalLength / 2 - dimensions.frontRightModule.longitudinalInset,
+                             dimensions.platformLateralWidth / 2 - dimensions.frontRightModule.lateralInset},
+          frc::Translation2d{-dimensions.platformLongitudinalLength / 2 + dimensions.rearRightModule.longitudinalInset,
+                             dimensions.platformLateralWidth / 2 - dimensions.rearRightModule.lateralInset},
+          frc::Translation2d{-dimensions.platformLongitudinalLength / 2 + dimensions.rearLeftModule.longitudinalInset,
+                             -dimensions.platformLateralWidth / 2 + dimensions.rearLeftModule.lateralInset}};
+}
+
 double SwervePlatform::ModuleDriveSpeed(const units::velocity::feet_per_second_t desiredSpeed,
                                         const units::velocity::feet_per_second_t maxSpeed,
                                         const ctre::phoenix::motorcontrol::Faults turnFaults) {
@@ -264,12 +400,17 @@ wpi::array<frc::SwerveModuleState, 4> SwervePlatform::RawModuleStates(const doub
   const auto desiredRotVelocity = m_maxAngularRate * rotateVelocity;
   switch (m_activeControlMode) {
     case ControlMode::fieldCentric:
-    /// @todo Implement field-centric control mode
-    // {
-    //   const auto rotationToApply = m_IMU.GetRotation2d() - m_fieldOrientationOffset;
-    //   return m_pSwerveKinematicsModel->ToSwerveModuleStates(frc::ChassisSpeeds::FromFieldRelativeSpeeds(
-    //       desiredFwVelocity, desiredLatVelocity, desiredRotVelocity, -rotationToApply));
-    // }
+      // Robot-centric until there is a heading estimate
+      if (m_lastPose.estimate) {
+        const frc::Rotation2d rotationToApply{units::radian_t{m_lastPose.estimate.value().pose.heading} -
+                                              m_fieldOrientationOffset};
+        // Negated because the kinematics frame is clockwise positive
+        return m_pSwerveKinematicsModel->ToSwerveModuleStates(
+            frc::ChassisSpeeds::FromFieldRelativeSpeeds(
+                desiredFwVelocity, desiredLatVelocity, desiredRotVelocity, -rotationToApply),
+            offset);
+      }
+      [[fallthrough]];
     case ControlMode::robotCentric:
       return m_pSwerveKinematicsModel->ToSwerveModuleStates(
           frc::ChassisSpeeds{desiredFwVelocity, desiredLatVelocity, desiredRotVelocity}, offset);
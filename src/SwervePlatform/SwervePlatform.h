@@ -5,17 +5,20 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <optional>
 
-#define Phoenix_No_WPI  // remove WPI dependencies
-#include "ctre/Phoenix.h"
 #include <frc/kinematics/SwerveDriveKinematics.h>
 #include <frc/kinematics/SwerveModuleState.h>
 #include <frc/geometry/Translation2d.h>
 #include <units/length.h>
 #include <units/velocity.h>
 #include <argosLib/general/swerveHomeStorage.h>
+#include "LineStateEstimator.h"
+#include "PoseEstimator.h"
 #include "SerialLineSensor.h"
+#include "SwervePlatformHardware.h"
 
 using units::feet_per_second_t;
 
@@ -30,6 +33,32 @@ class SwervePlatform {
     robotCentric,
   };
 
+  /// @brief What the motors were last told to do
+  enum class ModuleCommand : uint8_t {
+    stopped,  ///< Zero output
+    holding,  ///< Zero velocity
+    driving
+  };
+
+  /// @brief Module commands and sensor readings from the last Stop(), SwerveDrive() or LineFollow() call
+  struct CommandTelemetry {
+    ModuleCommand command{ModuleCommand::stopped};
+    std::array<frc::SwerveModuleState, 4> desired{};    ///< Kinematics output before Optimize.  Zero unless driving
+    std::array<frc::SwerveModuleState, 4> optimized{};  ///< Sent to the modules.  Zero unless driving
+    std::array<units::degree_t, 4> turnPosition{};      ///< Turn motor sensor position
+    std::array<int, 4> turnFaults{};                    ///< Turn motor Faults::ToBitfield()
+    std::optional<LineStateEstimator::State> linePrediction;  ///< Line state steered for, while following a line
+  };
+
+  /// @brief Inputs and result of the last UpdatePose() call
+  struct PoseTelemetry {
+    std::optional<PoseEstimator::Estimate> estimate;
+    PoseEstimator::Twist twist;  ///< Wheel odometry translation with gyro yaw rate where available
+    double imuYaw{0};            ///< Degrees, counter-clockwise positive.  Continuous
+    /// Disagreement between measured module velocities and the odometry twist (m/s).  Grows with slip or scrub
+    units::meters_per_second_t kinematicResidual{0};
+  };
+
   struct ModuleInset {
     units::inch_t lateralInset;
     units::inch_t longitudinalInset;
@@ -59,26 +88,60 @@ class SwervePlatform {
                  const auto& frontLeftTurnEncoderConfig,
                  const auto& frontRightTurnEncoderConfig,
                  const auto& rearRightTurnEncoderConfig,
-                 const auto& rearLeftTurnEncoderConfig);
+                 const auto& rearLeftTurnEncoderConfig,
+                 const auto& imuConfig);
 
   void SwerveDrive(const double fwVelocity,
                    const double latVelocity,
                    const double rotateVelocity,
                    const bool lineFollow = false,
                    frc::Translation2d offset = frc::Translation2d{});
-  void LineFollow(bool forward,
-                  bool reverse,
-                  std::optional<ProportionalArrayStatus> arrayStatus,
-                  SerialLineSensor& lineSensor);
+  /**
+   * @brief Steer along the line under the sensor array
+   *
+   * @param tick Current control loop iteration.  Sensor data is aged against its time
+   */
+  void LineFollow(const hardware::TickContext& tick, bool forward, bool reverse, const SerialLineSensor& lineSensor);
   void Stop(bool active = false);
 
+  /**
+   * @brief Advance the pose estimate with the module and IMU readings for this tick.  Call once per tick, before
+   *        commanding the modules, so field-centric driving uses the current heading
+   */
+  void UpdatePose(const hardware::TickContext& tick);
+
+  /// @brief Indexed by ModuleIndex.  For logging; reading it touches no hardware
+  [[nodiscard]] const CommandTelemetry& LastCommand() const { return m_lastCommand; }
+  [[nodiscard]] LineFollowState GetLineFollowState() const { return m_followState; }
+  [[nodiscard]] LineFollowDirection GetLineFollowDirection() const { return m_followDirection; }
+  [[nodiscard]] const PoseTelemetry& LastPose() const { return m_lastPose; }
+  [[nodiscard]] ControlMode GetControlMode() const { return m_activeControlMode; }
+
   void Home(const units::degree_t currentAngle);
-  void SetFieldOrientation(const units::degree_t);
+  /// @brief The latest home positions to reach storage were not saved, so they will be lost at power off
+  [[nodiscard]] bool HomeSaveFailed() const { return m_pHomingStorage->LastSaveFailed(); }
+  /**
+   * @brief Define the field frame for field-centric control
+   *
+   * @param currentAngle Field heading the platform has now, counter-clockwise positive.  0 makes the current forward
+   *        direction field forward
+   */
+  void SetFieldOrientation(const units::degree_t currentAngle);
 
   void SetControlMode(const ControlMode);
 
+  /**
+   * @brief Calculate module positions relative to platform center
+   *
+   * @param dimensions Platform and module geometry
+   * @return Module positions indexed by ModuleIndex.  X is forward and Y is right
+   */
+  [[nodiscard]] static wpi::array<frc::Translation2d, 4> ModuleLeverArms(const PlatformDimensions& dimensions);
+
  private:
   void InitializeTurnEncoderAngles();
+  /// @brief Start m_lastCommand for a new command: read turn positions and faults and clear module states
+  void BeginCommandTelemetry(ModuleCommand command);
 
   double ModuleDriveSpeed(const units::velocity::feet_per_second_t,
                           const units::velocity::feet_per_second_t,
@@ -88,19 +151,21 @@ class SwervePlatform {
                                                         const double,
                                                         frc::Translation2d offset = frc::Translation2d{});
 
-  TalonFX m_motorDriveFrontLeft;
-  TalonFX m_motorDriveFrontRight;
-  TalonFX m_motorDriveRearRight;
-  TalonFX m_motorDriveRearLeft;
-  TalonFX m_motorTurnFrontLeft;
-  TalonFX m_motorTurnFrontRight;
-  TalonFX m_motorTurnRearRight;
-  TalonFX m_motorTurnRearLeft;
+  std::unique_ptr<hardware::MotorInterface> m_motorDriveFrontLeft;
+  std::unique_ptr<hardware::MotorInterface> m_motorDriveFrontRight;
+  std::unique_ptr<hardware::MotorInterface> m_motorDriveRearRight;
+  std::unique_ptr<hardware::MotorInterface> m_motorDriveRearLeft;
+  std::unique_ptr<hardware::MotorInterface> m_motorTurnFrontLeft;
+  std::unique_ptr<hardware::MotorInterface> m_motorTurnFrontRight;
+  std::unique_ptr<hardware::MotorInterface> m_motorTurnRearRight;
+  std::unique_ptr<hardware::MotorInterface> m_motorTurnRearLeft;
+
+  std::unique_ptr<hardware::EncoderInterface> m_encoderTurnFrontLeft;
+  std::unique_ptr<hardware::EncoderInterface> m_encoderTurnFrontRight;
+  std::unique_ptr<hardware::EncoderInterface> m_encoderTurnRearRight;
+  std::unique_ptr<hardware::EncoderInterface> m_encoderTurnRearLeft;
 
-  CANCoder m_encoderTurnFrontLeft;
-  CANCoder m_encoderTurnFrontRight;
-  CANCoder m_encoderTurnRearRight;
-  CANCoder m_encoderTurnRearLeft;
+  std::unique_ptr<hardware::ImuInterface> m_imu;
 
   units::angular_velocity::degrees_per_second_t m_maxAngularRate;
   units::feet_per_second_t m_maxVelocity;
@@ -112,13 +177,30 @@ class SwervePlatform {
   ControlMode m_activeControlMode;
   LineFollowDirection m_followDirection{LineFollowDirection::unknown};
   LineFollowState m_followState{LineFollowState::normal};
+  LineStateEstimator m_lineStateEstimator;
+  LineStateEstimator::Motion m_lineFollowMotion;  ///< Sensor array motion from the last line follow command
+  CommandTelemetry m_lastCommand;
+  PoseEstimator m_poseEstimator;
+  PoseTelemetry m_lastPose;
+  units::radian_t m_fieldOrientationOffset{0};  ///< Estimated heading minus field heading
 };
 
 namespace measureUp {
   namespace drive {
     constexpr auto wheelDiameter = 4.0_in;
     constexpr auto wheelCircumference = wheelDiameter * M_PI;
+    constexpr auto gearRatio = 8.14;             ///< Motor rotations per wheel rotation
+    constexpr auto sensorCountsPerRev = 2048.0;  ///< Integrated sensor counts per motor rotation
   }  // namespace drive
+  namespace turn {
+    constexpr auto gearRatio = 12.8;  ///< Motor rotations per module rotation (SDS MK4 steering reduction)
+  }  // namespace turn
+  namespace lineSensor {
+    /// Sensor array position forward of platform center
+    constexpr units::meter_t longitudinalPosition = 10.0_in;
+    /// Lateral channel positions (m) ordered left to right.  Y is right
+    constexpr auto channelPositions = CenteredChannelPositions<SerialLineSensor::channelCount>(0.019);
+  }  // namespace lineSensor
   namespace sensorConversion {
     namespace swerveRotate {
       constexpr auto ticksPerDegree = 4096.0 / 360.0;
@@ -137,20 +219,24 @@ namespace measureUp {
     }  // namespace swerveRotate
     namespace swerveDrive {
       constexpr units::foot_t toDist(double sensorVal) {
-        return measureUp::drive::wheelCircumference / 8.14 / 2048 * sensorVal;
+        return measureUp::drive::wheelCircumference / measureUp::drive::gearRatio /
+               measureUp::drive::sensorCountsPerRev * sensorVal;
       }
       constexpr auto fromDist(units::inch_t distVal) {
-        return (distVal / measureUp::drive::wheelCircumference * 8.14 * 2048).to<double>();
+        return (distVal / measureUp::drive::wheelCircumference * measureUp::drive::gearRatio *
+                measureUp::drive::sensorCountsPerRev)
+            .to<double>();
       }
       // sensor value is in pulses/100ms (2048 pulses/revolution)
       // 8.14:1 gear ratio
       constexpr units::feet_per_second_t toVel(double sensorVal) {
-        return units::unit_t<units::inverse<units::decisecond>>(sensorVal) / 8.14 / 2048 *
-               measureUp::drive::wheelCircumference;
+        return units::unit_t<units::inverse<units::decisecond>>(sensorVal) / measureUp::drive::gearRatio /
+               measureUp::drive::sensorCountsPerRev * measureUp::drive::wheelCircumference;
       }
       constexpr auto fromVel(units::feet_per_second_t velValue) {
         units::unit_t<units::inverse<units::decisecond>> val =
-            velValue * 8.14 * 2048 / measureUp::drive::wheelCircumference;
+            velValue * measureUp::drive::gearRatio * measureUp::drive::sensorCountsPerRev /
+            measureUp::drive::wheelCircumference;
         return val.to<double>();
       }
     }  // namespace swerveDrive
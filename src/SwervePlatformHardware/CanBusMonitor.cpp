@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CanBusMonitor.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <cmath>
+#include <fstream>
+
+using namespace hardware;
+
+namespace {
+  /// Bits of an extended (29-bit identifier) data frame besides its payload, including the interframe space
+  constexpr double frameOverheadBits = 67;
+
+  std::optional<uint64_t> ReadStatistic(const std::string& interfaceName, const char* statistic) {
+    std::ifstream file{"/sys/class/net/" + interfaceName + "/statistics/" + statistic};
+    uint64_t value;
+    if (!(file >> value)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+}  // namespace
+
+CanBusMonitor::CanBusMonitor(std::string interfaceName,
+                             const double bitRate,
+                             const std::chrono::milliseconds samplePeriod)
+    : m_interfaceName{std::move(interfaceName)}
+    , m_bitRate{bitRate}
+    , m_samplePeriod{samplePeriod}
+    , m_utilization{std::nan("")}
+    , m_stop{false} {
+  m_monitorThread = std::thread(&CanBusMonitor::MonitorThread, this);
+}
+
+CanBusMonitor::~CanBusMonitor() {
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_monitorThread.join();
+}
+
+void CanBusMonitor::MonitorThread() {
+  // Lowest priority; the control loop always comes first
+  sched_param param{};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+  auto previous = ReadCounters();
+  std::unique_lock lock(m_mutex);
+  while (!m_wake.wait_for(lock, m_samplePeriod, [this]() { return m_stop; })) {
+    lock.unlock();
+    const auto current = ReadCounters();
+    double utilization = std::nan("");
+    if (previous && current && current.value().packets >= previous.value().packets &&
+        current.value().bytes >= previous.value().bytes) {
+      const double packets = current.value().packets - previous.value().packets;
+      const double bytes = current.value().bytes - previous.value().bytes;
+      const double seconds = std::chrono::duration<double>(current.value().time - previous.value().time).count();
+      if (seconds > 0) {
+        utilization = (packets * frameOverheadBits + bytes * 8) / (m_bitRate * seconds);
+      }
+    }
+    m_utilization.store(utilization, std::memory_order_relaxed);
+    previous = current;
+    lock.lock();
+  }
+}
+
+std::optional<CanBusMonitor::Counters> CanBusMonitor::ReadCounters() const {
+  // Frames sent and received both occupy the bus
+  const auto rxPackets = ReadStatistic(m_interfaceName, "rx_packets");
+  const auto txPackets = ReadStatistic(m_interfaceName, "tx_packets");
+  const auto rxBytes = ReadStatistic(m_interfaceName, "rx_bytes");
+  const auto txBytes = ReadStatistic(m_interfaceName, "tx_bytes");
+  if (!rxPackets || !txPackets || !rxBytes || !txBytes) {
+    return std::nullopt;
+  }
+  return Counters{.packets = rxPackets.value() + txPackets.value(),
+                  .bytes = rxBytes.value() + txBytes.value(),
+                  .time = std::chrono::steady_clock::now()};
+}
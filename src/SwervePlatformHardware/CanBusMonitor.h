@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace hardware {
+
+  /**
+   * @brief Estimates CAN bus utilization from the SocketCAN interface's packet and byte counters.  A thread at idle
+   *        priority samples the counters, so Utilization() is a single atomic load and safe to call from the control
+   *        loop.  The estimate counts extended frame overhead but not bit stuffing, so it reads a little low.
+   */
+  class CanBusMonitor {
+   public:
+    /**
+     * @param interfaceName SocketCAN interface, e.g. can0
+     * @param bitRate Bus bit rate (bits/s)
+     * @param samplePeriod Time between counter samples.  Utilization is averaged over this period
+     */
+    CanBusMonitor(std::string interfaceName, double bitRate, std::chrono::milliseconds samplePeriod);
+    ~CanBusMonitor();
+    CanBusMonitor(const CanBusMonitor&) = delete;
+    CanBusMonitor& operator=(const CanBusMonitor&) = delete;
+
+    /// @brief Fraction of bus time used, 0-1.  NaN until two samples are taken or if the interface has no statistics
+    [[nodiscard]] double Utilization() const { return m_utilization.load(std::memory_order_relaxed); }
+
+   private:
+    struct Counters {
+      uint64_t packets;
+      uint64_t bytes;
+      std::chrono::steady_clock::time_point time;
+    };
+
+    void MonitorThread();
+    [[nodiscard]] std::optional<Counters> ReadCounters() const;
+
+    const std::string m_interfaceName;
+    const double m_bitRate;
+    const std::chrono::milliseconds m_samplePeriod;
+    std::atomic<double> m_utilization;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;  ///< Guarded by m_mutex
+    std::thread m_monitorThread;
+  };
+
+}  // namespace hardware
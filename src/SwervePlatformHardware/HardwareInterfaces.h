@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ctre/phoenix/ErrorCode.h"
+#include "ctre/phoenix/motorcontrol/ControlMode.h"
+#include "ctre/phoenix/motorcontrol/Faults.h"
+
+namespace hardware {
+
+  /**
+   * @brief Subset of TalonFX functionality used by the swerve platform
+   */
+  class MotorInterface {
+   public:
+    virtual ~MotorInterface() = default;
+
+    /**
+     * @brief Command motor output
+     *
+     * @param mode Control mode to apply
+     * @param value Demand in native units of the control mode
+     */
+    virtual void Set(const ctre::phoenix::motorcontrol::ControlMode mode, const double value) = 0;
+
+    /**
+     * @brief Get position of the primary PID sensor
+     *
+     * @return Position in native sensor units
+     */
+    virtual double GetSelectedSensorPosition() = 0;
+
+    /**
+     * @brief Get velocity of the primary PID sensor
+     *
+     * @return Velocity in native sensor units per 100ms
+     */
+    virtual double GetSelectedSensorVelocity() = 0;
+
+    /**
+     * @brief Get active motor controller faults
+     *
+     * @param toFill Faults structure populated with current faults
+     * @return Error code of the request
+     */
+    virtual ctre::phoenix::ErrorCode GetFaults(ctre::phoenix::motorcontrol::Faults& toFill) = 0;
+  };
+
+  /**
+   * @brief Subset of CANCoder functionality used by the swerve platform
+   */
+  class EncoderInterface {
+   public:
+    virtual ~EncoderInterface() = default;
+
+    /**
+     * @brief Set relative position of the encoder
+     *
+     * @param newPosition Position in degrees
+     * @param timeoutMs Time to wait for confirmation.  0 to skip confirmation
+     * @return Error code of the request
+     */
+    virtual ctre::phoenix::ErrorCode SetPosition(const double newPosition, const int timeoutMs = 0) = 0;
+
+    /**
+     * @brief Get absolute position of the magnet
+     *
+     * @return Position in degrees within the configured absolute range
+     */
+    virtual double GetAbsolutePosition() = 0;
+  };
+
+  /**
+   * @brief Subset of Pigeon2 functionality used by the swerve platform
+   */
+  class ImuInterface {
+   public:
+    virtual ~ImuInterface() = default;
+
+    /**
+     * @brief Get yaw from the latest status frame
+     *
+     * @return Yaw in degrees, counter-clockwise positive.  Continuous (not wrapped)
+     */
+    virtual double GetYaw() = 0;
+
+    /**
+     * @brief Get angular rates from the latest status frame
+     *
+     * @param xyz_dps Filled with rates about the x, y and z axes in degrees per second
+     * @return Error code of the request
+     */
+    virtual ctre::phoenix::ErrorCode GetRawGyro(double xyz_dps[3]) = 0;
+
+    /**
+     * @brief Get the error code of the last get
+     */
+    virtual ctre::phoenix::ErrorCode GetLastError() = 0;
+  };
+
+}  // namespace hardware
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PhoenixHardware.h"
+
+#include "ctre/phoenix/platform/Platform.h"
+#include "ctre/phoenix/unmanaged/Unmanaged.h"
+
+using namespace hardware;
+
+PhoenixFalcon::PhoenixFalcon(const int address, const std::string& canInterfaceName)
+    : m_motor(address, canInterfaceName) {}
+
+void PhoenixFalcon::Set(const ctre::phoenix::motorcontrol::ControlMode mode, const double value) {
+  m_motor.Set(mode, value);
+}
+
+double PhoenixFalcon::GetSelectedSensorPosition() {
+  return m_motor.GetSelectedSensorPosition();
+}
+
+double PhoenixFalcon::GetSelectedSensorVelocity() {
+  return m_motor.GetSelectedSensorVelocity();
+}
+
+ctre::phoenix::ErrorCode PhoenixFalcon::GetFaults(ctre::phoenix::motorcontrol::Faults& toFill) {
+  return m_motor.GetFaults(toFill);
+}
+
+PhoenixCANCoder::PhoenixCANCoder(const int address, const std::string& canInterfaceName)
+    : m_encoder(address, canInterfaceName) {}
+
+ctre::phoenix::ErrorCode PhoenixCANCoder::SetPosition(const double newPosition, const int timeoutMs) {
+  return m_encoder.SetPosition(newPosition, timeoutMs);
+}
+
+double PhoenixCANCoder::GetAbsolutePosition() {
+  return m_encoder.GetAbsolutePosition();
+}
+
+PhoenixPigeon2::PhoenixPigeon2(const int address, const std::string& canInterfaceName)
+    : m_imu(address, canInterfaceName) {}
+
+double PhoenixPigeon2::GetYaw() {
+  return m_imu.GetYaw();
+}
+
+ctre::phoenix::ErrorCode PhoenixPigeon2::GetRawGyro(double xyz_dps[3]) {
+  return static_cast<ctre::phoenix::ErrorCode>(m_imu.GetRawGyro(xyz_dps));
+}
+
+ctre::phoenix::ErrorCode PhoenixPigeon2::GetLastError() {
+  return m_imu.GetLastError();
+}
+
+void hardware::FeedEnable(const int timeoutMs) {
+  ctre::phoenix::unmanaged::Unmanaged::FeedEnable(timeoutMs);
+}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#define Phoenix_No_WPI  // remove WPI dependencies
+#include "ctre/Phoenix.h"
+#include "argosLib/config/canCoderConfig.h"
+#include "argosLib/config/falconConfig.h"
+#include "HardwareInterfaces.h"
+
+namespace hardware {
+
+  using Clock = std::chrono::steady_clock;
+
+  template <class Rep, class Period>
+  void SleepFor(const std::chrono::duration<Rep, Period> sleepTime) {
+    std::this_thread::sleep_for(sleepTime);
+  }
+
+  class PhoenixFalcon : public MotorInterface {
+   public:
+    PhoenixFalcon(const int address, const std::string& canInterfaceName);
+
+    void Set(const ctre::phoenix::motorcontrol::ControlMode mode, const double value) override;
+    double GetSelectedSensorPosition() override;
+    double GetSelectedSensorVelocity() override;
+    ctre::phoenix::ErrorCode GetFaults(ctre::phoenix::motorcontrol::Faults& toFill) override;
+
+    [[nodiscard]] TalonFX& Device() { return m_motor; }
+
+   private:
+    TalonFX m_motor;
+  };
+
+  class PhoenixCANCoder : public EncoderInterface {
+   public:
+    PhoenixCANCoder(const int address, const std::string& canInterfaceName);
+
+    ctre::phoenix::ErrorCode SetPosition(const double newPosition, const int timeoutMs = 0) override;
+    double GetAbsolutePosition() override;
+
+    [[nodiscard]] CANCoder& Device() { return m_encoder; }
+
+   private:
+    CANCoder m_encoder;
+  };
+
+  class PhoenixPigeon2 : public ImuInterface {
+   public:
+    PhoenixPigeon2(const int address, const std::string& canInterfaceName);
+
+    double GetYaw() override;
+    ctre::phoenix::ErrorCode GetRawGyro(double xyz_dps[3]) override;
+    ctre::phoenix::ErrorCode GetLastError() override;
+
+    [[nodiscard]] ctre::phoenix::sensors::Pigeon2& Device() { return m_imu; }
+
+   private:
+    ctre::phoenix::sensors::Pigeon2 m_imu;
+  };
+
+  /**
+   * @brief Create and configure a Falcon on the CAN bus
+   *
+   * @tparam T Configuration structure accepted by FalconConfig()
+   * @param canInterfaceName SocketCAN interface the motor controller is attached to
+   * @return Configured motor
+   */
+  template <typename T>
+  std::unique_ptr<MotorInterface> MakeFalcon(const T&, const std::string& canInterfaceName) {
+    auto motor = std::make_unique<PhoenixFalcon>(T::address, canInterfaceName);
+    FalconConfig<T>(motor->Device(), 100_ms);
+    return motor;
+  }
+
+  /**
+   * @brief Create and configure a CANCoder on the CAN bus
+   *
+   * @tparam T Configuration structure accepted by CanCoderConfig()
+   * @param canInterfaceName SocketCAN interface the encoder is attached to
+   * @return Configured encoder
+   */
+  template <typename T>
+  std::unique_ptr<EncoderInterface> MakeCANCoder(const T&, const std::string& canInterfaceName) {
+    auto encoder = std::make_unique<PhoenixCANCoder>(T::address, canInterfaceName);
+    CanCoderConfig<T>(encoder->Device(), 100_ms);
+    return encoder;
+  }
+
+  /**
+   * @brief Create and configure a Pigeon2 on the CAN bus
+   *
+   * @tparam T Configuration structure with address and mountPoseYaw, mountPosePitch and mountPoseRoll in degrees
+   * @param canInterfaceName SocketCAN interface the IMU is attached to
+   * @return Configured IMU
+   */
+  template <typename T>
+  std::unique_ptr<ImuInterface> MakePigeon2(const T&, const std::string& canInterfaceName) {
+    auto imu = std::make_unique<PhoenixPigeon2>(T::address, canInterfaceName);
+    imu->Device().ConfigMountPose(T::mountPoseYaw, T::mountPosePitch, T::mountPoseRoll, 100);
+    return imu;
+  }
+
+  /**
+   * @brief Keep motor controllers enabled for the next timeoutMs milliseconds
+   */
+  void FeedEnable(const int timeoutMs);
+
+}  // namespace hardware
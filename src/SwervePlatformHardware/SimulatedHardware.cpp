@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SimulatedHardware.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace hardware;
+
+namespace {
+  constexpr double falconFreeSpeedRpm = 6380.0;
+  constexpr double integratedSensorTicksPerRev = 2048.0;
+  constexpr double canCoderTicksPerRev = 4096.0;
+
+  /// Talon closed-loop gains are scaled to 1023 full-scale output and evaluated every 1ms
+  constexpr double talonFullScaleOutput = 1023.0;
+  constexpr std::chrono::duration<double> talonLoopPeriod = std::chrono::milliseconds{1};
+
+  std::map<int, SimulatedCANCoder*>& EncoderRegistry() {
+    static std::map<int, SimulatedCANCoder*> registry;
+    return registry;
+  }
+
+  std::map<int, SimulatedFalcon*>& MotorRegistry() {
+    static std::map<int, SimulatedFalcon*> registry;
+    return registry;
+  }
+
+  std::map<int, SimulatedPigeon2*>& ImuRegistry() {
+    static std::map<int, SimulatedPigeon2*> registry;
+    return registry;
+  }
+
+  struct ClockState {
+    std::mutex mutex;
+    SimulationInterface* simulation{nullptr};
+    SimulatedClock::duration fixedStep{std::chrono::milliseconds{1}};
+    SimulatedClock::duration unsteppedTime{0};
+    double realTimeFactor{1.0};
+    std::chrono::steady_clock::time_point wallAnchor{std::chrono::steady_clock::now()};
+    SimulatedClock::duration virtualAnchor{0};
+  };
+
+  ClockState& GetClockState() {
+    static ClockState state;
+    return state;
+  }
+}  // namespace
+
+std::atomic<SimulatedClock::rep> SimulatedClock::s_now{0};
+
+SimulatedClock::time_point SimulatedClock::now() noexcept {
+  return time_point{duration{s_now.load()}};
+}
+
+void SimulatedClock::SleepFor(const duration sleepTime) {
+  auto& state = GetClockState();
+  std::unique_lock lock(state.mutex);
+  if (sleepTime <= duration::zero()) {
+    return;
+  }
+
+  const auto newNow = duration{s_now.load()} + sleepTime;
+  if (state.simulation) {
+    // Simulation only advances in whole steps.  Remainder carries into the next sleep
+    state.unsteppedTime += sleepTime;
+    while (state.unsteppedTime >= state.fixedStep) {
+      state.simulation->Step(state.fixedStep);
+      state.unsteppedTime -= state.fixedStep;
+      s_now.store((newNow - state.unsteppedTime).count());
+    }
+  }
+  s_now.store(newNow.count());
+
+  if (state.realTimeFactor > 0) {
+    const auto wallTarget =
+        state.wallAnchor + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double>(newNow - state.virtualAnchor) / state.realTimeFactor);
+    lock.unlock();
+    std::this_thread::sleep_until(wallTarget);
+  }
+}
+
+void SimulatedClock::Attach(SimulationInterface* simulation, const duration fixedStep) {
+  auto& state = GetClockState();
+  std::scoped_lock lock(state.mutex);
+  state.simulation = simulation;
+  state.fixedStep = fixedStep;
+  state.unsteppedTime = duration::zero();
+}
+
+void SimulatedClock::Detach(const SimulationInterface* simulation) {
+  auto& state = GetClockState();
+  std::scoped_lock lock(state.mutex);
+  if (state.simulation == simulation) {
+    state.simulation = nullptr;
+  }
+}
+
+void SimulatedClock::SetRealTimeFactor(const double realTimeFactor) {
+  auto& state = GetClockState();
+  std::scoped_lock lock(state.mutex);
+  state.realTimeFactor = std::max(realTimeFactor, 0.0);
+  state.wallAnchor = std::chrono::steady_clock::now();
+  state.virtualAnchor = duration{s_now.load()};
+}
+
+SimulatedCANCoder::SimulatedCANCoder(const int address,
+                                     const double magnetOffset,
+                                     const ctre::phoenix::sensors::AbsoluteSensorRange range)
+    : m_address{address}, m_magnetOffset{magnetOffset}, m_range{range} {
+  EncoderRegistry()[m_address] = this;
+}
+
+SimulatedCANCoder::~SimulatedCANCoder() {
+  auto registered = EncoderRegistry().find(m_address);
+  if (registered != EncoderRegistry().end() && registered->second == this) {
+    EncoderRegistry().erase(registered);
+  }
+}
+
+ctre::phoenix::ErrorCode SimulatedCANCoder::SetPosition(const double newPosition, const int /*timeoutMs*/) {
+  m_positionOffset = newPosition - m_mechanismAngle;
+  return ctre::phoenix::ErrorCode::OK;
+}
+
+double SimulatedCANCoder::GetAbsolutePosition() {
+  double absolutePosition = std::fmod(m_mechanismAngle + m_magnetOffset, 360.0);
+  if (absolutePosition < 0) {
+    absolutePosition += 360.0;
+  }
+  if (m_range == ctre::phoenix::sensors::AbsoluteSensorRange::Signed_PlusMinus180 && absolutePosition >= 180.0) {
+    absolutePosition -= 360.0;
+  }
+  return absolutePosition;
+}
+
+double SimulatedCANCoder::GetPosition() const {
+  return m_mechanismAngle + m_positionOffset;
+}
+
+SimulatedCANCoder* SimulatedCANCoder::Find(const int address) {
+  auto registered = EncoderRegistry().find(address);
+  return registered == EncoderRegistry().end() ? nullptr : registered->second;
+}
+
+SimulatedPigeon2::SimulatedPigeon2(const int address, const std::chrono::nanoseconds statusFramePeriod)
+    : m_address{address}, m_statusFramePeriod{statusFramePeriod}, m_nextFrame{Clock::now()} {
+  ImuRegistry()[m_address] = this;
+}
+
+SimulatedPigeon2::~SimulatedPigeon2() {
+  auto registered = ImuRegistry().find(m_address);
+  if (registered != ImuRegistry().end() && registered->second == this) {
+    ImuRegistry().erase(registered);
+  }
+}
+
+double SimulatedPigeon2::GetYaw() {
+  return m_yaw;
+}
+
+ctre::phoenix::ErrorCode SimulatedPigeon2::GetRawGyro(double xyz_dps[3]) {
+  xyz_dps[0] = 0.0;
+  xyz_dps[1] = 0.0;
+  xyz_dps[2] = m_yawRate;
+  return ctre::phoenix::ErrorCode::OK;
+}
+
+void SimulatedPigeon2::SetMechanismState(const double yaw, const double yawRate) {
+  const auto now = Clock::now();
+  if (now < m_nextFrame) {
+    return;
+  }
+  m_yaw = yaw;
+  m_yawRate = yawRate;
+  m_nextFrame += m_statusFramePeriod;
+  if (m_nextFrame <= now) {
+    m_nextFrame = now + m_statusFramePeriod;
+  }
+}
+
+SimulatedPigeon2* SimulatedPigeon2::Find(const int address) {
+  auto registered = ImuRegistry().find(address);
+  return registered == ImuRegistry().end() ? nullptr : registered->second;
+}
+
+SimulatedFalcon::SimulatedFalcon(const Parameters& params) : m_params{params}, m_lastUpdateTime{Clock::now()} {
+  MotorRegistry()[m_params.address] = this;
+}
+
+SimulatedFalcon::~SimulatedFalcon() {
+  auto registered = MotorRegistry().find(m_params.address);
+  if (registered != MotorRegistry().end() && registered->second == this) {
+    MotorRegistry().erase(registered);
+  }
+}
+
+void SimulatedFalcon::Set(const ctre::phoenix::motorcontrol::ControlMode mode, const double value) {
+  Update();
+  if (mode != m_mode) {
+    m_integralAccum = 0.0;
+    m_lastError = std::nullopt;
+  }
+  m_mode = mode;
+  m_demand = value;
+}
+
+double SimulatedFalcon::GetSelectedSensorPosition() {
+  Update();
+  return SensorPosition();
+}
+
+ctre::phoenix::ErrorCode SimulatedFalcon::GetFaults(ctre::phoenix::motorcontrol::Faults& toFill) {
+  toFill = ctre::phoenix::motorcontrol::Faults{};
+  return ctre::phoenix::ErrorCode::OK;
+}
+
+double SimulatedFalcon::GetSelectedSensorVelocity() {
+  Update();
+  return m_velocity;
+}
+
+double SimulatedFalcon::ComputeOutput(const std::chrono::duration<double> dt) {
+  double output = 0.0;
+  switch (m_mode) {
+    case ctre::phoenix::motorcontrol::ControlMode::PercentOutput:
+      output = m_demand;
+      break;
+    case ctre::phoenix::motorcontrol::ControlMode::Velocity:
+    case ctre::phoenix::motorcontrol::ControlMode::Position: {
+      const double measured =
+          m_mode == ctre::phoenix::motorcontrol::ControlMode::Velocity ? m_velocity : SensorPosition();
+      double error = m_demand - measured;
+      if (std::abs(error) <= m_params.allowableError) {
+        error = 0.0;
+      }
+      const double loops = dt / talonLoopPeriod;
+      if (m_params.iZone > 0 && std::abs(error) > m_params.iZone) {
+        m_integralAccum = 0.0;
+      } else {
+        m_integralAccum += error * loops;
+      }
+      const double derivative = m_lastError && loops > 0 ? (error - m_lastError.value()) / loops : 0.0;
+      m_lastError = error;
+      output = (m_params.kF * m_demand + m_params.kP * error + m_params.kI * m_integralAccum +
+                m_params.kD * derivative) /
+               talonFullScaleOutput;
+      break;
+    }
+    default:
+      break;
+  }
+  output = std::clamp(output, m_params.peakOutputReverse, m_params.peakOutputForward);
+  return std::abs(output) < m_params.neutralDeadband ? 0.0 : output;
+}
+
+void SimulatedFalcon::SetSensorState(const double integratedPosition, const double selectedVelocity) {
+  m_integratedPosition = integratedPosition;
+  m_velocity = selectedVelocity;
+}
+
+SimulatedFalcon* SimulatedFalcon::Find(const int address) {
+  auto registered = MotorRegistry().find(address);
+  return registered == MotorRegistry().end() ? nullptr : registered->second;
+}
+
+void SimulatedFalcon::Update() {
+  const auto now = Clock::now();
+  const std::chrono::duration<double> dt = now - m_lastUpdateTime;
+  m_lastUpdateTime = now;
+  if (m_externallyDriven || dt.count() <= 0) {
+    return;
+  }
+
+  const double maxForward = FreeSpeed() * m_params.peakOutputForward;
+  const double maxReverse = FreeSpeed() * m_params.peakOutputReverse;
+  // Fraction of the remaining error removed this step for a first-order response
+  const double response = 1.0 - std::exp(-dt.count() / m_params.timeConstant.count());
+  const double dt100ms = dt.count() * 10.0;
+
+  double targetVelocity = 0.0;
+  switch (m_mode) {
+    case ctre::phoenix::motorcontrol::ControlMode::PercentOutput:
+      targetVelocity = m_demand * FreeSpeed();
+      break;
+    case ctre::phoenix::motorcontrol::ControlMode::Velocity:
+      targetVelocity = m_demand;
+      break;
+    case ctre::phoenix::motorcontrol::ControlMode::Position: {
+      // Position loop converges on the setpoint with the same time constant
+      const double positionStep = (m_demand - SensorPosition()) * response;
+      targetVelocity = positionStep / dt100ms;
+      break;
+    }
+    default:
+      break;
+  }
+  targetVelocity = std::clamp(targetVelocity, maxReverse, maxForward);
+
+  if (m_mode == ctre::phoenix::motorcontrol::ControlMode::Position) {
+    m_velocity = targetVelocity;
+  } else {
+    m_velocity += (targetVelocity - m_velocity) * response;
+  }
+  MoveSensor(m_velocity * dt100ms);
+}
+
+double SimulatedFalcon::FreeSpeed() const {
+  const double freeSpeedRps = falconFreeSpeedRpm / 60.0;
+  if (m_params.remoteEncoderAddress) {
+    return freeSpeedRps / m_params.remoteSensorGearRatio * canCoderTicksPerRev / 10.0;
+  }
+  return freeSpeedRps * integratedSensorTicksPerRev / 10.0;
+}
+
+double SimulatedFalcon::SensorPosition() const {
+  if (m_params.remoteEncoderAddress) {
+    const auto encoder = SimulatedCANCoder::Find(m_params.remoteEncoderAddress.value());
+    return encoder ? encoder->GetPosition() * canCoderTicksPerRev / 360.0 : 0.0;
+  }
+  return m_integratedPosition;
+}
+
+void SimulatedFalcon::MoveSensor(const double delta) {
+  m_integratedPosition += delta;
+  if (m_params.remoteEncoderAddress) {
+    const auto encoder = SimulatedCANCoder::Find(m_params.remoteEncoderAddress.value());
+    if (encoder) {
+      encoder->SetMechanismAngle(encoder->GetMechanismAngle() + delta * 360.0 / canCoderTicksPerRev);
+    }
+  }
+}
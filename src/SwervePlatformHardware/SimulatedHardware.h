@@ -0,0 +1,352 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <units/current.h>
+#include <units/voltage.h>
+
+#include "ctre/phoenix/motorcontrol/NeutralMode.h"
+#include "ctre/phoenix/sensors/AbsoluteSensorRange.h"
+#include "argosLib/config/compileTimeMemberCheck.h"
+#include "HardwareInterfaces.h"
+
+namespace hardware {
+
+  /**
+   * @brief Model advanced by SimulatedClock in fixed time steps
+   */
+  class SimulationInterface {
+   public:
+    virtual ~SimulationInterface() = default;
+
+    /**
+     * @brief Advance simulation state
+     *
+     * @param dt Fixed step size the model was attached with
+     */
+    virtual void Step(const std::chrono::duration<double> dt) = 0;
+  };
+
+  /**
+   * @brief Virtual monotonic clock for simulated builds.  Time only advances through SleepFor(), which steps any
+   *        attached simulation and optionally paces against wall time.
+   */
+  class SimulatedClock {
+   public:
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<SimulatedClock>;
+    static constexpr bool is_steady = true;
+
+    [[nodiscard]] static time_point now() noexcept;
+
+    /**
+     * @brief Advance virtual time, stepping the attached simulation in fixed increments
+     */
+    static void SleepFor(const duration sleepTime);
+
+    /**
+     * @brief Attach a simulation to be stepped as virtual time advances.  Only one simulation may be attached.
+     *
+     * @param simulation Model to step
+     * @param fixedStep Step size passed to every SimulationInterface::Step() call
+     */
+    static void Attach(SimulationInterface* simulation, const duration fixedStep);
+    static void Detach(const SimulationInterface* simulation);
+
+    /**
+     * @brief Set pacing of virtual time relative to wall time
+     *
+     * @param realTimeFactor Simulated seconds per wall second.  0 runs as fast as possible
+     */
+    static void SetRealTimeFactor(const double realTimeFactor);
+
+   private:
+    static std::atomic<rep> s_now;
+  };
+
+  using Clock = SimulatedClock;
+
+  template <class Rep, class Period>
+  void SleepFor(const std::chrono::duration<Rep, Period> sleepTime) {
+    SimulatedClock::SleepFor(std::chrono::duration_cast<SimulatedClock::duration>(sleepTime));
+  }
+
+  /**
+   * @brief In-process stand-in for a CANCoder mounted on a steering shaft
+   */
+  class SimulatedCANCoder : public EncoderInterface {
+   public:
+    SimulatedCANCoder(const int address,
+                      const double magnetOffset = 0.0,
+                      const ctre::phoenix::sensors::AbsoluteSensorRange range =
+                          ctre::phoenix::sensors::AbsoluteSensorRange::Unsigned_0_to_360);
+    ~SimulatedCANCoder();
+    SimulatedCANCoder(const SimulatedCANCoder&) = delete;
+    SimulatedCANCoder& operator=(const SimulatedCANCoder&) = delete;
+
+    ctre::phoenix::ErrorCode SetPosition(const double newPosition, const int timeoutMs = 0) override;
+    double GetAbsolutePosition() override;
+
+    /// @brief Relative position in degrees, including offset applied by SetPosition()
+    [[nodiscard]] double GetPosition() const;
+
+    /// @brief Physical angle of the magnet in degrees, counter-clockwise positive.  Continuous (not wrapped)
+    [[nodiscard]] double GetMechanismAngle() const { return m_mechanismAngle; }
+    void SetMechanismAngle(const double newAngle) { m_mechanismAngle = newAngle; }
+
+    /**
+     * @brief Find a simulated encoder by CAN address
+     *
+     * @return Encoder at address or nullptr if none exists
+     */
+    [[nodiscard]] static SimulatedCANCoder* Find(const int address);
+
+   private:
+    const int m_address;
+    const double m_magnetOffset;
+    const ctre::phoenix::sensors::AbsoluteSensorRange m_range;
+    double m_mechanismAngle{0.0};
+    double m_positionOffset{0.0};
+  };
+
+  /**
+   * @brief In-process stand-in for a TalonFX.  Emulates the closed-loop output calculation of the motor controller.
+   *        Sensor state follows a first-order response unless an external simulation drives it.
+   */
+  class SimulatedFalcon : public MotorInterface {
+   public:
+    struct Parameters {
+      int address;
+      std::optional<int> remoteEncoderAddress{std::nullopt};  ///< Selected sensor is a remote CANCoder when set
+      double remoteSensorGearRatio{1.0};  ///< Motor rotations per remote sensor rotation
+      double peakOutputForward{1.0};
+      double peakOutputReverse{-1.0};
+      double neutralDeadband{0.04};
+      bool neutralBrake{false};
+      std::optional<units::volt_t> voltCompSat{std::nullopt};
+      std::optional<units::ampere_t> supplyCurrentLimit{std::nullopt};
+      double kP{0.0};
+      double kI{0.0};
+      double kD{0.0};
+      double kF{0.0};
+      double iZone{0.0};
+      double allowableError{0.0};
+      std::chrono::duration<double> timeConstant{std::chrono::milliseconds{100}};
+    };
+
+    explicit SimulatedFalcon(const Parameters& params);
+    ~SimulatedFalcon();
+    SimulatedFalcon(const SimulatedFalcon&) = delete;
+    SimulatedFalcon& operator=(const SimulatedFalcon&) = delete;
+
+    void Set(const ctre::phoenix::motorcontrol::ControlMode mode, const double value) override;
+    double GetSelectedSensorPosition() override;
+    double GetSelectedSensorVelocity() override;
+    ctre::phoenix::ErrorCode GetFaults(ctre::phoenix::motorcontrol::Faults& toFill) override;
+
+    [[nodiscard]] const Parameters& GetParameters() const { return m_params; }
+
+    /**
+     * @brief Hand sensor updates to an external simulation instead of the built-in first-order response
+     */
+    void SetExternallyDriven(const bool externallyDriven) { m_externallyDriven = externallyDriven; }
+
+    /**
+     * @brief Run one iteration of the motor controller's output calculation
+     *
+     * @param dt Time since the previous iteration
+     * @return Output as a fraction of full scale (-1 to 1) after peak output and neutral deadband are applied
+     */
+    [[nodiscard]] double ComputeOutput(const std::chrono::duration<double> dt);
+
+    /**
+     * @brief Update sensor state from an external simulation
+     *
+     * @param integratedPosition Integrated sensor position in native units.  Ignored when selected sensor is remote
+     * @param selectedVelocity Selected sensor velocity in native units per 100ms
+     */
+    void SetSensorState(const double integratedPosition, const double selectedVelocity);
+
+    /**
+     * @brief Find a simulated motor by CAN address
+     *
+     * @return Motor at address or nullptr if none exists
+     */
+    [[nodiscard]] static SimulatedFalcon* Find(const int address);
+
+   private:
+    void Update();
+    [[nodiscard]] double FreeSpeed() const;
+    [[nodiscard]] double SensorPosition() const;
+    void MoveSensor(const double delta);
+
+    const Parameters m_params;
+    ctre::phoenix::motorcontrol::ControlMode m_mode{ctre::phoenix::motorcontrol::ControlMode::PercentOutput};
+    double m_demand{0.0};
+    double m_velocity{0.0};            ///< Native units per 100ms
+    double m_integratedPosition{0.0};  ///< Native units
+    double m_integralAccum{0.0};
+    std::optional<double> m_lastError{std::nullopt};
+    bool m_externallyDriven{false};
+    Clock::time_point m_lastUpdateTime;
+  };
+
+  /**
+   * @brief In-process stand-in for a Pigeon2.  Readings only change once per status frame period, like the CAN frames
+   *        a real Pigeon2 sends, so they lag the model by up to one period.
+   */
+  class SimulatedPigeon2 : public ImuInterface {
+   public:
+    explicit SimulatedPigeon2(const int address,
+                              const std::chrono::nanoseconds statusFramePeriod = std::chrono::milliseconds{10});
+    ~SimulatedPigeon2();
+    SimulatedPigeon2(const SimulatedPigeon2&) = delete;
+    SimulatedPigeon2& operator=(const SimulatedPigeon2&) = delete;
+
+    double GetYaw() override;
+    ctre::phoenix::ErrorCode GetRawGyro(double xyz_dps[3]) override;
+    ctre::phoenix::ErrorCode GetLastError() override { return ctre::phoenix::ErrorCode::OK; }
+
+    /**
+     * @brief Update the physical heading.  Sent as the next status frame when one is due
+     *
+     * @param yaw Degrees, counter-clockwise positive.  Continuous (not wrapped)
+     * @param yawRate Degrees per second, counter-clockwise positive
+     */
+    void SetMechanismState(const double yaw, const double yawRate);
+
+    /**
+     * @brief Find a simulated IMU by CAN address
+     *
+     * @return IMU at address or nullptr if none exists
+     */
+    [[nodiscard]] static SimulatedPigeon2* Find(const int address);
+
+   private:
+    const int m_address;
+    const std::chrono::nanoseconds m_statusFramePeriod;
+    Clock::time_point m_nextFrame;
+    double m_yaw{0.0};      ///< As of the last status frame
+    double m_yawRate{0.0};  ///< As of the last status frame
+  };
+
+  HAS_MEMBER(remoteFilter0_addr)
+  HAS_MEMBER(remoteSensorGearRatio)
+  HAS_MEMBER(peakOutputForward)
+  HAS_MEMBER(peakOutputReverse)
+  HAS_MEMBER(neutralDeadband)
+  HAS_MEMBER(neutralMode)
+  HAS_MEMBER(voltCompSat)
+  HAS_MEMBER(supplyCurrentLimit)
+  HAS_MEMBER(pid0_kP)
+  HAS_MEMBER(pid0_kI)
+  HAS_MEMBER(pid0_kD)
+  HAS_MEMBER(pid0_kF)
+  HAS_MEMBER(pid0_iZone)
+  HAS_MEMBER(pid0_allowableError)
+  HAS_MEMBER(magOffset)
+  HAS_MEMBER(range)
+
+  /**
+   * @brief Create a simulated Falcon from a hardware configuration structure
+   *
+   * @tparam T Configuration structure accepted by FalconConfig()
+   * @return Simulated motor
+   */
+  template <typename T>
+  std::unique_ptr<MotorInterface> MakeFalcon(const T&, const std::string& /*canInterfaceName*/) {
+    SimulatedFalcon::Parameters params{.address = T::address};
+    if constexpr (has_remoteFilter0_addr<T>{}) {
+      params.remoteEncoderAddress = T::remoteFilter0_addr;
+      params.timeConstant = std::chrono::milliseconds{50};
+    }
+    if constexpr (has_remoteSensorGearRatio<T>{}) {
+      params.remoteSensorGearRatio = T::remoteSensorGearRatio;
+    }
+    if constexpr (has_peakOutputForward<T>{}) {
+      params.peakOutputForward = T::peakOutputForward;
+    }
+    if constexpr (has_peakOutputReverse<T>{}) {
+      params.peakOutputReverse = T::peakOutputReverse;
+    }
+    if constexpr (has_neutralDeadband<T>{}) {
+      params.neutralDeadband = T::neutralDeadband;
+    }
+    if constexpr (has_neutralMode<T>{}) {
+      params.neutralBrake = T::neutralMode == ctre::phoenix::motorcontrol::NeutralMode::Brake;
+    }
+    if constexpr (has_voltCompSat<T>{}) {
+      params.voltCompSat = T::voltCompSat;
+    }
+    if constexpr (has_supplyCurrentLimit<T>{}) {
+      params.supplyCurrentLimit = T::supplyCurrentLimit;
+    }
+    if constexpr (has_pid0_kP<T>{}) {
+      params.kP = T::pid0_kP;
+    }
+    if constexpr (has_pid0_kI<T>{}) {
+      params.kI = T::pid0_kI;
+    }
+    if constexpr (has_pid0_kD<T>{}) {
+      params.kD = T::pid0_kD;
+    }
+    if constexpr (has_pid0_kF<T>{}) {
+      params.kF = T::pid0_kF;
+    }
+    if constexpr (has_pid0_iZone<T>{}) {
+      params.iZone = T::pid0_iZone;
+    }
+    if constexpr (has_pid0_allowableError<T>{}) {
+      params.allowableError = T::pid0_allowableError;
+    }
+    return std::make_unique<SimulatedFalcon>(params);
+  }
+
+  /**
+   * @brief Create a simulated CANCoder from a hardware configuration structure
+   *
+   * @tparam T Configuration structure accepted by CanCoderConfig()
+   * @return Simulated encoder
+   */
+  template <typename T>
+  std::unique_ptr<EncoderInterface> MakeCANCoder(const T&, const std::string& /*canInterfaceName*/) {
+    double magnetOffset = 0.0;
+    auto range = ctre::phoenix::sensors::AbsoluteSensorRange::Unsigned_0_to_360;
+    if constexpr (has_magOffset<T>{}) {
+      magnetOffset = T::magOffset;
+    }
+    if constexpr (has_range<T>{}) {
+      range = T::range;
+    }
+    return std::make_unique<SimulatedCANCoder>(T::address, magnetOffset, range);
+  }
+
+  /**
+   * @brief Create a simulated Pigeon2 from a hardware configuration structure.  Mount pose is ignored; the simulated
+   *        IMU is always level and facing forward
+   *
+   * @tparam T Configuration structure accepted by the Phoenix MakePigeon2()
+   * @return Simulated IMU
+   */
+  template <typename T>
+  std::unique_ptr<ImuInterface> MakePigeon2(const T&, const std::string& /*canInterfaceName*/) {
+    return std::make_unique<SimulatedPigeon2>(T::address);
+  }
+
+  /**
+   * @brief Simulated motors are always enabled
+   */
+  inline void FeedEnable(const int /*timeoutMs*/) {}
+
+}  // namespace hardware
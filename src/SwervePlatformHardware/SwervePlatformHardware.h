@@ -0,0 +1,17 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// Backend is selected at build time by the SWERVE_SIMULATED_HARDWARE CMake option.  Each backend provides
+// MakeFalcon(), MakeCANCoder(), FeedEnable(), SleepFor(), and a Clock type in the hardware namespace.  TickContext
+// carries one reading of that clock through a control loop iteration.
+#ifdef SWERVE_SIMULATED_HARDWARE
+#include "SimulatedHardware.h"
+#else
+#include "PhoenixHardware.h"
+#endif
+
+#include "TickContext.h"
@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// Included by SwervePlatformHardware.h once the backend has defined Clock
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace hardware {
+
+  /**
+   * @brief Time of one control loop iteration, read once when the iteration starts.  Everything evaluated during the
+   *        iteration uses these values instead of reading a clock, so decisions within a tick agree with each other
+   *        and simulated runs repeat exactly.
+   */
+  struct TickContext {
+    uint64_t index;                                    ///< Iterations before this one
+    Clock::time_point time;                            ///< Start of the iteration on the loop clock
+    Clock::time_point deadline;                        ///< When the next iteration is due
+    std::chrono::steady_clock::time_point steadyTime;  ///< Start of the iteration for comparison with device timestamps
+
+    /**
+     * @brief Read the clocks for a new iteration
+     *
+     * @param index Iterations before this one
+     * @param period Loop period
+     */
+    template <class Rep, class Period>
+    [[nodiscard]] static TickContext Begin(const uint64_t index, const std::chrono::duration<Rep, Period> period) {
+      const auto time = Clock::now();
+      std::chrono::steady_clock::time_point steadyTime;
+      if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+        steadyTime = time;
+      } else {
+        steadyTime = std::chrono::steady_clock::now();
+      }
+      return TickContext{.index = index,
+                         .time = time,
+                         .deadline = time + std::chrono::duration_cast<Clock::duration>(period),
+                         .steadyTime = steadyTime};
+    }
+
+    /// @brief Time left before the deadline, zero once it has passed
+    [[nodiscard]] Clock::duration Remaining() const {
+      return std::max(deadline - Clock::now(), Clock::duration::zero());
+    }
+  };
+
+}  // namespace hardware
@@ -6,51 +6,238 @@
 #include "SwervePlatformHomingStorage.h"
 
 #include <stdlib.h>
-#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <argosLib/general/durableFile.h>
+
+namespace {
+  constexpr std::array<char, 4> magic{'S', 'W', 'H', 'M'};
+  constexpr uint16_t version = 1;
+
+  /// Record layout, host byte order: magic, version, 2 reserved bytes, generation, positions in degrees
+  /// (front left, front right, rear right, rear left), then the CRC-32 of everything before it
+  constexpr std::size_t generationOffset = 8;
+  constexpr std::size_t positionsOffset = 16;
+  constexpr std::size_t crcOffset = positionsOffset + 4 * sizeof(double);
+  constexpr std::size_t recordSize = crcOffset + sizeof(uint32_t);
+  using Record = std::array<uint8_t, recordSize>;
+
+  /// Slots are named <fileName>.<slot>.  Earlier versions wrote text to <fileName> itself
+  constexpr auto fileName = "moduleHomes";
+
+  constexpr std::array<uint32_t, 256> MakeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }
+  constexpr auto crcTable = MakeCrcTable();
+
+  /// CRC-32 (IEEE 802.3)
+  uint32_t Crc32(const uint8_t* data, const std::size_t size) {
+    uint32_t crc = 0xFFFFFFFFU;
+    for (std::size_t i = 0; i < size; ++i) {
+      crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+  }
+
+  std::array<double, 4> ToArray(const ArgosLib::SwerveModulePositions& positions) {
+    return {positions.FrontLeft.to<double>(),
+            positions.FrontRight.to<double>(),
+            positions.RearRight.to<double>(),
+            positions.RearLeft.to<double>()};
+  }
+
+  ArgosLib::SwerveModulePositions FromArray(const std::array<double, 4>& degrees) {
+    return ArgosLib::SwerveModulePositions{.FrontLeft{units::make_unit<units::degree_t>(degrees[0])},
+                                           .FrontRight{units::make_unit<units::degree_t>(degrees[1])},
+                                           .RearRight{units::make_unit<units::degree_t>(degrees[2])},
+                                           .RearLeft{units::make_unit<units::degree_t>(degrees[3])}};
+  }
+
+  Record Encode(const uint64_t generation, const ArgosLib::SwerveModulePositions& positions) {
+    Record record{};
+    const auto degrees = ToArray(positions);
+    std::memcpy(record.data(), magic.data(), magic.size());
+    std::memcpy(record.data() + magic.size(), &version, sizeof(version));
+    std::memcpy(record.data() + generationOffset, &generation, sizeof(generation));
+    std::memcpy(record.data() + positionsOffset, degrees.data(), sizeof(degrees));
+    const uint32_t crc = Crc32(record.data(), crcOffset);
+    std::memcpy(record.data() + crcOffset, &crc, sizeof(crc));
+    return record;
+  }
+
+  struct Generation {
+    uint64_t generation;
+    ArgosLib::SwerveModulePositions positions;
+  };
+
+  /**
+   * @brief Read and check one slot
+   *
+   * @return Contents, or std::nullopt if the slot is missing.  Corrupt slots are reported and also return
+   *         std::nullopt
+   */
+  std::optional<Generation> ReadSlot(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return std::nullopt;
+    }
+    Record record;
+    file.read(reinterpret_cast<char*>(record.data()), record.size());
+    const bool complete = file.gcount() == static_cast<std::streamsize>(record.size()) && file.peek() == EOF;
+
+    uint16_t recordVersion = 0;
+    uint32_t crc = 0;
+    std::memcpy(&recordVersion, record.data() + magic.size(), sizeof(recordVersion));
+    std::memcpy(&crc, record.data() + crcOffset, sizeof(crc));
+    if (!complete || std::memcmp(record.data(), magic.data(), magic.size()) != 0 || recordVersion != version ||
+        crc != Crc32(record.data(), crcOffset)) {
+      std::cout << "[WARNING] Ignoring corrupt homing record " << path << '\n';
+      return std::nullopt;
+    }
+
+    Generation contents{};
+    std::array<double, 4> degrees;
+    std::memcpy(&contents.generation, record.data() + generationOffset, sizeof(contents.generation));
+    std::memcpy(degrees.data(), record.data() + positionsOffset, sizeof(degrees));
+    contents.positions = FromArray(degrees);
+    return contents;
+  }
+
+  /// @brief Four whitespace separated values as written before the binary format
+  std::optional<ArgosLib::SwerveModulePositions> ReadLegacy(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::array<double, 4> degrees;
+    if (!(file >> degrees[0] >> degrees[1] >> degrees[2] >> degrees[3])) {
+      return std::nullopt;
+    }
+    return FromArray(degrees);
+  }
+
+  /// @brief HOME, or the working directory if HOME is unset (e.g. under a systemd unit)
+  std::filesystem::path HomeDirectory() {
+    const char* home = getenv("HOME");
+    return std::filesystem::path{home ? home : "."};
+  }
+}  // namespace
+
+SwervePlatformHomingStorage::SwervePlatformHomingStorage()
+    : SwervePlatformHomingStorage(HomeDirectory() / ".config" / "Swerve-Platform") {}
+
+SwervePlatformHomingStorage::SwervePlatformHomingStorage(std::filesystem::path directory)
+    : m_directory{std::move(directory)}
+    , m_generation{std::nullopt}
+    , m_pending{std::nullopt}
+    , m_lastSaved{std::nullopt}
+    , m_stop{false}
+    , m_lastWriteFailed{false} {
+  m_ioThread = std::thread(&SwervePlatformHomingStorage::IoThread, this);
+}
+
+SwervePlatformHomingStorage::~SwervePlatformHomingStorage() {
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_ioThread.join();
+}
 
 bool SwervePlatformHomingStorage::Save(const ArgosLib::SwerveModulePositions& homePosition) {
-  try {
-    std::ofstream configFile(GetFilePath(), std::ios::out);
-    configFile << homePosition.FrontLeft.to<double>() << ' ' << homePosition.FrontRight.to<double>() << ' '
-               << homePosition.RearRight.to<double>() << ' ' << homePosition.RearLeft.to<double>();
-    configFile.close();
-    return true;
-  } catch (...) {
-    // Error accessing file
-    std::cout << "[ERROR] Could not write to config file\n";
-    return false;
+  {
+    std::scoped_lock lock(m_mutex);
+    m_pending = homePosition;
+    m_lastSaved = homePosition;
   }
+  m_wake.notify_one();
+  return true;
+}
+
+bool SwervePlatformHomingStorage::LastSaveFailed() const {
+  return m_lastWriteFailed.load();
 }
 
 std::optional<ArgosLib::SwerveModulePositions> SwervePlatformHomingStorage::Load() {
-  try {
-    std::ifstream configFile(GetFilePath(), std::ios::in);
-    double frontLeft, frontRight, rearRight, rearLeft;
-    configFile >> frontLeft >> frontRight >> rearRight >> rearLeft;
-    configFile.close();
+  {
+    std::scoped_lock lock(m_mutex);
+    if (m_lastSaved) {
+      return m_lastSaved;
+    }
+  }
 
-    return ArgosLib::SwerveModulePositions{.FrontLeft{units::make_unit<units::degree_t>(frontLeft)},
-                                           .FrontRight{units::make_unit<units::degree_t>(frontRight)},
-                                           .RearRight{units::make_unit<units::degree_t>(rearRight)},
-                                           .RearLeft{units::make_unit<units::degree_t>(rearLeft)}};
-  } catch (...) {
-    // Error accessing file
-    std::cout << "[ERROR] Could not read from config file\n";
-    return std::nullopt;
+  std::optional<Generation> newest;
+  for (std::size_t slot = 0; slot < generationCount; ++slot) {
+    const auto contents = ReadSlot(SlotPath(slot));
+    if (contents && (!newest || contents.value().generation > newest.value().generation)) {
+      newest = contents;
+    }
+  }
+  if (newest) {
+    return newest.value().positions;
+  }
+
+  const auto legacy = ReadLegacy(m_directory / fileName);
+  if (legacy) {
+    std::cout << "Using home positions from " << m_directory / fileName << '\n';
+  }
+  return legacy;
+}
+
+void SwervePlatformHomingStorage::IoThread() {
+  std::unique_lock lock(m_mutex);
+  while (true) {
+    m_wake.wait(lock, [this]() { return m_pending.has_value() || m_stop; });
+    if (m_pending) {
+      const auto homePosition = m_pending.value();
+      m_pending = std::nullopt;
+      lock.unlock();
+      const bool written = Write(homePosition);
+      m_lastWriteFailed.store(!written);
+      if (!written) {
+        std::cout << "[ERROR] Could not save home positions to " << m_directory << '\n';
+      }
+      lock.lock();
+    } else {
+      return;
+    }
   }
 }
 
-std::filesystem::path SwervePlatformHomingStorage::GetFilePath() {
-  static const std::filesystem::path homeDir{getenv("HOME")};
-  static const std::filesystem::path configFile{homeDir / ".config" / "Swerve-Platform" / "moduleHomes"};
+bool SwervePlatformHomingStorage::Write(const ArgosLib::SwerveModulePositions& homePosition) {
+  if (!m_generation) {
+    uint64_t newest = 0;
+    for (std::size_t slot = 0; slot < generationCount; ++slot) {
+      if (const auto contents = ReadSlot(SlotPath(slot)); contents) {
+        newest = std::max(newest, contents.value().generation);
+      }
+    }
+    m_generation = newest;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
 
-  // Create empty file if it doesn't exist yet
-  if (!std::filesystem::exists(configFile)) {
-    std::filesystem::create_directories(configFile.parent_path());
-    std::ofstream newFile(configFile);
-    newFile.close();
+  const uint64_t generation = m_generation.value() + 1;
+  const auto record = Encode(generation, homePosition);
+  if (!ArgosLib::ReplaceFileDurably(SlotPath(generation % generationCount), std::as_bytes(std::span{record}))) {
+    return false;
   }
+  m_generation = generation;
+  return true;
+}
 
-  return configFile;
+std::filesystem::path SwervePlatformHomingStorage::SlotPath(const std::size_t slot) const {
+  return m_directory / (std::string{fileName} + '.' + std::to_string(slot));
 }
@@ -5,14 +5,67 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <argosLib/general/swerveHomeStorage.h>
 
+/**
+ * @brief Module home positions kept in checksummed binary records.
+ *
+ * Each save is a new generation written to one of generationCount slot files in rotation, so the previous
+ * generations survive a crash or a bad sector.  Slots are replaced by writing a temporary file, syncing it and
+ * renaming it over the slot, so a slot is only ever complete or absent.  Writes happen on a background thread;
+ * Save() never touches the disk.  Load() takes the newest record whose size, version and CRC check out.
+ */
 class SwervePlatformHomingStorage : public ArgosLib::SwerveHomeStorageInterface {
  public:
-  virtual bool Save(const ArgosLib::SwerveModulePositions& homePosition) override;
-  virtual std::optional<ArgosLib::SwerveModulePositions> Load() override;
+  /// @brief Generations kept on disk
+  constexpr static std::size_t generationCount = 3;
+
+  /// @brief Store in ~/.config/Swerve-Platform
+  SwervePlatformHomingStorage();
+  explicit SwervePlatformHomingStorage(std::filesystem::path directory);
+  /// @brief Writes any queued save before returning
+  ~SwervePlatformHomingStorage() override;
+  SwervePlatformHomingStorage(const SwervePlatformHomingStorage&) = delete;
+  SwervePlatformHomingStorage& operator=(const SwervePlatformHomingStorage&) = delete;
+
+  /**
+   * @brief Queue positions for the I/O thread.  A save not yet written is replaced
+   *
+   * @return true once queued.  LastSaveFailed() reports whether the write succeeded
+   */
+  bool Save(const ArgosLib::SwerveModulePositions& homePosition) override;
+
+  /// @brief The I/O thread's most recent write failed.  Cleared by the next successful write
+  [[nodiscard]] bool LastSaveFailed() const override;
+
+  /**
+   * @brief Positions from the latest Save() in this process, otherwise the newest intact generation on disk.
+   *        Falls back to the text file written by earlier versions
+   */
+  std::optional<ArgosLib::SwerveModulePositions> Load() override;
 
  private:
-  std::filesystem::path GetFilePath();
+  void IoThread();
+  /// @brief Write the next generation.  I/O thread only
+  bool Write(const ArgosLib::SwerveModulePositions& homePosition);
+
+  [[nodiscard]] std::filesystem::path SlotPath(std::size_t slot) const;
+
+  const std::filesystem::path m_directory;
+  std::optional<uint64_t> m_generation;  ///< I/O thread only.  Newest generation on disk once scanned
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::optional<ArgosLib::SwerveModulePositions> m_pending;    ///< Guarded by m_mutex.  Next positions to write
+  std::optional<ArgosLib::SwerveModulePositions> m_lastSaved;  ///< Guarded by m_mutex
+  bool m_stop;                                                 ///< Guarded by m_mutex
+  std::atomic<bool> m_lastWriteFailed;
+  std::thread m_ioThread;
 };
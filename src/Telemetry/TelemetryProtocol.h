@@ -0,0 +1,218 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string_view>
+
+/**
+ * @brief UDP telemetry wire format.  Little endian throughout.
+ *
+ * Every packet starts with a Header.  A schema packet follows it with the sample period (u32 µs), the signal count
+ * (u16) and, per signal, its name and unit (u8 length then bytes) and resolution (f64).  Publishers repeat the schema
+ * periodically so receivers can join at any time.
+ *
+ * A frames packet follows the header with the publisher's dropped sample count (u32) and a frame count (u16), then
+ * the frames.  Each frame is the tick index and time (µs) as varints, then one zigzag varint per signal holding its
+ * value quantized to the signal's resolution.  The first frame of a packet holds absolute values and later frames
+ * the difference from the frame before, so slowly changing signals cost a byte and a lost packet loses only its own
+ * frames.
+ */
+namespace telemetryProtocol {
+  constexpr uint32_t magic = 0x4C545753;  ///< "SWTL"
+  constexpr uint8_t version = 1;
+  constexpr uint16_t defaultPort = 5800;
+  /// Fits a typical Ethernet or Wi-Fi MTU without fragmenting
+  constexpr std::size_t maxPacketSize = 1200;
+
+  enum class PacketType : uint8_t { kSchema = 1, kFrames = 2 };
+
+  struct Header {
+    PacketType type;
+    uint32_t session;   ///< Chosen by the publisher at start-up.  Frames decode only with the same session's schema
+    uint32_t sequence;  ///< Packets sent in the session before this one
+  };
+  constexpr std::size_t headerSize = 14;
+
+  /// Quantized value of a NaN, e.g. a signal not available on this platform
+  constexpr int64_t missing = std::numeric_limits<int64_t>::min() / 2;
+  /// Quantized values are clamped to this magnitude so differences cannot overflow
+  constexpr int64_t quantizedLimit = int64_t{1} << 53;
+
+  [[nodiscard]] inline int64_t Quantize(const double value, const double resolution) {
+    if (std::isnan(value)) {
+      return missing;
+    }
+    const double scaled = std::round(value / resolution);
+    if (scaled >= static_cast<double>(quantizedLimit)) {
+      return quantizedLimit;
+    }
+    if (scaled <= -static_cast<double>(quantizedLimit)) {
+      return -quantizedLimit;
+    }
+    return static_cast<int64_t>(scaled);
+  }
+
+  [[nodiscard]] inline double Dequantize(const int64_t quantized, const double resolution) {
+    if (quantized == missing) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    return static_cast<double>(quantized) * resolution;
+  }
+
+  /// @brief Bytes a varint can take
+  constexpr std::size_t maxVarintSize = 10;
+
+  /**
+   * @brief Appends to a fixed buffer.  Writes past the end are dropped and reported by Overflowed()
+   */
+  class Writer {
+   public:
+    explicit Writer(const std::span<uint8_t> buffer) : m_buffer{buffer}, m_size{0}, m_overflowed{false} {}
+
+    void U8(const uint8_t value) {
+      if (m_size < m_buffer.size()) {
+        m_buffer[m_size++] = value;
+      } else {
+        m_overflowed = true;
+      }
+    }
+    void U16(const uint16_t value) { Fixed(value, 2); }
+    void U32(const uint32_t value) { Fixed(value, 4); }
+    void F64(const double value) {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      Fixed(bits, 8);
+    }
+    void Varint(uint64_t value) {
+      while (value >= 0x80) {
+        U8(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+      }
+      U8(static_cast<uint8_t>(value));
+    }
+    void Zigzag(const int64_t value) {
+      Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+    /// @brief Length prefixed, truncated to 255 bytes
+    void String(std::string_view text) {
+      text = text.substr(0, 255);
+      U8(static_cast<uint8_t>(text.size()));
+      for (const char c : text) {
+        U8(static_cast<uint8_t>(c));
+      }
+    }
+    void WriteHeader(const Header& header) {
+      U32(magic);
+      U8(version);
+      U8(static_cast<uint8_t>(header.type));
+      U32(header.session);
+      U32(header.sequence);
+    }
+    /// @brief Overwrite a u16 written earlier, e.g. a count only known once the packet is full
+    void PatchU16(const std::size_t offset, const uint16_t value) {
+      if (offset + 2 <= m_size) {
+        m_buffer[offset] = static_cast<uint8_t>(value);
+        m_buffer[offset + 1] = static_cast<uint8_t>(value >> 8);
+      }
+    }
+
+    [[nodiscard]] std::size_t Size() const { return m_size; }
+    [[nodiscard]] std::size_t Remaining() const { return m_buffer.size() - m_size; }
+    [[nodiscard]] bool Overflowed() const { return m_overflowed; }
+
+   private:
+    void Fixed(const uint64_t value, const int bytes) {
+      for (int i = 0; i < bytes; ++i) {
+        U8(static_cast<uint8_t>(value >> (8 * i)));
+      }
+    }
+
+    std::span<uint8_t> m_buffer;
+    std::size_t m_size;
+    bool m_overflowed;
+  };
+
+  /**
+   * @brief Reads from a packet.  Reads past the end return 0 and are reported by Failed()
+   */
+  class Reader {
+   public:
+    explicit Reader(const std::span<const uint8_t> data) : m_data{data}, m_position{0}, m_failed{false} {}
+
+    uint8_t U8() {
+      if (m_position < m_data.size()) {
+        return m_data[m_position++];
+      }
+      m_failed = true;
+      return 0;
+    }
+    uint16_t U16() { return static_cast<uint16_t>(Fixed(2)); }
+    uint32_t U32() { return static_cast<uint32_t>(Fixed(4)); }
+    double F64() {
+      const uint64_t bits = Fixed(8);
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    uint64_t Varint() {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        const uint8_t byte = U8();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+          return value;
+        }
+      }
+      m_failed = true;
+      return 0;
+    }
+    int64_t Zigzag() {
+      const uint64_t value = Varint();
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+    std::string_view String() {
+      const std::size_t length = U8();
+      if (length > m_data.size() - m_position) {
+        m_failed = true;
+        return {};
+      }
+      const std::string_view text{reinterpret_cast<const char*>(m_data.data() + m_position), length};
+      m_position += length;
+      return text;
+    }
+    /// @return false if the packet is not telemetry of this version
+    bool ReadHeader(Header& header) {
+      if (U32() != magic || U8() != version) {
+        return false;
+      }
+      header.type = static_cast<PacketType>(U8());
+      header.session = U32();
+      header.sequence = U32();
+      return !m_failed;
+    }
+
+    [[nodiscard]] bool Failed() const { return m_failed; }
+
+   private:
+    uint64_t Fixed(const int bytes) {
+      uint64_t value = 0;
+      for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(U8()) << (8 * i);
+      }
+      return value;
+    }
+
+    std::span<const uint8_t> m_data;
+    std::size_t m_position;
+    bool m_failed;
+  };
+}  // namespace telemetryProtocol
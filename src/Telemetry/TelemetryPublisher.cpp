@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TelemetryPublisher.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "argosLib/general/asyncLog.h"
+
+namespace {
+  using namespace telemetryProtocol;
+
+  /// Dropped sample count and frame count
+  constexpr std::size_t framesPreambleSize = headerSize + 4 + 2;
+
+  /// @brief Worst case frame: tick, time and every signal as full length varints
+  constexpr std::size_t MaxFrameSize(const std::size_t signalCount) {
+    return (2 + signalCount) * maxVarintSize;
+  }
+
+  uint64_t Microseconds(const TelemetryPublisher::TimePoint time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+  }
+}  // namespace
+
+std::unique_ptr<TelemetryPublisher> TelemetryPublisher::Create(const std::span<const Signal> signals,
+                                                               const Settings& settings) {
+  std::size_t schemaSize = framesPreambleSize + 4;
+  for (const auto& signal : signals) {
+    schemaSize += 2 + std::min<std::size_t>(std::strlen(signal.name), 255) +
+                  std::min<std::size_t>(std::strlen(signal.unit), 255) + sizeof(double);
+  }
+  if (signals.empty() || signals.size() > UINT16_MAX || schemaSize > maxPacketSize ||
+      framesPreambleSize + MaxFrameSize(signals.size()) > maxPacketSize || !(settings.sampleRate > 0) ||
+      settings.queueCapacity == 0) {
+    return nullptr;
+  }
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(settings.host.c_str(), std::to_string(settings.port).c_str(), &hints, &addresses) != 0 ||
+      !addresses) {
+    return nullptr;
+  }
+  const auto* address = reinterpret_cast<const std::byte*>(addresses->ai_addr);
+  std::vector<std::byte> destination{address, address + addresses->ai_addrlen};
+  const int family = addresses->ai_family;
+  freeaddrinfo(addresses);
+
+  const int socketFd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    return nullptr;
+  }
+  // Allow a broadcast address so every laptop on the subnet can watch
+  const int enable = 1;
+  setsockopt(socketFd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+  return std::unique_ptr<TelemetryPublisher>{
+      new TelemetryPublisher(signals, settings, socketFd, std::move(destination))};
+}
+
+TelemetryPublisher::TelemetryPublisher(const std::span<const Signal> signals,
+                                       const Settings& settings,
+                                       const int socket,
+                                       std::vector<std::byte> destination)
+    : m_signals{signals.begin(), signals.end()}
+    , m_settings{settings}
+    , m_samplePeriod{std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>{1.0 / settings.sampleRate})}
+    , m_socket{socket}
+    , m_destination{std::move(destination)}
+    // Distinguishes restarts, so receivers wait for the new schema instead of misreading frames
+    , m_session{static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                (static_cast<uint32_t>(getpid()) << 16)}
+    , m_headers(settings.queueCapacity)
+    , m_values(settings.queueCapacity * signals.size())
+    , m_head{0}
+    , m_tail{0}
+    , m_dropped{0}
+    , m_nextSample{}
+    , m_packet{}
+    , m_previous(signals.size())
+    , m_sequence{0}
+    , m_stop{false} {
+  m_senderThread = std::thread(&TelemetryPublisher::SenderThread, this);
+}
+
+TelemetryPublisher::~TelemetryPublisher() {
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_senderThread.join();
+  close(m_socket);
+}
+
+bool TelemetryPublisher::Publish(const uint64_t tick, const TimePoint time, const std::span<const double> values) {
+  if (values.size() != m_signals.size()) {
+    return false;
+  }
+  // Take samples up to a quarter period early so loop jitter doesn't skip every other one
+  if (time + m_samplePeriod / 4 < m_nextSample) {
+    return true;
+  }
+  m_nextSample = m_nextSample + m_samplePeriod < time ? time + m_samplePeriod : m_nextSample + m_samplePeriod;
+
+  const auto head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) >= m_settings.queueCapacity) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const auto slot = head % m_settings.queueCapacity;
+  m_headers[slot] = SampleHeader{.tick = tick, .time = time};
+  std::copy(values.begin(), values.end(), m_values.begin() + slot * m_signals.size());
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+void TelemetryPublisher::SenderThread() {
+  // Lowest priority; the control loop always comes first
+  sched_param param{};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+  auto nextSchema = std::chrono::steady_clock::now();
+  std::unique_lock lock(m_mutex);
+  while (true) {
+    const bool stopping = m_wake.wait_for(lock, m_settings.batchPeriod, [this]() { return m_stop; });
+    lock.unlock();
+
+    if (const auto now = std::chrono::steady_clock::now(); now >= nextSchema) {
+      SendSchema();
+      nextSchema = now + m_settings.schemaPeriod;
+    }
+    SendFrames();
+
+    if (stopping) {
+      return;
+    }
+    lock.lock();
+  }
+}
+
+void TelemetryPublisher::SendSchema() {
+  Writer writer{m_packet};
+  writer.WriteHeader(Header{.type = PacketType::kSchema, .session = m_session, .sequence = m_sequence});
+  writer.U32(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(m_samplePeriod).count()));
+  writer.U16(static_cast<uint16_t>(m_signals.size()));
+  for (const auto& signal : m_signals) {
+    writer.String(signal.name);
+    writer.String(signal.unit);
+    writer.F64(signal.resolution);
+  }
+  Send(writer);
+}
+
+void TelemetryPublisher::SendFrames() {
+  const auto head = m_head.load(std::memory_order_acquire);
+  auto tail = m_tail.load(std::memory_order_relaxed);
+  if (tail == head) {
+    return;
+  }
+
+  Writer writer{m_packet};
+  auto countOffset = BeginFrames(writer);
+  uint16_t frameCount = 0;
+  SampleHeader previous{};
+  for (; tail != head; ++tail) {
+    if (writer.Remaining() < MaxFrameSize(m_signals.size())) {
+      writer.PatchU16(countOffset, frameCount);
+      Send(writer);
+      writer = Writer{m_packet};
+      countOffset = BeginFrames(writer);
+      frameCount = 0;
+    }
+
+    const auto slot = tail % m_settings.queueCapacity;
+    const auto& sample = m_headers[slot];
+    if (frameCount == 0) {
+      // Absolute values, so the packet decodes on its own
+      writer.Varint(sample.tick);
+      writer.Varint(Microseconds(sample.time));
+      std::fill(m_previous.begin(), m_previous.end(), 0);
+    } else {
+      writer.Zigzag(static_cast<int64_t>(sample.tick - previous.tick));
+      writer.Zigzag(static_cast<int64_t>(Microseconds(sample.time) - Microseconds(previous.time)));
+    }
+    const double* values = &m_values[slot * m_signals.size()];
+    for (std::size_t i = 0; i < m_signals.size(); ++i) {
+      const auto quantized = Quantize(values[i], m_signals[i].resolution);
+      writer.Zigzag(quantized - m_previous[i]);
+      m_previous[i] = quantized;
+    }
+    previous = sample;
+    ++frameCount;
+  }
+  m_tail.store(tail, std::memory_order_release);
+
+  writer.PatchU16(countOffset, frameCount);
+  Send(writer);
+}
+
+std::size_t TelemetryPublisher::BeginFrames(Writer& writer) {
+  writer.WriteHeader(Header{.type = PacketType::kFrames, .session = m_session, .sequence = m_sequence});
+  writer.U32(m_dropped.load(std::memory_order_relaxed));
+  const auto countOffset = writer.Size();
+  writer.U16(0);
+  return countOffset;
+}
+
+void TelemetryPublisher::Send(const Writer& writer) {
+  // Counted even if the send fails, so receivers see the gap
+  ++m_sequence;
+  if (sendto(m_socket,
+             m_packet.data(),
+             writer.Size(),
+             MSG_DONTWAIT | MSG_NOSIGNAL,
+             reinterpret_cast<const sockaddr*>(m_destination.data()),
+             static_cast<socklen_t>(m_destination.size())) < 0) {
+    ARGOS_LOG_EVERY(std::chrono::seconds{1}, ArgosLib::LogLevel::kWarning, "Telemetry send failed (errno {})", errno);
+  }
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TelemetryProtocol.h"
+
+/**
+ * @brief Streams selected signals over UDP for live viewing, e.g. with TelemetryReceiver.
+ *
+ * Publish() is called from the control loop.  It decimates to the sample rate and copies the sample into a
+ * single-producer, single-consumer ring, never blocking, allocating or making a system call.  A sender thread at
+ * idle priority drains the ring every batch period and sends the samples as delta-encoded frames (see
+ * telemetryProtocol), repeating the schema every schema period.  Samples published while the ring is full are
+ * dropped and counted; a slow or absent receiver never affects the loop.
+ */
+class TelemetryPublisher {
+ public:
+  struct Signal {
+    const char* name;
+    const char* unit;
+    double resolution;  ///< Values are sent as multiples of this
+  };
+
+  struct Settings {
+    std::string host;  ///< Name or address of the receiver.  A broadcast address reaches every receiver on the subnet
+    uint16_t port;
+    double sampleRate;                       ///< Samples per second sent.  Publish() drops the rest
+    std::chrono::milliseconds batchPeriod;   ///< How often queued samples are sent
+    std::chrono::milliseconds schemaPeriod;  ///< How often the schema is repeated
+    std::size_t queueCapacity;               ///< Samples buffered between the control loop and the sender
+  };
+
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  /**
+   * @brief Resolve the receiver, open the socket and start the sender thread
+   *
+   * @param signals Names, units and resolutions in the order Publish() receives values
+   * @return nullptr if the host does not resolve, the socket cannot be opened or a frame could not fit a packet
+   */
+  [[nodiscard]] static std::unique_ptr<TelemetryPublisher> Create(std::span<const Signal> signals,
+                                                                  const Settings& settings);
+
+  /// @brief Sends everything already queued before returning
+  ~TelemetryPublisher();
+  TelemetryPublisher(const TelemetryPublisher&) = delete;
+  TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+  /**
+   * @brief Queue a sample if one is due.  Call from one thread only
+   *
+   * @param tick Control loop iteration
+   * @param time Sample time
+   * @param values One per signal.  NaN marks a value that is not available
+   * @return false if values is the wrong size or the sample was dropped because the queue is full
+   */
+  bool Publish(uint64_t tick, TimePoint time, std::span<const double> values);
+
+ private:
+  struct SampleHeader {
+    uint64_t tick;
+    TimePoint time;
+  };
+
+  TelemetryPublisher(std::span<const Signal> signals,
+                     const Settings& settings,
+                     int socket,
+                     std::vector<std::byte> destination);
+
+  void SenderThread();
+  void SendSchema();
+  /// @brief Send every queued sample, in as many packets as needed
+  void SendFrames();
+  /// @brief Start a frames packet and return the offset of its frame count
+  std::size_t BeginFrames(telemetryProtocol::Writer& writer);
+  void Send(const telemetryProtocol::Writer& writer);
+
+  const std::vector<Signal> m_signals;
+  const Settings m_settings;
+  const std::chrono::nanoseconds m_samplePeriod;
+  const int m_socket;
+  const std::vector<std::byte> m_destination;  ///< sockaddr of the receiver
+  const uint32_t m_session;
+
+  // Ring of samples.  Values for sample i are at m_values[(i % capacity) * signal count]
+  std::vector<SampleHeader> m_headers;
+  std::vector<double> m_values;
+  alignas(64) std::atomic<uint64_t> m_head;  ///< Next sample to write.  Control thread only
+  alignas(64) std::atomic<uint64_t> m_tail;  ///< Next sample to send.  Sender thread only
+  std::atomic<uint32_t> m_dropped;           ///< Samples lost to a full ring
+  TimePoint m_nextSample;                    ///< Control thread only
+
+  // Sender thread only
+  std::array<uint8_t, telemetryProtocol::maxPacketSize> m_packet;
+  std::vector<int64_t> m_previous;  ///< Quantized values of the last frame in the packet being built
+  uint32_t m_sequence;              ///< Packets sent
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop;  ///< Guarded by m_mutex
+  std::thread m_senderThread;
+};
@@ -0,0 +1,291 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @file Receives TelemetryPublisher packets and shows each signal's latest value beside a text plot of its recent
+///       history, redrawn a few times a second.  With --raw every frame is printed as a CSV line instead, which
+///       suits logging to a file or checking a loopback run.
+///
+///       Usage: TelemetryReceiver [port] [--raw]
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TelemetryProtocol.h"
+
+namespace {
+  using namespace telemetryProtocol;
+
+  /// Samples shown in each plot
+  constexpr std::size_t plotWidth = 60;
+  constexpr auto redrawPeriod = std::chrono::milliseconds{250};
+  constexpr std::array<const char*, 8> plotLevels{"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+
+  volatile std::sig_atomic_t stopRequested = 0;
+
+  struct SignalInfo {
+    std::string name;
+    std::string unit;
+    double resolution;
+  };
+
+  struct Schema {
+    uint32_t session;
+    uint32_t samplePeriodUs;
+    std::vector<SignalInfo> signals;
+  };
+
+  struct Statistics {
+    uint64_t packets{0};
+    uint64_t frames{0};
+    uint64_t lostPackets{0};          ///< Gaps in packet sequence numbers
+    uint64_t framesWithoutSchema{0};  ///< Frames discarded while waiting for the schema
+    uint32_t publisherDropped{0};     ///< Samples the publisher could not queue
+    std::optional<uint32_t> lastSequence;
+  };
+
+  class Receiver {
+   public:
+    explicit Receiver(const bool raw) : m_raw{raw} {}
+
+    void HandlePacket(const std::span<const uint8_t> packet) {
+      Reader reader{packet};
+      Header header{};
+      if (!reader.ReadHeader(header)) {
+        return;
+      }
+      ++m_statistics.packets;
+      if (m_schema && header.session == m_schema->session && m_statistics.lastSequence &&
+          header.sequence > m_statistics.lastSequence.value() + 1) {
+        m_statistics.lostPackets += header.sequence - m_statistics.lastSequence.value() - 1;
+      }
+      m_statistics.lastSequence = header.sequence;
+
+      if (header.type == PacketType::kSchema) {
+        HandleSchema(header, reader);
+      } else if (header.type == PacketType::kFrames) {
+        HandleFrames(header, reader);
+      }
+    }
+
+    void Draw() const {
+      std::string screen = "\x1b[H\x1b[2J";
+      if (!m_schema) {
+        screen += "Waiting for schema (" + std::to_string(m_statistics.packets) + " packets received)\n";
+        std::cout << screen << std::flush;
+        return;
+      }
+      char line[256];
+      std::snprintf(line,
+                    sizeof(line),
+                    "Session %08x  tick %llu  %.0f Hz  packets %llu  lost %llu  dropped at source %u\n\n",
+                    m_schema->session,
+                    static_cast<unsigned long long>(m_lastTick),
+                    m_schema->samplePeriodUs > 0 ? 1e6 / m_schema->samplePeriodUs : 0.0,
+                    static_cast<unsigned long long>(m_statistics.packets),
+                    static_cast<unsigned long long>(m_statistics.lostPackets),
+                    m_statistics.publisherDropped);
+      screen += line;
+      for (std::size_t i = 0; i < m_schema->signals.size(); ++i) {
+        const auto& signal = m_schema->signals[i];
+        const auto& history = m_history[i];
+        const double latest = history.empty() ? std::nan("") : history.back();
+        std::snprintf(line, sizeof(line), "%-22s %11.4g %-6s ", signal.name.c_str(), latest, signal.unit.c_str());
+        screen += line;
+        screen += Plot(history);
+        screen += '\n';
+      }
+      std::cout << screen << std::flush;
+    }
+
+   private:
+    void HandleSchema(const Header& header, Reader& reader) {
+      Schema schema{.session = header.session, .samplePeriodUs = reader.U32(), .signals{}};
+      const auto count = reader.U16();
+      for (uint16_t i = 0; i < count; ++i) {
+        SignalInfo signal;
+        signal.name = reader.String();
+        signal.unit = reader.String();
+        signal.resolution = reader.F64();
+        schema.signals.push_back(std::move(signal));
+      }
+      if (reader.Failed()) {
+        return;
+      }
+      const bool changed = !m_schema || m_schema->session != schema.session;
+      m_schema = std::move(schema);
+      if (changed) {
+        m_history.assign(m_schema->signals.size(), {});
+        if (m_raw) {
+          std::string csvHeader = "tick,time";
+          for (const auto& signal : m_schema->signals) {
+            csvHeader += ',' + signal.name;
+          }
+          std::cout << csvHeader << '\n';
+        }
+      }
+    }
+
+    void HandleFrames(const Header& header, Reader& reader) {
+      m_statistics.publisherDropped = reader.U32();
+      const auto frameCount = reader.U16();
+      if (!m_schema || header.session != m_schema->session) {
+        m_statistics.framesWithoutSchema += frameCount;
+        return;
+      }
+      const auto signalCount = m_schema->signals.size();
+      std::vector<int64_t> quantized(signalCount, 0);
+      uint64_t tick = 0;
+      uint64_t time = 0;
+      for (uint16_t frame = 0; frame < frameCount; ++frame) {
+        if (frame == 0) {
+          tick = reader.Varint();
+          time = reader.Varint();
+        } else {
+          tick += reader.Zigzag();
+          time += reader.Zigzag();
+        }
+        for (auto& value : quantized) {
+          value += reader.Zigzag();
+        }
+        if (reader.Failed()) {
+          return;
+        }
+
+        ++m_statistics.frames;
+        m_lastTick = tick;
+        std::string row;
+        if (m_raw) {
+          row = std::to_string(tick) + ',' + std::to_string(time);
+        }
+        for (std::size_t i = 0; i < signalCount; ++i) {
+          const double value = Dequantize(quantized[i], m_schema->signals[i].resolution);
+          auto& history = m_history[i];
+          history.push_back(value);
+          if (history.size() > plotWidth) {
+            history.pop_front();
+          }
+          if (m_raw) {
+            char text[32];
+            std::snprintf(text, sizeof(text), ",%.10g", value);
+            row += text;
+          }
+        }
+        if (m_raw) {
+          std::cout << row << '\n';
+        }
+      }
+      if (m_raw) {
+        std::cout << std::flush;
+      }
+    }
+
+    /// @brief Sparkline scaled to the history's range, with the range after it
+    static std::string Plot(const std::deque<double>& history) {
+      double low = INFINITY;
+      double high = -INFINITY;
+      for (const double value : history) {
+        if (!std::isnan(value)) {
+          low = std::min(low, value);
+          high = std::max(high, value);
+        }
+      }
+      std::string plot;
+      for (const double value : history) {
+        if (std::isnan(value)) {
+          plot += ' ';
+        } else if (high > low) {
+          const auto level = static_cast<std::size_t>((value - low) / (high - low) * (plotLevels.size() - 1) + 0.5);
+          plot += plotLevels[std::min(level, plotLevels.size() - 1)];
+        } else {
+          plot += plotLevels[0];
+        }
+      }
+      plot.append(plotWidth - history.size(), ' ');
+      if (low <= high) {
+        char range[64];
+        std::snprintf(range, sizeof(range), "  [%.4g, %.4g]", low, high);
+        plot += range;
+      }
+      return plot;
+    }
+
+    const bool m_raw;
+    std::optional<Schema> m_schema;
+    std::vector<std::deque<double>> m_history;  ///< Recent values per signal
+    uint64_t m_lastTick{0};
+    Statistics m_statistics;
+  };
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint16_t port = defaultPort;
+  bool raw = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string_view{argv[i]} == "--raw") {
+      raw = true;
+    } else if (const int value = std::atoi(argv[i]); value > 0 && value <= UINT16_MAX) {
+      port = static_cast<uint16_t>(value);
+    } else {
+      std::cerr << "Usage: TelemetryReceiver [port] [--raw]\n";
+      return 2;
+    }
+  }
+
+  // IPv6 socket that also accepts IPv4, so either kind of publisher address works
+  const int socketFd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    std::cerr << "Could not open socket: " << std::strerror(errno) << '\n';
+    return 1;
+  }
+  const int v6Only = 0;
+  setsockopt(socketFd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only));
+  sockaddr_in6 address{};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  if (bind(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    std::cerr << "Could not listen on port " << port << ": " << std::strerror(errno) << '\n';
+    close(socketFd);
+    return 1;
+  }
+  std::signal(SIGINT, [](int) { stopRequested = 1; });
+  std::signal(SIGTERM, [](int) { stopRequested = 1; });
+
+  Receiver receiver{raw};
+  std::array<uint8_t, 65536> packet;
+  auto nextDraw = std::chrono::steady_clock::now();
+  while (!stopRequested) {
+    pollfd descriptor{.fd = socketFd, .events = POLLIN, .revents = 0};
+    if (poll(&descriptor, 1, static_cast<int>(redrawPeriod.count())) > 0) {
+      const auto received = recv(socketFd, packet.data(), packet.size(), 0);
+      if (received > 0) {
+        receiver.HandlePacket(std::span<const uint8_t>{packet.data(), static_cast<std::size_t>(received)});
+      }
+    }
+    if (const auto now = std::chrono::steady_clock::now(); !raw && now >= nextDraw) {
+      receiver.Draw();
+      nextDraw = now + redrawPeriod;
+    }
+  }
+  close(socketFd);
+  return 0;
+}
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ControllerInterface.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+  using AxisStates = ControllerInterface::AxisStates;
+
+  /// Names in Button order
+  constexpr std::array<const char*, ControllerInterface::buttonCount> buttonNames{"A",
+                                                                                  "B",
+                                                                                  "X",
+                                                                                  "Y",
+                                                                                  "LB",
+                                                                                  "RB",
+                                                                                  "Back",
+                                                                                  "Start",
+                                                                                  "XBox",
+                                                                                  "StickLeft",
+                                                                                  "StickRight",
+                                                                                  "LT",
+                                                                                  "RT",
+                                                                                  "DUp",
+                                                                                  "DRight",
+                                                                                  "DDown",
+                                                                                  "DLeft"};
+  /// Order of PackedControllerState::axes
+  constexpr std::array<double AxisStates::*, 6> axisFields{&AxisStates::LeftX,
+                                                           &AxisStates::LeftY,
+                                                           &AxisStates::LT,
+                                                           &AxisStates::RT,
+                                                           &AxisStates::RightX,
+                                                           &AxisStates::RightY};
+  constexpr double axisScale = std::numeric_limits<int16_t>::max();
+}  // namespace
+
+ControllerInterface::PackedControllerState ControllerInterface::ControllerState::Pack() const {
+  PackedControllerState packed{.buttons = Buttons.mask, .axes{}};
+  for (std::size_t i = 0; i < axisFields.size(); ++i) {
+    packed.axes[i] = static_cast<int16_t>(std::lround(std::clamp(Axes.*axisFields[i], -1.0, 1.0) * axisScale));
+  }
+  return packed;
+}
+
+ControllerInterface::ControllerState ControllerInterface::ControllerState::Unpack(const PackedControllerState& packed) {
+  ControllerState state{.Buttons{.mask = packed.buttons}, .Axes{}};
+  for (std::size_t i = 0; i < axisFields.size(); ++i) {
+    state.Axes.*axisFields[i] = packed.axes[i] / axisScale;
+  }
+  return state;
+}
+
+void ControllerInterface::SetVibration(double leftPercent,
+                                       double rightPercent,
+                                       std::optional<std::chrono::steady_clock::time_point> endTime) {
+  if (!endTime) {
+    SetVibration(ArgosLib::VibrationConstant(leftPercent, rightPercent));
+  } else {
+    SetVibration(ArgosLib::VibrationConstant(leftPercent, rightPercent).Until(endTime.value()));
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::ButtonStates buttons) {
+  os << "{";
+  for (std::size_t i = 0; i < buttonNames.size(); ++i) {
+    os << ' ' << buttonNames[i] << ": " << buttons.Held(static_cast<ControllerInterface::Button>(i));
+  }
+  os << " }";
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::AxisStates axes) {
+  os << "{";
+  os << " LeftX:" << axes.LeftX;
+  os << " LeftY:" << axes.LeftY;
+  os << " LT:" << axes.LT;
+  os << " RT:" << axes.RT;
+  os << " RightX:" << axes.RightX;
+  os << " RightY:" << axes.RightY;
+  os << " }";
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::ControllerState state) {
+  os << "{ Buttons: " << state.Buttons << ", Axes: " << state.Axes << " }";
+  return os;
+}
@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <argosLib/controller/Vibration.h>
+
+/**
+ * @brief Source of driver input.  Implemented by the live XBoxController and by recorded input replays
+ */
+class ControllerInterface {
+ public:
+  /// @brief Bit positions in ButtonStates::mask.  Recordings use the same order, so only append
+  enum class Button : uint8_t {
+    kA,
+    kB,
+    kX,
+    kY,
+    kLB,
+    kRB,
+    kBack,
+    kStart,
+    kXBox,
+    kStickLeft,
+    kStickRight,
+    kLT,  ///< Left trigger past triggerPressedThreshold
+    kRT,  ///< Right trigger past triggerPressedThreshold
+    kDUp,
+    kDRight,
+    kDDown,
+    kDLeft
+  };
+  constexpr static std::size_t buttonCount = 17;
+  /// Trigger travel past which Button::kLT and Button::kRT are held.  Every backend applies the same threshold
+  constexpr static double triggerPressedThreshold = 0.5;
+
+  /// @brief Held buttons, one bit per Button
+  struct ButtonStates {
+    uint32_t mask;
+
+    [[nodiscard]] constexpr static uint32_t Bit(Button button) { return 1U << static_cast<unsigned>(button); }
+    [[nodiscard]] constexpr bool Held(Button button) const { return (mask & Bit(button)) != 0; }
+    constexpr void Set(Button button, bool held) { mask = held ? mask | Bit(button) : mask & ~Bit(button); }
+  };
+
+  /**
+   * @brief Button transitions between consecutive ticks.  Call Update() once per tick, then query any number of
+   *        buttons without further comparisons
+   */
+  class ButtonEdges {
+   public:
+    void Update(ButtonStates buttons) {
+      const uint32_t changed = buttons.mask ^ m_held;
+      m_pressed = changed & buttons.mask;
+      m_released = changed & m_held;
+      m_held = buttons.mask;
+    }
+
+    /// @brief Went down this tick
+    [[nodiscard]] bool Pressed(Button button) const { return (m_pressed & ButtonStates::Bit(button)) != 0; }
+    /// @brief Went up this tick
+    [[nodiscard]] bool Released(Button button) const { return (m_released & ButtonStates::Bit(button)) != 0; }
+    /// @brief Down this tick, whether or not it just went down
+    [[nodiscard]] bool Held(Button button) const { return (m_held & ButtonStates::Bit(button)) != 0; }
+
+   private:
+    uint32_t m_held{0};
+    uint32_t m_pressed{0};
+    uint32_t m_released{0};
+  };
+
+  /// @brief Sticks from -1 to 1, positive right and forward.  Triggers from 0 released to 1 fully pulled
+  struct AxisStates {
+    double LeftX;
+    double LeftY;
+    double LT;
+    double RT;
+    double RightX;
+    double RightY;
+  };
+
+  /**
+   * @brief Fixed 16 byte encoding of ControllerState for logs and IPC.  Axes are quantized to 1/32767 of full scale
+   *        (SDL's resolution) in AxisStates order.  Host byte order
+   */
+  struct PackedControllerState {
+    uint32_t buttons;
+    std::array<int16_t, 6> axes;
+  };
+  static_assert(sizeof(PackedControllerState) == 16, "Packed state layout is fixed");
+
+  struct ControllerState {
+    ButtonStates Buttons;
+    AxisStates Axes;
+
+    [[nodiscard]] PackedControllerState Pack() const;
+    [[nodiscard]] static ControllerState Unpack(const PackedControllerState& packed);
+  };
+
+  /**
+   * @brief Controller state as published by the input source
+   */
+  struct Snapshot {
+    ControllerState state;
+    std::chrono::steady_clock::time_point eventTime;  ///< When the most recent input event was received
+    bool connected;
+  };
+
+  virtual ~ControllerInterface() = default;
+
+  /**
+   * @brief Latest controller state.  Never blocks
+   *
+   * @return State, or std::nullopt if no controller is connected
+   */
+  [[nodiscard]] virtual std::optional<ControllerState> CurrentState() const = 0;
+
+  /// @brief Latest published snapshot, including when it last changed
+  [[nodiscard]] virtual Snapshot LatestSnapshot() const = 0;
+
+  /**
+   * @brief Replace the rumble pattern.  Call from one thread only
+   */
+  virtual void SetVibration(ArgosLib::VibrationModel newModel) = 0;
+
+  /**
+   * @brief Constant rumble, optionally switching off at endTime, e.g. the current tick's time plus a duration
+   */
+  void SetVibration(double leftPercent,
+                    double rightPercent,
+                    std::optional<std::chrono::steady_clock::time_point> endTime = std::nullopt);
+};
+
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::ButtonStates buttons);
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::AxisStates axes);
+std::ostream& operator<<(std::ostream& os, const ControllerInterface::ControllerState state);
@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ControllerRecording.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+  constexpr std::array<char, 4> magic{'X', 'B', 'C', 'R'};
+  constexpr uint8_t version = 1;
+  /// Buffered records are written once this much has accumulated
+  constexpr std::size_t flushSize = 4096;
+
+  constexpr uint8_t buttonsChanged = 1U << 0;
+  constexpr uint8_t firstAxisChanged = 1U << 1;
+  constexpr uint8_t connectionChanged = 1U << 7;
+
+  void AppendVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+    while (value >= 0x80) {
+      buffer.push_back(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+  }
+
+  /**
+   * @brief Decode a varint
+   *
+   * @param position Advanced past the varint
+   * @return Value or std::nullopt if truncated or too long
+   */
+  std::optional<uint64_t> ReadVarint(const std::vector<uint8_t>& data, std::size_t& position) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64 && position < data.size(); shift += 7) {
+      const uint8_t byte = data[position++];
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+
+  uint64_t ZigzagEncode(const int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+  }
+
+  int64_t ZigzagDecode(const uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+}  // namespace
+
+std::unique_ptr<ControllerRecorder> ControllerRecorder::Create(const std::filesystem::path& recordingFile) {
+  std::ofstream file(recordingFile, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return nullptr;
+  }
+  file.write(magic.data(), magic.size());
+  file.put(static_cast<char>(version));
+  if (!file) {
+    return nullptr;
+  }
+  return std::unique_ptr<ControllerRecorder>(new ControllerRecorder(std::move(file)));
+}
+
+ControllerRecorder::ControllerRecorder(std::ofstream file)
+    : m_file{std::move(file)}
+    , m_buffer{}
+    , m_lastTime{std::chrono::steady_clock::now()}
+    , m_buttons{0}
+    , m_axes{}
+    , m_connected{false}
+    , m_finished{false} {
+  m_buffer.reserve(2 * flushSize);
+}
+
+ControllerRecorder::~ControllerRecorder() {
+  if (!m_finished) {
+    Finish(std::chrono::steady_clock::now());
+  }
+}
+
+void ControllerRecorder::Record(const std::chrono::steady_clock::time_point time,
+                                const std::optional<ControllerState>& state) {
+  if (m_finished) {
+    return;
+  }
+
+  uint8_t flags = 0;
+  if (state.has_value() != m_connected) {
+    flags |= connectionChanged;
+  }
+  // Values are held across a disconnection so the next connection records only what differs
+  uint32_t buttons = m_buttons;
+  auto axes = m_axes;
+  if (state) {
+    const auto packed = state.value().Pack();
+    buttons = packed.buttons;
+    axes = packed.axes;
+    if (buttons != m_buttons) {
+      flags |= buttonsChanged;
+    }
+    for (std::size_t i = 0; i < axes.size(); ++i) {
+      if (axes[i] != m_axes[i]) {
+        flags |= firstAxisChanged << i;
+      }
+    }
+  }
+  if (flags == 0) {
+    return;
+  }
+
+  AppendTime(time);
+  m_buffer.push_back(flags);
+  if (flags & buttonsChanged) {
+    AppendVarint(m_buffer, buttons ^ m_buttons);
+  }
+  for (std::size_t i = 0; i < axes.size(); ++i) {
+    if (flags & (firstAxisChanged << i)) {
+      AppendVarint(m_buffer, ZigzagEncode(axes[i] - m_axes[i]));
+    }
+  }
+  m_buttons = buttons;
+  m_axes = axes;
+  m_connected = state.has_value();
+
+  if (m_buffer.size() >= flushSize) {
+    Flush();
+  }
+}
+
+void ControllerRecorder::Finish(const std::chrono::steady_clock::time_point time) {
+  if (m_finished) {
+    return;
+  }
+  AppendTime(time);
+  m_buffer.push_back(0);
+  Flush();
+  m_file.flush();
+  m_finished = true;
+}
+
+void ControllerRecorder::AppendTime(const std::chrono::steady_clock::time_point time) {
+  const auto delta = std::max(std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastTime),
+                              std::chrono::microseconds{0});
+  AppendVarint(m_buffer, static_cast<uint64_t>(delta.count()));
+  // Advance by the rounded delta so rounding errors do not accumulate
+  m_lastTime += delta;
+}
+
+void ControllerRecorder::Flush() {
+  m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+  m_buffer.clear();
+}
+
+std::optional<ControllerPlayback> ControllerPlayback::Load(const std::filesystem::path& recordingFile) {
+  std::ifstream file(recordingFile, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  if (data.size() < magic.size() + 1 || !std::equal(magic.begin(), magic.end(), data.begin()) ||
+      data[magic.size()] != version) {
+    return std::nullopt;
+  }
+
+  ControllerPlayback playback(std::move(data));
+  // Decode everything once up front so a bad file is rejected before replay starts
+  ControllerPlayback check = playback;
+  while (!check.Finished()) {
+    if (!check.Step()) {
+      return std::nullopt;
+    }
+  }
+  playback.m_duration = check.m_time;
+  return playback;
+}
+
+ControllerPlayback::ControllerPlayback(std::vector<uint8_t> data)
+    : m_data{std::move(data)}
+    , m_position{magic.size() + 1}
+    , m_time{0}
+    , m_duration{0}
+    , m_state{std::nullopt}
+    , m_buttons{0}
+    , m_axes{} {}
+
+void ControllerPlayback::AdvanceTo(const std::chrono::microseconds elapsed) {
+  while (!Finished()) {
+    const auto nextTime = NextTime();
+    if (!nextTime || nextTime.value() > elapsed) {
+      return;
+    }
+    Step();
+  }
+}
+
+std::optional<std::chrono::microseconds> ControllerPlayback::NextTime() const {
+  std::size_t position = m_position;
+  const auto delta = ReadVarint(m_data, position);
+  if (!delta) {
+    return std::nullopt;
+  }
+  return m_time + std::chrono::microseconds{delta.value()};
+}
+
+bool ControllerPlayback::Step() {
+  std::size_t position = m_position;
+  const auto delta = ReadVarint(m_data, position);
+  if (!delta || position >= m_data.size()) {
+    return false;
+  }
+  const uint8_t flags = m_data[position++];
+
+  uint32_t buttons = m_buttons;
+  if (flags & buttonsChanged) {
+    const auto change = ReadVarint(m_data, position);
+    if (!change || change.value() >= (1ULL << ControllerInterface::buttonCount)) {
+      return false;
+    }
+    buttons ^= static_cast<uint32_t>(change.value());
+  }
+  auto axes = m_axes;
+  for (std::size_t i = 0; i < axes.size(); ++i) {
+    if (flags & (firstAxisChanged << i)) {
+      const auto change = ReadVarint(m_data, position);
+      if (!change) {
+        return false;
+      }
+      const int64_t value = axes[i] + ZigzagDecode(change.value());
+      if (value < std::numeric_limits<int16_t>::min() || value > std::numeric_limits<int16_t>::max()) {
+        return false;
+      }
+      axes[i] = static_cast<int16_t>(value);
+    }
+  }
+
+  m_position = position;
+  m_time += std::chrono::microseconds{delta.value()};
+  m_buttons = buttons;
+  m_axes = axes;
+  const bool connected = m_state.has_value() != static_cast<bool>(flags & connectionChanged);
+  if (connected) {
+    m_state = ControllerState::Unpack({.buttons = m_buttons, .axes = m_axes});
+  } else {
+    m_state = std::nullopt;
+  }
+  return true;
+}
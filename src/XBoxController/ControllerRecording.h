@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/// @file Controller input recordings.
+///
+///       A recording is a 4 byte magic ("XBCR") and a version byte followed by one record per change:
+///         - time since the previous record, or the start of recording, in microseconds (unsigned LEB128 varint)
+///         - change flags: bit 0 buttons, bits 1-6 axes in AxisStates order, bit 7 connection toggled
+///         - if buttons changed, the XOR of the old and new button bitfields (varint, Button order)
+///         - for each changed axis, the difference from its previous int16 value (zigzag varint)
+///       A record with no flags marks the end of the session.  Buttons and axes are those of
+///       ControllerState::Pack(), so a steady stick costs nothing and a typical change is 3-5 bytes.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "ControllerInterface.h"
+
+/**
+ * @brief Writes controller state changes to a recording file.  Not thread safe
+ */
+class ControllerRecorder {
+ public:
+  using ControllerState = ControllerInterface::ControllerState;
+
+  /**
+   * @return Recorder or nullptr if the file cannot be created
+   */
+  [[nodiscard]] static std::unique_ptr<ControllerRecorder> Create(const std::filesystem::path& recordingFile);
+
+  /// @brief Finishes the recording if Finish() was not called
+  ~ControllerRecorder();
+  ControllerRecorder(const ControllerRecorder&) = delete;
+  ControllerRecorder& operator=(const ControllerRecorder&) = delete;
+
+  /**
+   * @brief Append a record if the state or connection differs from the last one recorded
+   *
+   * @param time When the change happened.  Times before the previous record or the recorder's creation are recorded
+   *             as simultaneous with it
+   * @param state New state, std::nullopt while disconnected
+   */
+  void Record(std::chrono::steady_clock::time_point time, const std::optional<ControllerState>& state);
+
+  /**
+   * @brief Write the end of session marker and flush.  Further records are ignored
+   */
+  void Finish(std::chrono::steady_clock::time_point time);
+
+ private:
+  explicit ControllerRecorder(std::ofstream file);
+
+  void AppendTime(std::chrono::steady_clock::time_point time);
+  void Flush();
+
+  std::ofstream m_file;
+  std::vector<uint8_t> m_buffer;                     ///< Encoded records not yet written
+  std::chrono::steady_clock::time_point m_lastTime;  ///< Time of the last record, or creation
+  uint32_t m_buttons;                                ///< Last recorded button mask
+  std::array<int16_t, 6> m_axes;                     ///< Last recorded packed axes
+  bool m_connected;
+  bool m_finished;
+};
+
+/**
+ * @brief Decodes a recording incrementally.  The whole file is validated and held in memory on load
+ */
+class ControllerPlayback {
+ public:
+  using ControllerState = ControllerInterface::ControllerState;
+
+  /**
+   * @return Playback or std::nullopt if the file cannot be read or is corrupt
+   */
+  [[nodiscard]] static std::optional<ControllerPlayback> Load(const std::filesystem::path& recordingFile);
+
+  /**
+   * @brief Apply every record up to a time
+   *
+   * @param elapsed Time since the start of the recording
+   */
+  void AdvanceTo(std::chrono::microseconds elapsed);
+
+  /// @brief State after the records applied so far, std::nullopt while disconnected
+  [[nodiscard]] const std::optional<ControllerState>& State() const { return m_state; }
+
+  /// @brief Time of the last applied record since the start of the recording
+  [[nodiscard]] std::chrono::microseconds ChangeTime() const { return m_time; }
+
+  /// @brief Length of the recorded session
+  [[nodiscard]] std::chrono::microseconds Duration() const { return m_duration; }
+
+  /// @brief Every record has been applied
+  [[nodiscard]] bool Finished() const { return m_position == m_data.size(); }
+
+ private:
+  explicit ControllerPlayback(std::vector<uint8_t> data);
+
+  /// @brief Time of the record at m_position, std::nullopt if it is malformed
+  [[nodiscard]] std::optional<std::chrono::microseconds> NextTime() const;
+  /// @brief Apply the record at m_position
+  /// @return false if the record is malformed
+  bool Step();
+
+  std::vector<uint8_t> m_data;
+  std::size_t m_position;            ///< Offset of the next record
+  std::chrono::microseconds m_time;  ///< Time of the last applied record
+  std::chrono::microseconds m_duration;
+  std::optional<ControllerState> m_state;
+  uint32_t m_buttons;             ///< Button mask, kept while disconnected
+  std::array<int16_t, 6> m_axes;  ///< Packed axes, kept while disconnected
+};
+
+/**
+ * @brief Controller input replayed from a recording, timed against Clock from the first query.
+ *
+ * Replaying against std::chrono::steady_clock reproduces the session in real time.  Replaying against a simulated
+ * clock that only advances with the control loop (hardware::SimulatedClock) delivers every change on the same loop
+ * iteration each run, as fast as the loop can execute, so whole-stack runs are repeatable.  Vibration is ignored.
+ * Not thread safe.
+ *
+ * @tparam Clock Clock the consumer's loop runs on
+ */
+template <class Clock = std::chrono::steady_clock>
+class ControllerReplay : public ControllerInterface {
+ public:
+  explicit ControllerReplay(ControllerPlayback playback) : m_playback{std::move(playback)} {}
+
+  [[nodiscard]] std::optional<ControllerState> CurrentState() const override {
+    Advance();
+    return m_playback.State();
+  }
+
+  /// @brief Event times are the recorded offsets from the wall time replay started
+  [[nodiscard]] Snapshot LatestSnapshot() const override {
+    Advance();
+    const auto state = m_playback.State();
+    return Snapshot{.state = state.value_or(ControllerState{}),
+                    .eventTime = m_steadyStart.value() + m_playback.ChangeTime(),
+                    .connected = state.has_value()};
+  }
+
+  using ControllerInterface::SetVibration;
+  void SetVibration(ArgosLib::VibrationModel) override {}
+
+  /// @brief The recorded session has ended
+  [[nodiscard]] bool Finished() const {
+    Advance();
+    return m_playback.Finished();
+  }
+
+ private:
+  void Advance() const {
+    const auto now = Clock::now();
+    if (!m_start) {
+      m_start = now;
+      m_steadyStart = std::chrono::steady_clock::now();
+    }
+    m_playback.AdvanceTo(std::chrono::duration_cast<std::chrono::microseconds>(now - m_start.value()));
+  }
+
+  mutable ControllerPlayback m_playback;
+  mutable std::optional<typename Clock::time_point> m_start;
+  mutable std::optional<std::chrono::steady_clock::time_point> m_steadyStart;
+};
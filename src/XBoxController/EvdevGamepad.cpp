@@ -0,0 +1,330 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "EvdevGamepad.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <filesystem>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "argosLib/general/asyncLog.h"
+
+namespace {
+  constexpr uint16_t microsoftVendorId = 0x045e;
+
+  constexpr std::size_t bitsPerWord = sizeof(unsigned long) * CHAR_BIT;
+  template <std::size_t Bits>
+  using BitArray = std::array<unsigned long, (Bits + bitsPerWord - 1) / bitsPerWord>;
+
+  template <std::size_t Bits>
+  bool TestBit(const BitArray<Bits>& bits, const std::size_t bit) {
+    return (bits[bit / bitsPerWord] >> (bit % bitsPerWord)) & 1;
+  }
+
+  /// @return Capability bits of one event type, all clear on error
+  template <std::size_t Bits>
+  BitArray<Bits> GetCapabilities(const int fd, const int eventType) {
+    BitArray<Bits> bits{};
+    if (ioctl(fd, EVIOCGBIT(eventType, sizeof(bits)), bits.data()) < 0) {
+      bits.fill(0);
+    }
+    return bits;
+  }
+
+  bool IsXBoxController(const int fd) {
+    input_id id;
+    if (ioctl(fd, EVIOCGID, &id) < 0 || id.vendor != microsoftVendorId) {
+      return false;
+    }
+    const auto keys = GetCapabilities<KEY_CNT>(fd, EV_KEY);
+    const auto axes = GetCapabilities<ABS_CNT>(fd, EV_ABS);
+    return TestBit<KEY_CNT>(keys, BTN_A) && TestBit<ABS_CNT>(axes, ABS_X) && TestBit<ABS_CNT>(axes, ABS_Y);
+  }
+
+  using Button = XBoxController::Button;
+
+  struct ButtonCode {
+    uint16_t code;
+    Button button;
+  };
+
+  constexpr std::array buttonCodes{ButtonCode{BTN_A, Button::kA},
+                                   ButtonCode{BTN_B, Button::kB},
+                                   ButtonCode{BTN_X, Button::kX},
+                                   ButtonCode{BTN_Y, Button::kY},
+                                   ButtonCode{BTN_TL, Button::kLB},
+                                   ButtonCode{BTN_TR, Button::kRB},
+                                   ButtonCode{BTN_SELECT, Button::kBack},
+                                   ButtonCode{BTN_START, Button::kStart},
+                                   ButtonCode{BTN_MODE, Button::kXBox},
+                                   ButtonCode{BTN_THUMBL, Button::kStickLeft},
+                                   ButtonCode{BTN_THUMBR, Button::kStickRight},
+                                   ButtonCode{BTN_DPAD_UP, Button::kDUp},
+                                   ButtonCode{BTN_DPAD_DOWN, Button::kDDown},
+                                   ButtonCode{BTN_DPAD_LEFT, Button::kDLeft},
+                                   ButtonCode{BTN_DPAD_RIGHT, Button::kDRight},
+                                   // xpad reports the D-pad this way when loaded with dpad_to_buttons
+                                   ButtonCode{BTN_TRIGGER_HAPPY1, Button::kDLeft},
+                                   ButtonCode{BTN_TRIGGER_HAPPY2, Button::kDRight},
+                                   ButtonCode{BTN_TRIGGER_HAPPY3, Button::kDUp},
+                                   ButtonCode{BTN_TRIGGER_HAPPY4, Button::kDDown}};
+}  // namespace
+
+std::unique_ptr<EvdevGamepad> EvdevGamepad::Open(const int index) {
+  std::vector<std::pair<int, std::filesystem::path>> nodes;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator("/dev/input", error)) {
+    const auto name = entry.path().filename().string();
+    int number;
+    if (name.starts_with("event") &&
+        std::from_chars(name.data() + 5, name.data() + name.size(), number).ec == std::errc{}) {
+      nodes.emplace_back(number, entry.path());
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+
+  int matches = 0;
+  for (const auto& [number, path] : nodes) {
+    // Rumble needs write access, but input alone is still worth having
+    bool writable = true;
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+      writable = false;
+      fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (fd < 0) {
+      continue;
+    }
+    if (!IsXBoxController(fd) || matches++ != index) {
+      close(fd);
+      continue;
+    }
+    return std::unique_ptr<EvdevGamepad>(new EvdevGamepad(fd, path.string(), writable));
+  }
+  return nullptr;
+}
+
+EvdevGamepad::EvdevGamepad(const int fd, std::string path, const bool writable)
+    : m_fd{fd}
+    , m_path{std::move(path)}
+    , m_axisSupported{}
+    , m_axisRanges{}
+    , m_hidLayout{false}
+    , m_rumbleSupported{false}
+    , m_effectId{-1}
+    , m_pending{}
+    , m_dropped{false} {
+  // Stamp events with the clock steady_clock uses
+  int clock = CLOCK_MONOTONIC;
+  if (ioctl(m_fd, EVIOCSCLOCKID, &clock) < 0) {
+    std::cout << "[WARNING] Could not select monotonic event timestamps for " << m_path << '\n';
+  }
+
+  const auto axes = GetCapabilities<ABS_CNT>(m_fd, EV_ABS);
+  for (uint16_t code = 0; code < ABS_CNT; ++code) {
+    input_absinfo info;
+    if (TestBit<ABS_CNT>(axes, code) && ioctl(m_fd, EVIOCGABS(code), &info) >= 0) {
+      m_axisSupported[code] = true;
+      m_axisRanges[code] = AxisRange{.minimum = info.minimum, .maximum = info.maximum};
+    }
+  }
+  m_hidLayout = m_axisSupported[ABS_GAS] && m_axisSupported[ABS_BRAKE];
+  m_rumbleSupported = writable && TestBit<FF_CNT>(GetCapabilities<FF_CNT>(m_fd, EV_FF), FF_RUMBLE);
+
+  std::array<char, 256> name{};
+  if (ioctl(m_fd, EVIOCGNAME(name.size() - 1), name.data()) < 0) {
+    name.fill(0);
+  }
+  std::cout << "Connected to '" << name.data() << "' at " << m_path << (m_rumbleSupported ? "" : " without rumble")
+            << '\n';
+
+  Resync();
+}
+
+EvdevGamepad::~EvdevGamepad() {
+  if (m_effectId >= 0) {
+    ioctl(m_fd, EVIOCRMFF, m_effectId);
+  }
+  close(m_fd);
+}
+
+bool EvdevGamepad::ReadEvents(ControllerState& state, std::chrono::steady_clock::time_point& eventTime) {
+  std::array<input_event, 64> events;
+  while (true) {
+    const ssize_t nBytes = read(m_fd, events.data(), sizeof(events));
+    if (nBytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // ENODEV once the controller is unplugged
+      return errno == EAGAIN;
+    }
+    if (nBytes == 0) {
+      return false;
+    }
+
+    const std::size_t count = static_cast<std::size_t>(nBytes) / sizeof(input_event);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto& event = events[i];
+      if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+        m_dropped = true;
+      } else if (event.type == EV_SYN && event.code == SYN_REPORT) {
+        if (m_dropped) {
+          Resync();
+          m_dropped = false;
+        }
+        state = m_pending;
+        eventTime = std::chrono::steady_clock::time_point{std::chrono::seconds{event.input_event_sec} +
+                                                          std::chrono::microseconds{event.input_event_usec}};
+      } else if (m_dropped) {
+        // Partial report, replaced by Resync()
+      } else if (event.type == EV_KEY) {
+        ApplyKey(event.code, event.value != 0);
+      } else if (event.type == EV_ABS) {
+        ApplyAxis(event.code, event.value);
+      }
+    }
+    if (count < events.size()) {
+      return true;
+    }
+  }
+}
+
+void EvdevGamepad::Rumble(const double left, const double right) {
+  if (!m_rumbleSupported) {
+    return;
+  }
+  ff_effect effect{};
+  effect.type = FF_RUMBLE;
+  effect.id = m_effectId;
+  // Longest the kernel allows; updates restart it
+  effect.replay.length = std::numeric_limits<uint16_t>::max();
+  effect.u.rumble.strong_magnitude =
+      static_cast<uint16_t>(std::clamp(left, 0.0, 1.0) * std::numeric_limits<uint16_t>::max());
+  effect.u.rumble.weak_magnitude =
+      static_cast<uint16_t>(std::clamp(right, 0.0, 1.0) * std::numeric_limits<uint16_t>::max());
+  if (ioctl(m_fd, EVIOCSFF, &effect) < 0) {
+    ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Rumble upload failed, disabling rumble");
+    m_rumbleSupported = false;
+    return;
+  }
+  if (m_effectId < 0) {
+    m_effectId = effect.id;
+    input_event play{};
+    play.type = EV_FF;
+    play.code = static_cast<uint16_t>(m_effectId);
+    play.value = 1;
+    if (write(m_fd, &play, sizeof(play)) != sizeof(play)) {
+      ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Rumble start failed");
+    }
+  }
+}
+
+void EvdevGamepad::ApplyKey(const uint16_t code, const bool pressed) {
+  for (const auto& [buttonCode, button] : buttonCodes) {
+    if (buttonCode == code) {
+      m_pending.Buttons.Set(button, pressed);
+    }
+  }
+}
+
+void EvdevGamepad::ApplyAxis(const uint16_t code, const int32_t value) {
+  auto& axes = m_pending.Axes;
+  auto& buttons = m_pending.Buttons;
+  const auto setLeftTrigger = [&]() {
+    axes.LT = Trigger(code, value);
+    buttons.Set(Button::kLT, axes.LT > XBoxController::triggerPressedThreshold);
+  };
+  const auto setRightTrigger = [&]() {
+    axes.RT = Trigger(code, value);
+    buttons.Set(Button::kRT, axes.RT > XBoxController::triggerPressedThreshold);
+  };
+
+  // evdev reports Y axes positive down.  Negate them so pushing a stick forward is positive, matching the SDL backend
+  switch (code) {
+    case ABS_X:
+      axes.LeftX = Stick(code, value);
+      break;
+    case ABS_Y:
+      axes.LeftY = -Stick(code, value);
+      break;
+    case ABS_RX:
+      axes.RightX = Stick(code, value);
+      break;
+    case ABS_RY:
+      axes.RightY = -Stick(code, value);
+      break;
+    case ABS_Z:
+      if (m_hidLayout) {
+        axes.RightX = Stick(code, value);
+      } else {
+        setLeftTrigger();
+      }
+      break;
+    case ABS_RZ:
+      if (m_hidLayout) {
+        axes.RightY = -Stick(code, value);
+      } else {
+        setRightTrigger();
+      }
+      break;
+    case ABS_BRAKE:
+      setLeftTrigger();
+      break;
+    case ABS_GAS:
+      setRightTrigger();
+      break;
+    case ABS_HAT0X:
+      buttons.Set(Button::kDLeft, value < 0);
+      buttons.Set(Button::kDRight, value > 0);
+      break;
+    case ABS_HAT0Y:
+      buttons.Set(Button::kDUp, value < 0);
+      buttons.Set(Button::kDDown, value > 0);
+      break;
+  }
+}
+
+void EvdevGamepad::Resync() {
+  m_pending = ControllerState{};
+
+  BitArray<KEY_CNT> keys{};
+  if (ioctl(m_fd, EVIOCGKEY(sizeof(keys)), keys.data()) >= 0) {
+    for (const auto& [code, button] : buttonCodes) {
+      m_pending.Buttons.Set(button, m_pending.Buttons.Held(button) || TestBit<KEY_CNT>(keys, code));
+    }
+  }
+  for (uint16_t code = 0; code < ABS_CNT; ++code) {
+    input_absinfo info;
+    if (m_axisSupported[code] && ioctl(m_fd, EVIOCGABS(code), &info) >= 0) {
+      ApplyAxis(code, info.value);
+    }
+  }
+}
+
+double EvdevGamepad::Stick(const uint16_t code, const int32_t value) const {
+  const auto& range = m_axisRanges[code];
+  if (range.maximum <= range.minimum) {
+    return 0;
+  }
+  return std::clamp(2.0 * (value - range.minimum) / (range.maximum - range.minimum) - 1.0, -1.0, 1.0);
+}
+
+double EvdevGamepad::Trigger(const uint16_t code, const int32_t value) const {
+  const auto& range = m_axisRanges[code];
+  if (range.maximum <= range.minimum) {
+    return 0;
+  }
+  return std::clamp(static_cast<double>(value - range.minimum) / (range.maximum - range.minimum), 0.0, 1.0);
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <linux/input.h>
+
+#include "XBoxController.h"
+
+/**
+ * @brief Xbox controller read straight from its /dev/input/event* node.
+ *
+ * Bypasses SDL's joystick layer and mapping database.  Events are read in batches and applied a whole report
+ * (SYN_REPORT) at a time, stamped with the kernel's CLOCK_MONOTONIC event time so they compare directly with
+ * std::chrono::steady_clock.  Buttons follow the xpad driver's codes.  Works with any device presenting Microsoft's
+ * vendor ID, including a uinput virtual device.
+ */
+class EvdevGamepad {
+ public:
+  using ControllerState = XBoxController::ControllerState;
+
+  /**
+   * @brief Open the index'th Xbox controller, counting event nodes in numeric order
+   *
+   * @return Gamepad or nullptr if none is present or it cannot be opened
+   */
+  [[nodiscard]] static std::unique_ptr<EvdevGamepad> Open(int index);
+
+  ~EvdevGamepad();
+  EvdevGamepad(const EvdevGamepad&) = delete;
+  EvdevGamepad& operator=(const EvdevGamepad&) = delete;
+
+  /// @brief Descriptor that becomes readable when events arrive
+  [[nodiscard]] int FileDescriptor() const { return m_fd; }
+
+  [[nodiscard]] const std::string& Path() const { return m_path; }
+
+  /**
+   * @brief Read every pending event
+   *
+   * @param state Updated with each complete report
+   * @param eventTime Set to the kernel time of the last complete report
+   * @return false if the device is gone
+   */
+  bool ReadEvents(ControllerState& state, std::chrono::steady_clock::time_point& eventTime);
+
+  /**
+   * @brief Set rumble intensity with force feedback.  Does nothing if the device has no rumble
+   *
+   * @param left Heavy (low frequency) motor, 0-1
+   * @param right Light (high frequency) motor, 0-1
+   */
+  void Rumble(double left, double right);
+
+ private:
+  /// @brief Raw range of one absolute axis
+  struct AxisRange {
+    int32_t minimum{-32768};
+    int32_t maximum{32767};
+  };
+
+  EvdevGamepad(int fd, std::string path, bool writable);
+
+  void ApplyKey(uint16_t code, bool pressed);
+  void ApplyAxis(uint16_t code, int32_t value);
+  /// @brief Rebuild the pending report from the device's current state, e.g. after the kernel dropped events
+  void Resync();
+  [[nodiscard]] double Stick(uint16_t code, int32_t value) const;
+  [[nodiscard]] double Trigger(uint16_t code, int32_t value) const;
+
+  const int m_fd;
+  const std::string m_path;
+  std::array<bool, ABS_CNT> m_axisSupported;
+  std::array<AxisRange, ABS_CNT> m_axisRanges;
+  bool m_hidLayout;        ///< Bluetooth (hid-microsoft) layout: right stick on Z/RZ, triggers on BRAKE/GAS
+  bool m_rumbleSupported;  ///< Device advertises FF_RUMBLE
+  int16_t m_effectId;      ///< Uploaded rumble effect, -1 until the first upload
+  ControllerState m_pending;
+  bool m_dropped;  ///< Kernel buffer overflowed; discard events until the next report, then resync
+};
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @copyright Copyright (c) 2021, David K Turner. All rights reserved.
+/// @license This project is released under the BSD 3-Clause License
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @file Creates a virtual Xbox controller with uinput so the evdev backend can be exercised without hardware.
+///       Presses A once a second, sweeps the left stick and prints rumble requests.  Needs write access to
+///       /dev/uinput.
+///
+///       Usage: VirtualXBoxController [seconds]
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+  constexpr std::array buttons{BTN_A,
+                               BTN_B,
+                               BTN_X,
+                               BTN_Y,
+                               BTN_TL,
+                               BTN_TR,
+                               BTN_SELECT,
+                               BTN_START,
+                               BTN_MODE,
+                               BTN_THUMBL,
+                               BTN_THUMBR};
+  constexpr std::array sticks{ABS_X, ABS_Y, ABS_RX, ABS_RY};
+  constexpr std::array triggers{ABS_Z, ABS_RZ};
+  constexpr std::array hats{ABS_HAT0X, ABS_HAT0Y};
+
+  void Emit(const int fd, const uint16_t type, const uint16_t code, const int32_t value) {
+    input_event event{};
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    if (write(fd, &event, sizeof(event)) != sizeof(event)) {
+      std::cerr << "Event write failed\n";
+    }
+  }
+
+  void SetupAxis(const int fd, const uint16_t code, const int32_t minimum, const int32_t maximum) {
+    uinput_abs_setup setup{};
+    setup.code = code;
+    setup.absinfo.minimum = minimum;
+    setup.absinfo.maximum = maximum;
+    ioctl(fd, UI_SET_ABSBIT, code);
+    ioctl(fd, UI_ABS_SETUP, &setup);
+  }
+
+  /// @brief Answer force feedback requests from the driver side
+  void HandleForceFeedback(const int fd) {
+    input_event event;
+    while (read(fd, &event, sizeof(event)) == sizeof(event)) {
+      if (event.type == EV_UINPUT && event.code == UI_FF_UPLOAD) {
+        uinput_ff_upload upload{};
+        upload.request_id = event.value;
+        ioctl(fd, UI_BEGIN_FF_UPLOAD, &upload);
+        std::cout << "Rumble strong: " << upload.effect.u.rumble.strong_magnitude
+                  << " weak: " << upload.effect.u.rumble.weak_magnitude << '\n';
+        upload.retval = 0;
+        ioctl(fd, UI_END_FF_UPLOAD, &upload);
+      } else if (event.type == EV_UINPUT && event.code == UI_FF_ERASE) {
+        uinput_ff_erase erase{};
+        erase.request_id = event.value;
+        ioctl(fd, UI_BEGIN_FF_ERASE, &erase);
+        erase.retval = 0;
+        ioctl(fd, UI_END_FF_ERASE, &erase);
+      } else if (event.type == EV_FF) {
+        std::cout << "Rumble effect " << event.code << (event.value ? " playing\n" : " stopped\n");
+      }
+    }
+  }
+}  // namespace
+
+int main(int argc, char** argv) {
+  const double duration = argc > 1 ? std::atof(argv[1]) : 10.0;
+
+  const int fd = open("/dev/uinput", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "Cannot open /dev/uinput: " << std::strerror(errno) << '\n';
+    return 1;
+  }
+
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  for (const auto button : buttons) {
+    ioctl(fd, UI_SET_KEYBIT, button);
+  }
+  ioctl(fd, UI_SET_EVBIT, EV_ABS);
+  for (const auto stick : sticks) {
+    SetupAxis(fd, stick, -32768, 32767);
+  }
+  for (const auto trigger : triggers) {
+    SetupAxis(fd, trigger, 0, 1023);
+  }
+  for (const auto hat : hats) {
+    SetupAxis(fd, hat, -1, 1);
+  }
+  ioctl(fd, UI_SET_EVBIT, EV_FF);
+  ioctl(fd, UI_SET_FFBIT, FF_RUMBLE);
+
+  // Same IDs as a wired Xbox One controller so the evdev backend and SDL both accept it
+  uinput_setup setup{};
+  setup.id.bustype = BUS_USB;
+  setup.id.vendor = 0x045e;
+  setup.id.product = 0x02ea;
+  setup.ff_effects_max = 1;
+  std::strncpy(setup.name, "Virtual Xbox Controller", UINPUT_MAX_NAME_SIZE - 1);
+  if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+    std::cerr << "Cannot create virtual controller: " << std::strerror(errno) << '\n';
+    close(fd);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto nextReport = start;
+  while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < duration) {
+    const double elapsed = std::chrono::duration<double>(nextReport - start).count();
+    Emit(fd, EV_KEY, BTN_A, std::fmod(elapsed, 1.0) < 0.5);
+    Emit(fd, EV_ABS, ABS_X, static_cast<int32_t>(32767 * std::sin(elapsed)));
+    Emit(fd, EV_SYN, SYN_REPORT, 0);
+    HandleForceFeedback(fd);
+
+    nextReport += std::chrono::milliseconds(4);
+    std::this_thread::sleep_until(nextReport);
+  }
+
+  ioctl(fd, UI_DEV_DESTROY);
+  close(fd);
+  return 0;
+}
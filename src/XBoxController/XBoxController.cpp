@@ -5,42 +5,116 @@
 
 #include "XBoxController.h"
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <stdio.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
-XBoxController::XBoxController(int index)
-    : m_index{index}, m_pJoystick{nullptr}, m_latestState{}, m_vibrationModel{ArgosLib::VibrationOff()} {
-  Initialize();
-}
+#include "EvdevGamepad.h"
+#include "argosLib/general/asyncLog.h"
 
-XBoxController::~XBoxController() {
-  Deinitialize();
-  SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
-  SDL_Quit();
-}
+namespace {
+  using Button = XBoxController::Button;
+  /// Button for each SDL_GameControllerButton, in SDL's order.  Later SDL buttons have no Xbox equivalent
+  constexpr std::array<Button, SDL_CONTROLLER_BUTTON_DPAD_RIGHT + 1> sdlButtons{Button::kA,
+                                                                                Button::kB,
+                                                                                Button::kX,
+                                                                                Button::kY,
+                                                                                Button::kBack,
+                                                                                Button::kXBox,
+                                                                                Button::kStart,
+                                                                                Button::kStickLeft,
+                                                                                Button::kStickRight,
+                                                                                Button::kLB,
+                                                                                Button::kRB,
+                                                                                Button::kDUp,
+                                                                                Button::kDDown,
+                                                                                Button::kDLeft,
+                                                                                Button::kDRight};
+
+  /// Rescan interval when /dev/input cannot be watched
+  constexpr std::chrono::milliseconds fallbackScanInterval{1000};
+  /// Delay from a /dev/input change to the rescan, so udev can finish creating and granting access to the nodes
+  constexpr std::chrono::milliseconds hotplugSettleTime{100};
 
-XBoxController::XBoxController(XBoxController&& other)
-    : m_index(other.m_index), m_pJoystick(other.m_pJoystick), m_vibrationModel{other.m_vibrationModel} {
-  other.m_pJoystick = nullptr;
+  /**
+   * @brief Watch /dev/input for joystick nodes appearing or becoming readable
+   *
+   * @return Non-blocking inotify descriptor or -1 if unavailable
+   */
+  int OpenInputWatch() {
+    const int inputWatch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inputWatch < 0) {
+      return -1;
+    }
+    // udev creates nodes before making them accessible, so attribute changes matter as much as creation
+    if (inotify_add_watch(inputWatch, "/dev/input", IN_CREATE | IN_MOVED_TO | IN_ATTRIB) < 0) {
+      close(inputWatch);
+      return -1;
+    }
+    return inputWatch;
+  }
+
+  /**
+   * @brief Drain pending inotify events
+   *
+   * @return true if anything in /dev/input changed
+   */
+  bool ReadInputWatchEvents(const int inputWatch) {
+    bool changed = false;
+    alignas(inotify_event) std::array<char, 4096> buffer;
+    while (read(inputWatch, buffer.data(), buffer.size()) > 0) {
+      changed = true;
+    }
+    return changed;
+  }
+}  // namespace
+
+XBoxController::XBoxController(int index, Backend backend)
+    : m_index{index}
+    , m_backend{backend}
+    , m_pJoystick{nullptr}
+    , m_pEvdevGamepad{nullptr}
+    , m_latestState{}
+    , m_sentRumble{std::nullopt}
+    , m_sentRumbleTime{}
+    , m_pRecorder{nullptr}
+    , m_snapshot{Snapshot{.state{}, .eventTime{std::chrono::steady_clock::now()}, .connected = false}}
+    , m_vibrationModel{ArgosLib::VibrationOff()}
+    , m_stop{false}
+    , m_stopEvent{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+  m_inputThread = std::thread(&XBoxController::InputThread, this);
 }
 
-XBoxController& XBoxController::operator=(XBoxController&& other) {
-  Deinitialize();
-  new (this) XBoxController(std::move(other));
-  return *this;
+XBoxController::~XBoxController() {
+  m_stop = true;
+  const uint64_t wake = 1;
+  if (write(m_stopEvent, &wake, sizeof(wake)) != sizeof(wake)) {
+    std::cerr << "Could not wake controller input thread\n";
+  }
+  m_inputThread.join();
+  close(m_stopEvent);
 }
 
 bool XBoxController::Initialize() {
   // Close joystick if it was open already
   if (m_pJoystick) {
     SDL_GameControllerClose(m_pJoystick);
+    m_pJoystick = nullptr;
   }
+  m_pEvdevGamepad = nullptr;
 
-  // Restart SDL
-  SDL_SetHint(SDL_HINT_NO_SIGNAL_HANDLERS, "1");  //so Ctrl-C still works
-  if (SDL_WasInit(SDL_INIT_GAMECONTROLLER) != 0) {
-    SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
+  if (m_backend == Backend::kEvdev) {
+    m_pEvdevGamepad = EvdevGamepad::Open(m_index);
+    if (m_pEvdevGamepad) {
+      return true;
+    }
+    std::cout << "No accessible XBox controller event device, trying SDL\n";
   }
-  SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER);
 
   // Fail if desired index is unavailable
   const int numJoysticks = SDL_NumJoysticks();
@@ -99,6 +173,8 @@ bool XBoxController::Initialize() {
 
 void XBoxController::Deinitialize() {
   m_latestState = ControllerState();
+  m_sentRumble = std::nullopt;
+  m_pEvdevGamepad = nullptr;
   if (m_pJoystick) {
     SDL_GameControllerEventState(SDL_DISABLE);
     SDL_GameControllerClose(m_pJoystick);
@@ -106,250 +182,218 @@ void XBoxController::Deinitialize() {
   }
 }
 
-std::optional<XBoxController::ControllerState> XBoxController::CurrentState() {
-  SDL_JoystickUpdate();
+std::optional<XBoxController::ControllerState> XBoxController::CurrentState() const {
+  const auto snapshot = m_snapshot.Load();
+  if (!snapshot.connected) {
+    return std::nullopt;
+  }
+  return snapshot.state;
+}
 
-  // Try getting controller if it was lost
-  if (m_pJoystick == nullptr) {
-    Initialize();
+XBoxController::Snapshot XBoxController::LatestSnapshot() const {
+  return m_snapshot.Load();
+}
+
+bool XBoxController::StartRecording(const std::filesystem::path& recordingFile) {
+  auto pRecorder = ControllerRecorder::Create(recordingFile);
+  if (!pRecorder) {
+    return false;
   }
+  std::lock_guard<std::mutex> lock(m_recorderMutex);
+  m_pRecorder = std::move(pRecorder);
+  return true;
+}
 
-  if (m_pJoystick != nullptr) {
-    if (!SDL_GameControllerGetAttached(m_pJoystick)) {
-      std::cout << "Game controller gone\n";
+void XBoxController::Rescan() {
+  // Restarting makes SDL enumerate /dev/input from scratch.  Its own change detection compares the directory's mtime
+  // in whole seconds, so it can miss a node created alongside another or made readable after it was first seen
+  SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
+  SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER);
+  Initialize();
+}
+
+void XBoxController::InputThread() {
+  auto eventTime = std::chrono::steady_clock::now();
+
+  // SDL stays initialized for the life of the thread.  Reconnecting only rescans when devices change
+  SDL_SetHint(SDL_HINT_NO_SIGNAL_HANDLERS, "1");  //so Ctrl-C still works
+  SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER);
+  const int inputWatch = OpenInputWatch();
+  if (inputWatch < 0) {
+    std::cout << "Cannot watch /dev/input, polling for controllers\n";
+  }
+  Initialize();
+  constexpr auto noScanScheduled = std::chrono::steady_clock::time_point::max();
+  auto nextScanTime = noScanScheduled;
+  bool wasConnected = false;
+
+  while (!m_stop) {
+    // Try getting controller if it was lost
+    const bool inputChanged = inputWatch >= 0 && ReadInputWatchEvents(inputWatch);
+    if (!Connected()) {
+      const auto now = std::chrono::steady_clock::now();
+      if (nextScanTime == noScanScheduled && (inputChanged || inputWatch < 0)) {
+        nextScanTime = now + (inputChanged ? hotplugSettleTime : fallbackScanInterval);
+      }
+      if (now >= nextScanTime) {
+        nextScanTime = noScanScheduled;
+        Rescan();
+      }
+    }
+
+    if (m_pEvdevGamepad && !m_pEvdevGamepad->ReadEvents(m_latestState, eventTime)) {
+      ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Game controller gone");
       Deinitialize();
-      return std::nullopt;
     }
+
+    // Polling pumps SDL, which reads the joystick
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
-      switch (event.type) {
-        case SDL_QUIT:
-          Deinitialize();
-          return std::nullopt;
-          break;
-
-        // Handle new controller attaching
-        case SDL_CONTROLLERDEVICEADDED:
-          std::cout << "DEVICEADDED cdevice.which = " << event.cdevice.which << std::endl;
-          break;
-
-        case SDL_CONTROLLERDEVICEREMOVED:
-          std::cout << "DEVICEREMOVED" << std::endl;
-          Deinitialize();
-          return std::nullopt;
-          break;
-
-        // If a controller button is pressed
-        case SDL_CONTROLLERBUTTONDOWN:
-          // Looking for the button that was pressed
-          if (event.cbutton.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(m_pJoystick))) {
-            // So the relevant state can be updated
-            switch (event.cbutton.button) {
-              case SDL_CONTROLLER_BUTTON_A:
-                m_latestState.Buttons.A = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_B:
-                m_latestState.Buttons.B = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_X:
-                m_latestState.Buttons.X = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_Y:
-                m_latestState.Buttons.Y = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_BACK:
-                m_latestState.Buttons.Back = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_GUIDE:
-                m_latestState.Buttons.XBox = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_START:
-                m_latestState.Buttons.Start = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_LEFTSTICK:
-                m_latestState.Buttons.StickLeft = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
-                m_latestState.Buttons.StickRight = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
-                m_latestState.Buttons.LB = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
-                m_latestState.Buttons.RB = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_UP:
-                m_latestState.Buttons.DUp = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-                m_latestState.Buttons.DDown = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-                m_latestState.Buttons.DLeft = true;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-                m_latestState.Buttons.DRight = true;
-                break;
-            }
-          }
-          break;
-
-        // Do the same for releasing a button
-        case SDL_CONTROLLERBUTTONUP:
-          if (event.cbutton.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(m_pJoystick))) {
-            switch (event.cbutton.button) {
-              case SDL_CONTROLLER_BUTTON_A:
-                m_latestState.Buttons.A = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_B:
-                m_latestState.Buttons.B = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_X:
-                m_latestState.Buttons.X = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_Y:
-                m_latestState.Buttons.Y = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_BACK:
-                m_latestState.Buttons.Back = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_GUIDE:
-                m_latestState.Buttons.XBox = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_START:
-                m_latestState.Buttons.Start = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_LEFTSTICK:
-                m_latestState.Buttons.StickLeft = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
-                m_latestState.Buttons.StickRight = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
-                m_latestState.Buttons.LB = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
-                m_latestState.Buttons.RB = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_UP:
-                m_latestState.Buttons.DUp = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-                m_latestState.Buttons.DDown = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-                m_latestState.Buttons.DLeft = false;
-                break;
-              case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-                m_latestState.Buttons.DRight = false;
-                break;
-            }
-          }
-          break;
-
-        // And something similar for axis motion
-        case SDL_CONTROLLERAXISMOTION:
-          if (event.cbutton.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(m_pJoystick))) {
-            switch (event.caxis.axis) {
-              case SDL_CONTROLLER_AXIS_LEFTX:
-                m_latestState.Axes.LeftX = JsIntToPct(event.caxis.value);
-                break;
-              case SDL_CONTROLLER_AXIS_LEFTY:
-                m_latestState.Axes.LeftY = -1.0 * JsIntToPct(event.caxis.value);
-                break;
-              case SDL_CONTROLLER_AXIS_RIGHTX:
-                m_latestState.Axes.RightX = JsIntToPct(event.caxis.value);
-                break;
-              case SDL_CONTROLLER_AXIS_RIGHTY:
-                m_latestState.Axes.RightY = -1.0 * JsIntToPct(event.caxis.value);
-                break;
-              case SDL_CONTROLLER_AXIS_TRIGGERLEFT:
-                m_latestState.Axes.LT = (1.0 + JsIntToPct(event.caxis.value)) * 0.5;
-                m_latestState.Buttons.LT = m_latestState.Axes.LT > 0.5;
-                break;
-              case SDL_CONTROLLER_AXIS_TRIGGERRIGHT:
-                m_latestState.Axes.RT = (1.0 + JsIntToPct(event.caxis.value)) * 0.5;
-                m_latestState.Buttons.RT = m_latestState.Axes.RT > 0.5;
-                break;
-            }
-          }
-          break;
+      if (m_pJoystick == nullptr) {
+        // SDL noticed the controller itself
+        if (event.type == SDL_CONTROLLERDEVICEADDED && !Connected()) {
+          Initialize();
+        }
+        continue;
       }
+      if (!ApplyEvent(event)) {
+        Deinitialize();
+      } else if (event.type >= SDL_CONTROLLERAXISMOTION && event.type <= SDL_CONTROLLERBUTTONUP) {
+        eventTime = std::chrono::steady_clock::now();
+      }
+    }
+
+    if (m_pJoystick != nullptr && !SDL_GameControllerGetAttached(m_pJoystick)) {
+      ARGOS_LOG(ArgosLib::LogLevel::kWarning, "Game controller gone");
+      Deinitialize();
     }
 
-    UpdateVibration();
+    auto now = std::chrono::steady_clock::now();
+    if (Connected()) {
+      UpdateVibration(now);
+    }
 
-    return m_latestState;
+    const bool connected = Connected();
+    m_snapshot.Store(Snapshot{.state = m_latestState, .eventTime = eventTime, .connected = connected});
+    {
+      std::lock_guard<std::mutex> lock(m_recorderMutex);
+      if (m_pRecorder) {
+        // Connection changes have no event time of their own
+        m_pRecorder->Record(connected == wasConnected ? eventTime : now,
+                            connected ? std::optional{m_latestState} : std::nullopt);
+      }
+    }
+    wasConnected = connected;
+
+    // Sleep until input (evdev only), a device change, a deadline or shutdown
+    now = std::chrono::steady_clock::now();
+    auto timeout = m_pJoystick ? pollPeriod : m_pEvdevGamepad ? vibrationUpdatePeriod : disconnectedPollPeriod;
+    if (nextScanTime != noScanScheduled) {
+      timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(nextScanTime - now));
+    }
+    std::array<pollfd, 3> waitFds{pollfd{.fd = m_stopEvent, .events = POLLIN, .revents = 0},
+                                  pollfd{.fd = inputWatch, .events = POLLIN, .revents = 0},
+                                  pollfd{.fd = m_pEvdevGamepad ? m_pEvdevGamepad->FileDescriptor() : -1,
+                                         .events = POLLIN,
+                                         .revents = 0}};
+    poll(waitFds.data(), waitFds.size(), static_cast<int>(std::max(timeout.count(), decltype(timeout.count()){0})));
   }
-  return std::nullopt;
-}
 
-void XBoxController::UpdateVibration() {
-  if (m_pJoystick != nullptr) {
-    const auto vibrationIntensity = m_vibrationModel();
-    SDL_GameControllerRumble(m_pJoystick,
-                             std::numeric_limits<uint16_t>::max() * vibrationIntensity.intensityLeft,
-                             std::numeric_limits<uint16_t>::max() * vibrationIntensity.intensityRight,
-                             std::numeric_limits<uint32_t>::max());
+  Deinitialize();
+  {
+    std::lock_guard<std::mutex> lock(m_recorderMutex);
+    if (m_pRecorder) {
+      m_pRecorder->Finish(std::chrono::steady_clock::now());
+    }
+  }
+  if (inputWatch >= 0) {
+    close(inputWatch);
   }
+  SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
+  SDL_Quit();
 }
 
-void XBoxController::SetVibration(double leftPercent,
-                                  double rightPercent,
-                                  std::optional<std::chrono::milliseconds> duration) {
-  if (!duration) {
-    m_vibrationModel = ArgosLib::VibrationConstant(leftPercent, rightPercent);
-  } else {
-    auto startTime = std::chrono::steady_clock::now();
-    m_vibrationModel = [startTime, leftPercent, rightPercent, duration]() {
-      auto expired = (std::chrono::steady_clock::now() - startTime) >= duration;
-      return ArgosLib::VibrationStatus{.intensityLeft{expired ? 0.0 : leftPercent},
-                                       .intensityRight{expired ? 0.0 : rightPercent}};
-    };
+bool XBoxController::ApplyEvent(const SDL_Event& event) {
+  switch (event.type) {
+    case SDL_QUIT:
+      return false;
+
+    // Handle new controller attaching
+    case SDL_CONTROLLERDEVICEADDED:
+      ARGOS_LOG(ArgosLib::LogLevel::kInfo, "DEVICEADDED cdevice.which = {}", event.cdevice.which);
+      break;
+
+    case SDL_CONTROLLERDEVICEREMOVED:
+      ARGOS_LOG(ArgosLib::LogLevel::kInfo, "DEVICEREMOVED");
+      return false;
+
+    // If a controller button is pressed or released
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+      // Looking for the button that changed, so the relevant state can be updated
+      if (event.cbutton.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(m_pJoystick)) &&
+          event.cbutton.button < sdlButtons.size()) {
+        m_latestState.Buttons.Set(sdlButtons[event.cbutton.button], event.type == SDL_CONTROLLERBUTTONDOWN);
+      }
+      break;
+
+    // And something similar for axis motion
+    case SDL_CONTROLLERAXISMOTION:
+      if (event.cbutton.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(m_pJoystick))) {
+        switch (event.caxis.axis) {
+          case SDL_CONTROLLER_AXIS_LEFTX:
+            m_latestState.Axes.LeftX = JsIntToPct(event.caxis.value);
+            break;
+          case SDL_CONTROLLER_AXIS_LEFTY:
+            m_latestState.Axes.LeftY = -1.0 * JsIntToPct(event.caxis.value);
+            break;
+          case SDL_CONTROLLER_AXIS_RIGHTX:
+            m_latestState.Axes.RightX = JsIntToPct(event.caxis.value);
+            break;
+          case SDL_CONTROLLER_AXIS_RIGHTY:
+            m_latestState.Axes.RightY = -1.0 * JsIntToPct(event.caxis.value);
+            break;
+          // SDL reports triggers from 0 released to 32767 fully pulled
+          case SDL_CONTROLLER_AXIS_TRIGGERLEFT:
+            m_latestState.Axes.LT = std::clamp(JsIntToPct(event.caxis.value), 0.0, 1.0);
+            m_latestState.Buttons.Set(Button::kLT, m_latestState.Axes.LT > triggerPressedThreshold);
+            break;
+          case SDL_CONTROLLER_AXIS_TRIGGERRIGHT:
+            m_latestState.Axes.RT = std::clamp(JsIntToPct(event.caxis.value), 0.0, 1.0);
+            m_latestState.Buttons.Set(Button::kRT, m_latestState.Axes.RT > triggerPressedThreshold);
+            break;
+        }
+      }
+      break;
   }
-  UpdateVibration();
+  return true;
 }
 
-void XBoxController::SetVibration(ArgosLib::VibrationModel newModel) {
-  m_vibrationModel = newModel;
-  UpdateVibration();
-}
 
-std::ostream& operator<<(std::ostream& os, const XBoxController::ButtonStates buttons) {
-  os << "{";
-  os << " A: " << buttons.A;
-  os << " B: " << buttons.B;
-  os << " X: " << buttons.X;
-  os << " Y: " << buttons.Y;
-  os << " LB: " << buttons.LB;
-  os << " RB: " << buttons.RB;
-  os << " Back: " << buttons.Back;
-  os << " Start: " << buttons.Start;
-  os << " StickLeft: " << buttons.StickLeft;
-  os << " StickRight: " << buttons.StickRight;
-  os << " LT: " << buttons.LT;
-  os << " RT: " << buttons.RT;
-  os << " DUp: " << buttons.DUp;
-  os << " DRight: " << buttons.DRight;
-  os << " DDown: " << buttons.DDown;
-  os << " DLeft: " << buttons.DLeft;
-  os << " }";
-  return os;
-}
+void XBoxController::UpdateVibration(const std::chrono::steady_clock::time_point now) {
+  const auto vibrationIntensity = m_vibrationModel.Load()(now);
+  const auto quantize = [](double intensity) {
+    return static_cast<uint8_t>(std::lround(std::clamp(intensity, 0.0, 1.0) * std::numeric_limits<uint8_t>::max()));
+  };
+  const RumbleLevels levels{quantize(vibrationIntensity.intensityLeft), quantize(vibrationIntensity.intensityRight)};
 
-std::ostream& operator<<(std::ostream& os, const XBoxController::AxisStates axes) {
-  os << "{";
-  os << " LeftX:" << axes.LeftX;
-  os << " LeftY:" << axes.LeftY;
-  os << " LT:" << axes.LT;
-  os << " RT:" << axes.RT;
-  os << " RightX:" << axes.RightX;
-  os << " RightY:" << axes.RightY;
-  os << " }";
-  return os;
+  // Every command is a wireless packet competing with input reports, so only send changes
+  if (m_sentRumble == levels && now - m_sentRumbleTime < rumbleKeepAlive) {
+    return;
+  }
+  m_sentRumble = levels;
+  m_sentRumbleTime = now;
+
+  constexpr double levelScale = 1.0 / std::numeric_limits<uint8_t>::max();
+  if (m_pEvdevGamepad) {
+    m_pEvdevGamepad->Rumble(levels[0] * levelScale, levels[1] * levelScale);
+  } else if (m_pJoystick != nullptr) {
+    // 0-255 to 0-65535
+    SDL_GameControllerRumble(m_pJoystick, levels[0] * 257, levels[1] * 257, std::numeric_limits<uint32_t>::max());
+  }
 }
 
-std::ostream& operator<<(std::ostream& os, const XBoxController::ControllerState state) {
-  os << "{ Buttons: " << state.Buttons << ", Axes: " << state.Axes << " }";
-  return os;
+void XBoxController::SetVibration(ArgosLib::VibrationModel newModel) {
+  // Sampled by the input thread when it next wakes
+  m_vibrationModel.Store(newModel);
 }
@@ -5,95 +5,110 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
 #include <SDL.h>
 #include <argosLib/controller/Vibration.h>
+#include <argosLib/general/seqlock.h>
 
-class XBoxController {
- public:
-  enum Button {
-    kA = 0,
-    kB = 1,
-    kX = 3,
-    kY = 4,
-    kBumperLeft = 6,
-    kBumperRight = 7,
-    kBack = 10,
-    kStart = 11,
-    kXBox = 12,
-    kStickLeft = 13,
-    kStickRight = 14
-  };
+#include "ControllerInterface.h"
+#include "ControllerRecording.h"
 
-  enum Axis { kLeftX = 0, kLeftY = 1, kRightX = 2, kRightY = 3, kRightTrigger = 4, kLeftTrigger = 5 };
+class EvdevGamepad;
 
-  struct ButtonStates {
-    bool A;
-    bool B;
-    bool X;
-    bool Y;
-    bool LB;
-    bool RB;
-    bool Back;
-    bool Start;
-    bool XBox;
-    bool StickLeft;
-    bool StickRight;
-    bool LT;
-    bool RT;
-    bool DUp;
-    bool DRight;
-    bool DDown;
-    bool DLeft;
-  };
-
-  struct AxisStates {
-    double LeftX;
-    double LeftY;
-    double LT;
-    double RT;
-    double RightX;
-    double RightY;
+class XBoxController : public ControllerInterface {
+ public:
+  enum class Backend {
+    kSDL,   ///< SDL game controller API
+    kEvdev  ///< Read /dev/input/event* directly for kernel timestamps and lower latency.  Falls back to SDL
   };
 
-  struct ControllerState {
-    ButtonStates Buttons;
-    AxisStates Axes;
-  };
+  enum Axis { kLeftX = 0, kLeftY = 1, kRightX = 2, kRightY = 3, kRightTrigger = 4, kLeftTrigger = 5 };
 
-  XBoxController(int index);
+  /**
+   * @brief Open the controller and start the input thread
+   *
+   * @param index Which controller to use, counting from 0
+   * @param backend How to read the controller
+   */
+  explicit XBoxController(int index, Backend backend = Backend::kSDL);
   ~XBoxController();
   XBoxController(const XBoxController&) = delete;
-  XBoxController(XBoxController&&);
+  XBoxController(XBoxController&&) = delete;
   XBoxController& operator=(const XBoxController&) = delete;
-  XBoxController& operator=(XBoxController&&);
+  XBoxController& operator=(XBoxController&&) = delete;
 
   [[nodiscard]] bool operator()();
-  [[nodiscard]] std::optional<ControllerState> CurrentState();
 
-  void SetVibration(double leftPercent,
-                    double rightPercent,
-                    std::optional<std::chrono::milliseconds> duration = std::nullopt);
+  /**
+   * @brief Latest controller state.  Never waits on SDL or the input thread
+   *
+   * @return State, or std::nullopt if no controller is connected
+   */
+  [[nodiscard]] std::optional<ControllerState> CurrentState() const override;
+
+  [[nodiscard]] Snapshot LatestSnapshot() const override;
+
+  using ControllerInterface::SetVibration;
+  void SetVibration(ArgosLib::VibrationModel newModel) override;
 
-  void SetVibration(ArgosLib::VibrationModel newModel);
+  /**
+   * @brief Write every state change seen by the input thread to a file, until the controller is destroyed.
+   *        Replaces any recording already in progress
+   *
+   * @return false if the file cannot be created
+   */
+  bool StartRecording(const std::filesystem::path& recordingFile);
 
  private:
+  /// @brief SDL input is polled this often.  The bundled SDL has no timers, so SDL_WaitEventTimeout() cannot time out
+  constexpr static std::chrono::milliseconds pollPeriod{4};
+  /// @brief Poll period while no controller is open.  Only hotplug changes need noticing
+  constexpr static std::chrono::milliseconds disconnectedPollPeriod{100};
+  /// @brief Rumble patterns are sampled at least this often
+  constexpr static std::chrono::milliseconds vibrationUpdatePeriod{20};
+  /// @brief Unchanged rumble is re-sent this often in case a command was lost
+  constexpr static std::chrono::milliseconds rumbleKeepAlive{1000};
+
+  /// @brief Rumble intensity quantized to 8 bits per motor, left then right
+  using RumbleLevels = std::array<uint8_t, 2>;
+
+  // Input thread only.  Every SDL call is made there because the bundled SDL is built without thread support
+  /// @brief Open the controller at m_index.  SDL uses its current device list
   bool Initialize();
   void Deinitialize();
-
-  void UpdateVibration();
+  /// @brief Re-enumerate devices, then try to open the controller
+  void Rescan();
+  void InputThread();
+  /// @return false if the controller was lost
+  bool ApplyEvent(const SDL_Event& event);
+  /// @brief Send rumble if the quantized intensity changed or the keep-alive is due
+  void UpdateVibration(std::chrono::steady_clock::time_point now);
+  [[nodiscard]] bool Connected() const { return m_pJoystick != nullptr || m_pEvdevGamepad != nullptr; }
 
   const int m_index;
-  SDL_GameController* m_pJoystick;
-  ControllerState m_latestState;
-
-  ArgosLib::VibrationModel m_vibrationModel;
+  const Backend m_backend;
+  SDL_GameController* m_pJoystick;                ///< Input thread only
+  std::unique_ptr<EvdevGamepad> m_pEvdevGamepad;  ///< Input thread only
+  ControllerState m_latestState;                  ///< Input thread only
+  std::optional<RumbleLevels> m_sentRumble;       ///< Input thread only.  Last rumble sent, std::nullopt forces a send
+  std::chrono::steady_clock::time_point m_sentRumbleTime;  ///< Input thread only
+  std::unique_ptr<ControllerRecorder> m_pRecorder;         ///< Guarded by m_recorderMutex
+  std::mutex m_recorderMutex;
+
+  Seqlock<Snapshot> m_snapshot;
+  Seqlock<ArgosLib::VibrationModel> m_vibrationModel;
+  std::atomic<bool> m_stop;
+  int m_stopEvent;  ///< eventfd that wakes the input thread to stop
+  std::thread m_inputThread;
 
   constexpr static auto JsIntToPct = [](int jsVal) { return static_cast<double>(jsVal) / 32767.0; };
 };
-
-std::ostream& operator<<(std::ostream& os, const XBoxController::ButtonStates buttons);
-std::ostream& operator<<(std::ostream& os, const XBoxController::AxisStates axes);
-std::ostream& operator<<(std::ostream& os, const XBoxController::ControllerState state);
@@ -4,75 +4,95 @@
 
 #include "argosLib/controller/Vibration.h"
 
-#include <chrono>
+#include <array>
+#include <cmath>
 
 using namespace ArgosLib;
 
+namespace {
+  using WaveformTable = std::array<double, VibrationModel::tableSize>;
+
+  WaveformTable MakePulseTable() {
+    WaveformTable table;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = i < table.size() / 2 ? 1.0 : 0.0;
+    }
+    return table;
+  }
+
+  WaveformTable MakeWaveTable() {
+    WaveformTable table;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = std::cos(M_PI * 2.0 * i / table.size()) / 2 + 0.5;
+    }
+    return table;
+  }
+
+  const WaveformTable pulseTable = MakePulseTable();
+  const WaveformTable waveTable = MakeWaveTable();
+
+  std::chrono::milliseconds ToPeriod(units::millisecond_t period) {
+    return std::chrono::milliseconds{period.to<int>()};
+  }
+}  // namespace
+
+VibrationStatus VibrationModel::operator()(const std::chrono::steady_clock::time_point time) const {
+  if (time >= m_endTime) {
+    return VibrationStatus{0.0, 0.0};
+  }
+  double level = 1.0;
+  if (m_waveform != Waveform::kConstant) {
+    const auto phase = time.time_since_epoch() % m_period;
+    const auto index = static_cast<std::size_t>(phase * tableSize / m_period);
+    level = (m_waveform == Waveform::kPulse ? pulseTable : waveTable)[index];
+  }
+  return VibrationStatus{m_off.intensityLeft + level * (m_on.intensityLeft - m_off.intensityLeft),
+                         m_off.intensityRight + level * (m_on.intensityRight - m_off.intensityRight)};
+}
+
 VibrationModel ArgosLib::VibrationOff() {
-  return []() { return VibrationStatus{0.0, 0.0}; };
+  return VibrationModel{};
 }
 
 VibrationModel ArgosLib::VibrationConstant(double intensity) {
-  return [intensity]() { return VibrationStatus{intensity, intensity}; };
+  return VibrationConstant(intensity, intensity);
 }
 
 VibrationModel ArgosLib::VibrationConstant(double intensityLeft, double intensityRight) {
-  return [intensityLeft, intensityRight]() { return VibrationStatus{intensityLeft, intensityRight}; };
+  return VibrationModel{VibrationModel::Waveform::kConstant,
+                        std::chrono::milliseconds{1},
+                        VibrationStatus{intensityLeft, intensityRight}};
 }
 
 VibrationModel ArgosLib::VibrationSyncPulse(units::millisecond_t pulsePeriod, double intensityOn, double intensityOff) {
-  auto msPeriod = pulsePeriod.to<int>();
-  return [msPeriod, intensityOn, intensityOff]() {
-    const auto periodTime =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
-            .count() %
-        msPeriod;
-    const auto vibrationIntensity = periodTime < (msPeriod / 2) ? intensityOn : intensityOff;
-    return VibrationStatus{vibrationIntensity, vibrationIntensity};
-  };
+  return VibrationModel{VibrationModel::Waveform::kPulse,
+                        ToPeriod(pulsePeriod),
+                        VibrationStatus{intensityOn, intensityOn},
+                        VibrationStatus{intensityOff, intensityOff}};
 }
 
 VibrationModel ArgosLib::VibrationAlternatePulse(units::millisecond_t pulsePeriod,
                                                  double intensityOn,
                                                  double intensityOff) {
-  auto msPeriod = pulsePeriod.to<int>();
-  return [msPeriod, intensityOn, intensityOff]() {
-    const auto periodTime =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
-            .count() %
-        msPeriod;
-    const auto vibrationState = periodTime < (msPeriod / 2);
-    return VibrationStatus{vibrationState ? intensityOn : intensityOff, vibrationState ? intensityOff : intensityOn};
-  };
+  // Right motor is on while the left is off
+  return VibrationModel{VibrationModel::Waveform::kPulse,
+                        ToPeriod(pulsePeriod),
+                        VibrationStatus{intensityOn, intensityOff},
+                        VibrationStatus{intensityOff, intensityOn}};
 }
 
 VibrationModel ArgosLib::VibrationSyncWave(units::millisecond_t pulsePeriod, double intensityOn, double intensityOff) {
-  auto msPeriod = pulsePeriod.to<int>();
-  return [msPeriod, intensityOn, intensityOff]() {
-    const auto periodTime =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
-            .count() %
-        msPeriod;
-    const auto periodProgress = static_cast<double>(periodTime) / msPeriod;
-    const auto vibrationIntensity = std::cos(M_PI * 2.0 * periodProgress) / 2 + 0.5;
-    const auto outputIntensity = intensityOff + vibrationIntensity * (intensityOn - intensityOff);
-    return VibrationStatus{outputIntensity, outputIntensity};
-  };
+  return VibrationModel{VibrationModel::Waveform::kWave,
+                        ToPeriod(pulsePeriod),
+                        VibrationStatus{intensityOn, intensityOn},
+                        VibrationStatus{intensityOff, intensityOff}};
 }
 
 VibrationModel ArgosLib::VibrationAlternateWave(units::millisecond_t pulsePeriod,
                                                 double intensityOn,
                                                 double intensityOff) {
-  auto msPeriod = pulsePeriod.to<int>();
-  return [msPeriod, intensityOn, intensityOff]() {
-    const auto periodTime =
-        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
-            .count() %
-        msPeriod;
-    const auto periodProgress = static_cast<double>(periodTime) / msPeriod;
-    const auto vibrationIntensityLeft = std::cos(M_PI * 2.0 * periodProgress) / 2 + 0.5;
-    const auto vibrationIntensityRight = 1.0 - vibrationIntensityLeft;
-    return VibrationStatus{intensityOff + vibrationIntensityLeft * (intensityOn - intensityOff),
-                           intensityOff + vibrationIntensityRight * (intensityOn - intensityOff)};
-  };
+  return VibrationModel{VibrationModel::Waveform::kWave,
+                        ToPeriod(pulsePeriod),
+                        VibrationStatus{intensityOn, intensityOff},
+                        VibrationStatus{intensityOff, intensityOn}};
 }
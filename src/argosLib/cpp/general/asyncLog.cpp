@@ -0,0 +1,301 @@
+/// \copyright Copyright (c) Argos FRC Team 1756.
+///            Open Source Software; you can modify and/or share it under the terms of
+///            the license file in the root directory of this project.
+
+#include "argosLib/general/asyncLog.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace ArgosLib;
+using logDetail::ArgType;
+using logDetail::Record;
+
+namespace {
+  /// Threads that may log at once.  Rings are claimed on a thread's first record and released when it exits
+  constexpr std::size_t maxThreads = 16;
+  /// Records buffered per thread.  Power of 2
+  constexpr std::size_t ringSize = 256;
+  static_assert((ringSize & (ringSize - 1)) == 0, "Ring size must be a power of 2");
+  constexpr auto writerPeriod = std::chrono::milliseconds{20};
+
+  /**
+   * @brief Single-producer, single-consumer ring of records.  Constant initialized so claiming one never allocates
+   */
+  struct Ring {
+    std::array<Record, ringSize> records;
+    alignas(64) std::atomic<uint64_t> head;  ///< Next record to write.  Producer only
+    alignas(64) std::atomic<uint64_t> tail;  ///< Next record to read.  Writer only
+    std::atomic<uint64_t> dropped;           ///< Records lost because the ring was full
+    /// A thread is producing into the ring.  A released ring's queued records are still written, and the next owner
+    /// carries on from its head
+    std::atomic<bool> claimed;
+  };
+
+  Ring rings[maxThreads];
+  std::atomic<uint64_t> unringedDrops{0};  ///< Records from threads beyond maxThreads
+  thread_local Ring* threadRing{nullptr};
+
+  /// @brief Thread exit hook for a thread's ring
+  void ReleaseRing(void* ring) {
+    static_cast<Ring*>(ring)->claimed.store(false, std::memory_order_release);
+  }
+
+  /**
+   * @brief Releases each thread's ring when it exits.  A pthread key rather than a thread_local with a destructor,
+   *        since registering one of those allocates on the thread's first record
+   */
+  class RingReleaser {
+   public:
+    RingReleaser() : m_valid{pthread_key_create(&m_key, ReleaseRing) == 0} {}
+    ~RingReleaser() {
+      if (m_valid) {
+        pthread_key_delete(m_key);
+      }
+    }
+
+    void Register(Ring& ring) const {
+      if (m_valid) {
+        pthread_setspecific(m_key, &ring);
+      }
+    }
+
+   private:
+    pthread_key_t m_key;
+    const bool m_valid;
+  };
+
+  const RingReleaser ringReleaser;
+
+  /// @brief Claim an unowned ring
+  /// @return nullptr if maxThreads threads already hold one
+  Ring* ClaimRing() {
+    for (auto& ring : rings) {
+      bool claimed = false;
+      if (!ring.claimed.load(std::memory_order_relaxed) &&
+          ring.claimed.compare_exchange_strong(claimed, true, std::memory_order_acquire)) {
+        return &ring;
+      }
+    }
+    return nullptr;
+  }
+
+  class Writer {
+   public:
+    Writer() : m_stop{false}, m_output{}, m_thread{&Writer::Run, this} {}
+    /// @brief Writes everything queued before returning
+    ~Writer() {
+      {
+        std::scoped_lock lock(m_mutex);
+        m_stop = true;
+      }
+      m_wake.notify_one();
+      m_thread.join();
+    }
+
+   private:
+    void Run() {
+      // Lowest priority so formatting and blocking writes never compete with real-time threads
+      sched_param param{};
+      pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+      m_output.reserve(16384);
+      std::array<uint64_t, maxThreads> reportedDrops{};
+      uint64_t reportedUnringedDrops = 0;
+
+      std::unique_lock lock(m_mutex);
+      while (true) {
+        const bool stopping = m_wake.wait_for(lock, writerPeriod, [this]() { return m_stop; });
+        lock.unlock();
+
+        // Every ring, since a ring released by an exiting thread may still hold records
+        for (std::size_t i = 0; i < maxThreads; ++i) {
+          Drain(rings[i]);
+          const auto dropped = rings[i].dropped.load(std::memory_order_relaxed);
+          if (dropped != reportedDrops[i]) {
+            AppendDropReport(dropped - reportedDrops[i]);
+            reportedDrops[i] = dropped;
+          }
+        }
+        if (const auto dropped = unringedDrops.load(std::memory_order_relaxed); dropped != reportedUnringedDrops) {
+          AppendDropReport(dropped - reportedUnringedDrops);
+          reportedUnringedDrops = dropped;
+        }
+        Flush();
+
+        if (stopping) {
+          return;
+        }
+        lock.lock();
+      }
+    }
+
+    void Drain(Ring& ring) {
+      const auto head = ring.head.load(std::memory_order_acquire);
+      auto tail = ring.tail.load(std::memory_order_relaxed);
+      for (; tail != head; ++tail) {
+        Append(ring.records[tail % ringSize]);
+        if (m_output.size() > m_output.capacity() / 2) {
+          Flush();
+        }
+      }
+      ring.tail.store(tail, std::memory_order_release);
+    }
+
+    void Append(const Record& record) {
+      switch (record.site->Level()) {
+        case LogLevel::kWarning:
+          m_output += "[WARNING] ";
+          break;
+        case LogLevel::kError:
+          m_output += "[ERROR] ";
+          break;
+        default:
+          break;
+      }
+      std::size_t arg = 0;
+      for (const char* format = record.site->Format(); *format != '\0'; ++format) {
+        if (*format != '{') {
+          m_output += *format;
+          continue;
+        }
+        int precision = 6;
+        if (format[1] == ':' && format[2] == '.' && format[3] >= '0' && format[3] <= '9') {
+          precision = format[3] - '0';
+        }
+        while (*format != '\0' && *format != '}') {
+          ++format;
+        }
+        if (arg < record.argCount) {
+          AppendArg(record.types[arg], record.values[arg], precision);
+          ++arg;
+        }
+        if (*format == '\0') {
+          break;
+        }
+      }
+      if (record.suppressed > 0) {
+        m_output += " (";
+        AppendFormatted("%u", record.suppressed);
+        m_output += " similar suppressed)";
+      }
+      m_output += '\n';
+    }
+
+    void AppendArg(const ArgType type, const uint64_t value, const int precision) {
+      switch (type) {
+        case ArgType::kSigned:
+          AppendFormatted("%lld", static_cast<long long>(static_cast<int64_t>(value)));
+          break;
+        case ArgType::kUnsigned:
+          AppendFormatted("%llu", static_cast<unsigned long long>(value));
+          break;
+        case ArgType::kDouble: {
+          double asDouble;
+          std::memcpy(&asDouble, &value, sizeof(asDouble));
+          AppendFormatted("%.*g", precision, asDouble);
+          break;
+        }
+        case ArgType::kBool:
+          m_output += value ? "true" : "false";
+          break;
+      }
+    }
+
+    /// @brief Append one printf-formatted number
+    template <class... Args>
+    void AppendFormatted(const char* format, const Args... args) {
+      std::array<char, 32> buffer;
+      const int length = std::snprintf(buffer.data(), buffer.size(), format, args...);
+      if (length > 0) {
+        m_output.append(buffer.data(), std::min(static_cast<std::size_t>(length), buffer.size() - 1));
+      }
+    }
+
+    void AppendDropReport(const uint64_t dropped) {
+      m_output += "[WARNING] ";
+      AppendFormatted("%llu", static_cast<unsigned long long>(dropped));
+      m_output += " log records dropped\n";
+    }
+
+    /// @brief Write m_output after anything already written to std::cout, so lines appear in the order written
+    void Flush() {
+      std::cout.flush();
+      const char* data = m_output.data();
+      std::size_t size = m_output.size();
+      while (size > 0) {
+        const auto written = write(STDOUT_FILENO, data, size);
+        if (written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          break;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+      }
+      m_output.clear();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;  ///< Guarded by m_mutex
+    std::string m_output;
+    std::thread m_thread;
+  };
+
+  Writer& WriterInstance() {
+    static Writer writer;
+    return writer;
+  }
+}  // namespace
+
+bool LogSite::Allow(uint32_t& suppressed) {
+  if (m_minInterval == 0) {
+    suppressed = 0;
+    return true;
+  }
+  const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+  auto nextAllowed = m_nextAllowed.load(std::memory_order_relaxed);
+  if (now < nextAllowed ||
+      !m_nextAllowed.compare_exchange_strong(nextAllowed, now + m_minInterval, std::memory_order_relaxed)) {
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+void logDetail::Push(const Record& record) {
+  if (!threadRing) {
+    threadRing = ClaimRing();
+    if (!threadRing) {
+      unringedDrops.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    ringReleaser.Register(*threadRing);
+    StartLogWriter();
+  }
+  Ring& ring = *threadRing;
+  const auto head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) >= ringSize) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring.records[head % ringSize] = record;
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+void ArgosLib::StartLogWriter() {
+  WriterInstance();
+}
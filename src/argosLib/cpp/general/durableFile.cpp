@@ -0,0 +1,62 @@
+/// \copyright Copyright (c) Argos FRC Team 1756.
+///            Open Source Software; you can modify and/or share it under the terms of
+///            the license file in the root directory of this project.
+
+#include "argosLib/general/durableFile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+namespace {
+  /// @brief Write all of data and flush it to the device
+  bool WriteSynced(const int fd, const std::byte* data, std::size_t size) {
+    while (size > 0) {
+      const auto written = write(fd, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += written;
+      size -= static_cast<std::size_t>(written);
+    }
+    return fsync(fd) == 0;
+  }
+
+  /// @brief Make a rename in directory durable
+  bool SyncDirectory(const std::filesystem::path& directory) {
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+  }
+}  // namespace
+
+bool ArgosLib::ReplaceFileDurably(const std::filesystem::path& file, const std::span<const std::byte> contents) {
+  auto tempPath = file;
+  tempPath += ".tmp";
+  std::error_code error;
+
+  const int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  const bool written = WriteSynced(fd, contents.data(), contents.size());
+  if (close(fd) != 0 || !written) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  if (std::rename(tempPath.c_str(), file.c_str()) != 0) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  const auto directory = file.parent_path();
+  return SyncDirectory(directory.empty() ? std::filesystem::path{"."} : directory);
+}
@@ -6,7 +6,8 @@
 
 #include <units/time.h>
 
-#include <functional>
+#include <chrono>
+#include <cstdint>
 
 namespace ArgosLib {
 
@@ -15,7 +16,61 @@ namespace ArgosLib {
     double intensityRight = 0.0;
   };
 
-  using VibrationModel = std::function<VibrationStatus()>;
+  /**
+   * @brief Rumble pattern.  One period of a precomputed unit waveform scales each motor between its off and on
+   *        intensities, so evaluating a pattern is a table lookup.  Trivially copyable and never allocates.
+   */
+  class VibrationModel {
+   public:
+    enum class Waveform : uint8_t {
+      kConstant,  ///< Always on
+      kPulse,     ///< On for the first half of each period
+      kWave       ///< Raised cosine, on at the start of each period
+    };
+
+    /// @brief Samples per waveform period
+    constexpr static std::size_t tableSize = 64;
+
+    /// @brief No vibration
+    constexpr VibrationModel() = default;
+
+    /**
+     * @param waveform Shape of each period
+     * @param period Waveform period.  Phase is taken from the clock epoch, so patterns with the same period stay in
+     *               step
+     * @param on Intensities (0-1) where the waveform is 1
+     * @param off Intensities (0-1) where the waveform is 0
+     */
+    constexpr VibrationModel(Waveform waveform,
+                             std::chrono::milliseconds period,
+                             VibrationStatus on,
+                             VibrationStatus off = VibrationStatus{})
+        : m_waveform{waveform}
+        , m_period{period.count() > 0 ? period : std::chrono::milliseconds{1}}
+        , m_on{on}
+        , m_off{off} {}
+
+    /**
+     * @brief Intensities at a time.  Reads no clocks
+     *
+     * @param time Time to evaluate at, normally the current tick's time
+     */
+    [[nodiscard]] VibrationStatus operator()(std::chrono::steady_clock::time_point time) const;
+
+    /// @brief Same pattern, switching off at endTime
+    [[nodiscard]] constexpr VibrationModel Until(std::chrono::steady_clock::time_point endTime) const {
+      VibrationModel limited = *this;
+      limited.m_endTime = endTime;
+      return limited;
+    }
+
+   private:
+    Waveform m_waveform{Waveform::kConstant};
+    std::chrono::milliseconds m_period{1};
+    VibrationStatus m_on{};
+    VibrationStatus m_off{};
+    std::chrono::steady_clock::time_point m_endTime{std::chrono::steady_clock::time_point::max()};
+  };
 
   VibrationModel VibrationOff();
   VibrationModel VibrationConstant(double);
@@ -0,0 +1,156 @@
+/// \copyright Copyright (c) Argos FRC Team 1756.
+///            Open Source Software; you can modify and/or share it under the terms of
+///            the license file in the root directory of this project.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// @file Logging for real-time threads.
+///
+///       ARGOS_LOG() copies a record (log site and arguments) into a ring buffer owned by the calling thread and
+///       returns.  It never blocks, locks, allocates or makes a system call.  A low priority writer thread formats
+///       records and writes them to stdout, so a stalled stdout (e.g. journald) stalls only the writer.  When a ring
+///       is full the record is dropped and counted, and the writer reports the count.
+///
+///       The writer owns stdout.  Non real-time code may still print whole lines with std::cout, which the writer
+///       flushes before each batch of records so buffered output is never held back behind later records.  Records
+///       can print up to 20ms after std::cout output that followed them.
+///
+///       Formats use {} for each argument, or {:.N} for a number printed with N significant digits.  Arguments are
+///       numbers, bools or enums; the placeholder count is checked at compile time.
+
+namespace ArgosLib {
+
+  enum class LogLevel : uint8_t {
+    kInfo,     ///< Printed as is
+    kWarning,  ///< Printed with a [WARNING] prefix
+    kError     ///< Printed with an [ERROR] prefix
+  };
+
+  /**
+   * @brief One ARGOS_LOG() call site.  Records refer to their site instead of copying the format
+   */
+  class LogSite {
+   public:
+    /**
+     * @param minInterval Records closer together than this are suppressed, and the next record printed reports how
+     *                    many were.  0 prints every record
+     */
+    constexpr LogSite(LogLevel level, const char* format, std::chrono::nanoseconds minInterval)
+        : m_level{level}, m_format{format}, m_minInterval{minInterval.count()} {}
+    LogSite(const LogSite&) = delete;
+    LogSite& operator=(const LogSite&) = delete;
+
+    [[nodiscard]] LogLevel Level() const { return m_level; }
+    [[nodiscard]] const char* Format() const { return m_format; }
+
+    /**
+     * @brief Apply the rate limit
+     *
+     * @param suppressed Set to the number of records suppressed since the last one allowed
+     * @return true if a record may be written now
+     */
+    bool Allow(uint32_t& suppressed);
+
+   private:
+    const LogLevel m_level;
+    const char* const m_format;
+    const int64_t m_minInterval;            ///< ns
+    std::atomic<int64_t> m_nextAllowed{0};  ///< steady_clock ns
+    std::atomic<uint32_t> m_suppressed{0};
+  };
+
+  /// @brief Number of {} or {:.N} placeholders in a format
+  constexpr std::size_t LogPlaceholderCount(const char* format) {
+    std::size_t count = 0;
+    for (; *format != '\0'; ++format) {
+      count += *format == '{';
+    }
+    return count;
+  }
+
+  namespace logDetail {
+    constexpr std::size_t maxArgs = 6;
+
+    enum class ArgType : uint8_t { kSigned, kUnsigned, kDouble, kBool };
+
+    /// @brief Binary log record.  Fixed size so rings are plain arrays
+    struct Record {
+      const LogSite* site;
+      uint32_t suppressed;
+      uint8_t argCount;
+      std::array<ArgType, maxArgs> types;
+      std::array<uint64_t, maxArgs> values;
+    };
+
+    template <class T>
+    void Pack(Record& record, const T value) {
+      static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Log arguments must be numbers, bools or enums");
+      auto& type = record.types[record.argCount];
+      auto& slot = record.values[record.argCount];
+      ++record.argCount;
+      if constexpr (std::is_same_v<T, bool>) {
+        type = ArgType::kBool;
+        slot = value;
+      } else if constexpr (std::is_floating_point_v<T>) {
+        type = ArgType::kDouble;
+        const double asDouble = value;
+        std::memcpy(&slot, &asDouble, sizeof(slot));
+      } else if constexpr (std::is_enum_v<T>) {
+        type = ArgType::kSigned;
+        slot = static_cast<uint64_t>(static_cast<int64_t>(value));
+      } else if constexpr (std::is_signed_v<T>) {
+        type = ArgType::kSigned;
+        slot = static_cast<uint64_t>(static_cast<int64_t>(value));
+      } else {
+        type = ArgType::kUnsigned;
+        slot = value;
+      }
+    }
+
+    /// @brief Queue a record on the calling thread's ring, or count it as dropped
+    void Push(const Record& record);
+  }  // namespace logDetail
+
+  /**
+   * @brief Queue a record for site.  Use ARGOS_LOG() or ARGOS_LOG_EVERY() rather than calling directly
+   *
+   * @tparam placeholders Placeholders in the site's format
+   */
+  template <std::size_t placeholders, class... Args>
+  void Log(LogSite& site, const Args... args) {
+    static_assert(sizeof...(Args) == placeholders, "Log arguments must match the format's placeholders");
+    static_assert(sizeof...(Args) <= logDetail::maxArgs, "Too many log arguments");
+    uint32_t suppressed = 0;
+    if (!site.Allow(suppressed)) {
+      return;
+    }
+    logDetail::Record record{.site = &site, .suppressed = suppressed, .argCount = 0, .types{}, .values{}};
+    (logDetail::Pack(record, args), ...);
+    logDetail::Push(record);
+  }
+
+  /**
+   * @brief Start the writer thread, which otherwise starts with the first record.  Call early from main() so no
+   *        real-time thread pays for starting it
+   */
+  void StartLogWriter();
+
+}  // namespace ArgosLib
+
+/// @brief Log every call, e.g. ARGOS_LOG(ArgosLib::LogLevel::kError, "Bad sample on channel {}", channel)
+#define ARGOS_LOG(level, format, ...) \
+  ARGOS_LOG_EVERY(std::chrono::nanoseconds{0}, level, format __VA_OPT__(, ) __VA_ARGS__)
+
+/// @brief Log at most once per minInterval, reporting how many calls were suppressed in between
+#define ARGOS_LOG_EVERY(minInterval, level, format, ...)                                               \
+  do {                                                                                                 \
+    static constinit ::ArgosLib::LogSite argosLogSite{level, format, minInterval};                     \
+    ::ArgosLib::Log<::ArgosLib::LogPlaceholderCount(format)>(argosLogSite __VA_OPT__(, ) __VA_ARGS__); \
+  } while (false)
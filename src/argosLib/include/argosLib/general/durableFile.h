@@ -0,0 +1,25 @@
+/// \copyright Copyright (c) Argos FRC Team 1756.
+///            Open Source Software; you can modify and/or share it under the terms of
+///            the license file in the root directory of this project.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace ArgosLib {
+
+  /**
+   * @brief Replace a file's contents so that a crash or power loss leaves either the old or the new contents.
+   *
+   * Writes a temporary file beside it, syncs it, renames it over the file and syncs the directory.  Blocks on the
+   * disk, so call from a thread that can wait
+   *
+   * @param file File to replace.  Its directory must exist
+   * @param contents New contents
+   * @return false if any step failed.  The file keeps its old contents unless the rename succeeded
+   */
+  bool ReplaceFileDurably(const std::filesystem::path& file, std::span<const std::byte> contents);
+
+}  // namespace ArgosLib
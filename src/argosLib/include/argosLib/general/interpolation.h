@@ -6,6 +6,8 @@
 
 #include <algorithm>
 #include <array>
+#include <limits>
+#include <type_traits>
 
 template <class T>
 struct interpMapPoint {
@@ -28,29 +30,110 @@ constexpr bool operator<(const T& a, const interpMapPoint<T>& b) {
   return a < b.inVal;
 }
 
-template <class T, int size>
+namespace interpolationDetail {
+  // Deliberately not constexpr.  Reaching one while building a map at compile time makes the build fail with its
+  // name in the diagnostic
+  void mapInputsMustBeStrictlyIncreasing();
+  void gridTooCoarseForPointSpacing();
+}  // namespace interpolationDetail
+
+/**
+ * @brief Piecewise linear map through sorted points, clamped to the first and last outputs.
+ *
+ * Points are compiled into a uniform grid when the map is built, which must happen at compile time.  Each grid cell
+ * records the segment at its start, so a lookup is one multiply to find the cell, one comparison for a breakpoint
+ * inside the cell and one multiply-add with a precomputed slope, with no search or division.
+ *
+ * @tparam T Floating point input and output type
+ * @tparam size Number of points
+ * @tparam gridSize Cells spanning the input range.  Each cell may contain at most one point, so maps with closely
+ *                  spaced points need more
+ */
+template <class T, int size, int gridSize = 4 * size>
 class interpolationMap {
+  static_assert(std::is_floating_point_v<T>, "Map values must be floating point");
+  static_assert(size > 0, "Map must contain at least one value");
+  static_assert(gridSize > 0, "Grid must contain at least one cell");
+
  public:
   interpolationMap() = delete;
-  constexpr interpolationMap(std::array<interpMapPoint<T>, size> initArray) : m_mapArray(initArray) {
-    // assert(("Map must contain at least one value.", !initArray.empty()));
-    // assert(("Map values must be sorted.", std::is_sorted(initArray.cbegin(), initArray.cend())));
-  }
+  consteval interpolationMap(std::array<interpMapPoint<T>, size> initArray)
+      : m_minIn{initArray.front().inVal}
+      , m_maxIn{initArray.back().inVal}
+      , m_cellsPerIn{}
+      , m_segmentIn{}
+      , m_segmentOut{}
+      , m_segmentSlope{}
+      , m_segmentEnd{}
+      , m_cellSegment{} {
+    for (int i = 1; i < size; ++i) {
+      if (!(initArray[i - 1].inVal < initArray[i].inVal)) {
+        interpolationDetail::mapInputsMustBeStrictlyIncreasing();
+      }
+    }
+
+    // Segment i runs from point i to point i + 1.  The last is the flat extension past the final point
+    for (int i = 0; i < size; ++i) {
+      m_segmentIn[i] = initArray[i].inVal;
+      m_segmentOut[i] = initArray[i].outVal;
+      if (i + 1 < size) {
+        m_segmentSlope[i] =
+            (initArray[i + 1].outVal - initArray[i].outVal) / (initArray[i + 1].inVal - initArray[i].inVal);
+        m_segmentEnd[i] = initArray[i + 1].inVal;
+      } else {
+        m_segmentSlope[i] = 0;
+        m_segmentEnd[i] = std::numeric_limits<T>::infinity();
+      }
+    }
 
-  constexpr T map(const T inVal) const {
-    if (inVal >= m_mapArray.back().inVal) {
-      return m_mapArray.back().outVal;
-    } else if (inVal <= m_mapArray.front().inVal) {
-      return m_mapArray.front().outVal;
-    } else {
-      auto afterPoint{std::lower_bound(m_mapArray.cbegin(), m_mapArray.cend(), inVal)};
-      auto beforePoint{std::prev(afterPoint)};
-      const auto lerpPct = (inVal - beforePoint->inVal) / (afterPoint->inVal - beforePoint->inVal);
-      return beforePoint->outVal + lerpPct * (afterPoint->outVal - beforePoint->outVal);
+    const T range = m_maxIn - m_minIn;
+    m_cellsPerIn = range > 0 ? gridSize / range : 0;
+    int segment = 0;
+    for (int cell = 0; cell < gridSize; ++cell) {
+      const T cellStart = m_minIn + range * cell / gridSize;
+      const T cellEnd = m_minIn + range * (cell + 1) / gridSize;
+      while (segment + 1 < size && m_segmentIn[segment + 1] <= cellStart) {
+        ++segment;
+      }
+      if (segment + 2 < size && m_segmentIn[segment + 2] < cellEnd) {
+        interpolationDetail::gridTooCoarseForPointSpacing();
+      }
+      m_cellSegment[cell] = segment;
     }
   }
-  constexpr T operator()(const T inVal) { return map(inVal); }
+
+  constexpr T map(T inVal) const {
+    // Written so NaN clamps to the last point instead of indexing out of range
+    inVal = inVal < m_maxIn ? inVal : m_maxIn;
+    inVal = inVal > m_minIn ? inVal : m_minIn;
+    const int cell = std::min(static_cast<int>((inVal - m_minIn) * m_cellsPerIn), gridSize - 1);
+    int segment = m_cellSegment[cell];
+    segment += inVal >= m_segmentEnd[segment];
+    return m_segmentOut[segment] + m_segmentSlope[segment] * (inVal - m_segmentIn[segment]);
+  }
+  constexpr T operator()(const T inVal) const { return map(inVal); }
 
  private:
-  std::array<interpMapPoint<T>, size> m_mapArray;
+  T m_minIn;
+  T m_maxIn;
+  T m_cellsPerIn;  ///< Grid cells per unit of input
+  std::array<T, size> m_segmentIn;
+  std::array<T, size> m_segmentOut;
+  std::array<T, size> m_segmentSlope;
+  std::array<T, size> m_segmentEnd;         ///< Input where the next segment starts
+  std::array<int, gridSize> m_cellSegment;  ///< Segment containing the start of each cell
 };
+
+/**
+ * @brief Map three inputs through three maps of the same shape, e.g. the drive axes of one controller sample.  The
+ *        lookups share no data, so once inlined the compiler is free to interleave them
+ *
+ * @return Outputs in the order of the maps
+ */
+template <class T, int size, int gridSize>
+constexpr std::array<T, 3> map3(const interpolationMap<T, size, gridSize>& map0,
+                                const interpolationMap<T, size, gridSize>& map1,
+                                const interpolationMap<T, size, gridSize>& map2,
+                                const std::array<T, 3> inVals) {
+  return {map0.map(inVals[0]), map1.map(inVals[1]), map2.map(inVals[2])};
+}
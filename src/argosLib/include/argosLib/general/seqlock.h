@@ -0,0 +1,71 @@
+/// \copyright Copyright (c) Argos FRC Team 1756.
+///            Open Source Software; you can modify and/or share it under the terms of
+///            the license file in the root directory of this project.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief Single-writer, multi-reader sequence lock.  Readers never block the writer and always receive a value
+ *        from a single Store() call; a reader that overlaps a store retries.
+ *
+ * @tparam T Trivially copyable value type
+ */
+template <class T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable_v<T>, "Seqlock values are copied bytewise");
+
+ public:
+  Seqlock() { Store(T{}); }
+  explicit Seqlock(const T& initialValue) { Store(initialValue); }
+  Seqlock(const Seqlock&) = delete;
+  Seqlock& operator=(const Seqlock&) = delete;
+
+  /**
+   * @brief Publish a new value.  Must only be called from one thread at a time
+   */
+  void Store(const T& value) {
+    std::array<uint64_t, wordCount> words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    const auto sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < wordCount; ++i) {
+      m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Read the most recently published value.  Lock-free; spins only while a store is in progress
+   */
+  [[nodiscard]] T Load() const {
+    std::array<uint64_t, wordCount> words;
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = m_sequence.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < wordCount; ++i) {
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = m_sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+ private:
+  constexpr static std::size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint32_t> m_sequence{0};  ///< Odd while a store is in progress
+  std::array<std::atomic<uint64_t>, wordCount> m_words{};
+};
@@ -18,15 +18,24 @@ namespace ArgosLib {
 
   class SwerveHomeStorageInterface {
    public:
+    virtual ~SwerveHomeStorageInterface() = default;
+
     /**
      * @brief Save home position to persistent storage
      *
      * @param homePosition Positions to store
-     * @return true Save successful
+     * @return true Save successful, or queued by storage that writes in the background.  Check LastSaveFailed() for
+     *         the outcome of a queued save
      * @return false Error saving
      */
     virtual bool Save(const SwerveModulePositions& homePosition) = 0;
 
+    /**
+     * @brief Whether the most recent save to reach persistent storage failed.  Storage that saves within Save() reports
+     *        failure there instead
+     */
+    [[nodiscard]] virtual bool LastSaveFailed() const { return false; }
+
     /**
      * @brief Load home position from persistent storage
      *
@@ -35,7 +35,9 @@ namespace frc {
  *
  * The inverse kinematics: [moduleStates] = [moduleLocations] * [chassisSpeeds]
  * We take the Moore-Penrose pseudoinverse of [moduleLocations] and then
- * multiply by [moduleStates] to get our chassis speeds.
+ * multiply by [moduleStates] to get our chassis speeds. The pseudoinverse only
+ * depends on the module locations, so it is computed once at construction and
+ * forward kinematics is a single matrix-vector product.
  *
  * Forward kinematics is also used for odometry -- determining the position of
  * the robot on the field using encoders and a gyro.
@@ -68,7 +70,7 @@ class SwerveDriveKinematics {
       // clang-format on
     }
 
-    m_forwardKinematics = m_inverseKinematics.householderQr();
+    ComputeForwardKinematics();
 
     wpi::math::MathSharedStore::ReportUsage(
         wpi::math::MathUsageId::kKinematics_SwerveDrive, 1);
@@ -85,7 +87,7 @@ class SwerveDriveKinematics {
       // clang-format on
     }
 
-    m_forwardKinematics = m_inverseKinematics.householderQr();
+    ComputeForwardKinematics();
 
     wpi::math::MathSharedStore::ReportUsage(
         wpi::math::MathUsageId::kKinematics_SwerveDrive, 1);
@@ -155,6 +157,24 @@ class SwerveDriveKinematics {
   ChassisSpeeds ToChassisSpeeds(
       wpi::array<SwerveModuleState, NumModules> moduleStates) const;
 
+  /**
+   * Performs forward kinematics and also reports how well the module states
+   * agree with each other. Module states measured on a rigid chassis with no
+   * wheel slip are exactly consistent with some chassis speed, so the residual
+   * is zero; scrubbing, slip or a misaligned module make it grow.
+   *
+   * @param moduleStates The state of the modules, in the same order as passed
+   * into the constructor of this class.
+   * @param residual Set to the norm of the least-squares residual: the
+   * difference between the measured module velocities and those the returned
+   * chassis speed would produce.
+   *
+   * @return The resulting chassis speed.
+   */
+  ChassisSpeeds ToChassisSpeedsWithResidual(
+      const wpi::array<SwerveModuleState, NumModules>& moduleStates,
+      units::meters_per_second_t* residual) const;
+
   /**
    * Normalizes the wheel speeds using some max attainable speed. Sometimes,
    * after inverse kinematics, the requested speed from a/several modules may be
@@ -172,9 +192,25 @@ class SwerveDriveKinematics {
       units::meters_per_second_t attainableMaxSpeed);
 
  private:
+  /**
+   * Precomputes the pseudoinverse of the inverse kinematics about the physical
+   * center of the robot. Must be called while m_inverseKinematics is still for
+   * that center.
+   */
+  void ComputeForwardKinematics();
+
+  /**
+   * Stacks the module velocity vectors into the column that inverse
+   * kinematics produces.
+   */
+  static Eigen::Matrix<double, NumModules * 2, 1> ModuleVelocities(
+      const wpi::array<SwerveModuleState, NumModules>& moduleStates);
+
   mutable Eigen::Matrix<double, NumModules * 2, 3> m_inverseKinematics;
-  Eigen::HouseholderQR<Eigen::Matrix<double, NumModules * 2, 3>>
-      m_forwardKinematics;
+  /// Inverse kinematics about the physical center, for forward residuals
+  Eigen::Matrix<double, NumModules * 2, 3> m_centeredInverseKinematics;
+  /// Pseudoinverse of m_centeredInverseKinematics
+  Eigen::Matrix<double, 3, NumModules * 2> m_forwardKinematics;
   wpi::array<Translation2d, NumModules> m_modules;
 
   mutable Translation2d m_previousCoR;